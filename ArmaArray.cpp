@@ -0,0 +1,295 @@
+#include "ArmaArray.h"
+#include "util.h"
+#include <cstring>
+#include <charconv>
+#include <new>
+#include <algorithm>
+
+void* ArmaArena::alloc(size_t size, size_t align)
+{
+	while (true) {
+		if (this->current < this->blocks.size()) {
+			Block& block = this->blocks[this->current];
+			size_t start = (this->used + align - 1) & ~(align - 1);
+			if (start + size <= block.size) {
+				this->used = start + size;
+				return block.data.get() + start;
+			}
+			this->current++;
+			this->used = 0;
+			continue;
+		}
+		//out of blocks, so add one. each is double the last so big inputs only take a few
+		size_t blockSize = this->blocks.empty() ? firstBlockSize : this->blocks.back().size * 2;
+		blockSize = (std::max)(blockSize, size + align);
+		this->blocks.push_back({ std::unique_ptr<char[]>(new char[blockSize]), blockSize });
+	}
+}
+
+ArmaValue* ArmaArray::newValue(ArmaValue::Type type)
+{
+	ArmaValue* v = new (this->arena.alloc(sizeof(ArmaValue), alignof(ArmaValue))) ArmaValue();
+	v->type = type;
+	v->next = nullptr;
+	v->parent = nullptr;
+	return v;
+}
+
+ArmaValue* ArmaArray::newArray()
+{
+	ArmaValue* v = newValue(ArmaValue::ARRAY);
+	v->arr.first = nullptr;
+	v->arr.last = nullptr;
+	v->arr.count = 0;
+	return v;
+}
+
+ArmaValue* ArmaArray::newString(std::string_view str)
+{
+	ArmaValue* v = newValue(ArmaValue::STRING);
+	char* data = (char*)this->arena.alloc(str.size(), 1);
+	memcpy(data, str.data(), str.size());
+	v->str.data = data;
+	v->str.length = str.size();
+	return v;
+}
+
+ArmaValue* ArmaArray::newNumber(double number)
+{
+	ArmaValue* v = newValue(ArmaValue::NUMBER);
+	v->number = number;
+	return v;
+}
+
+ArmaValue* ArmaArray::newBoolean(bool boolean)
+{
+	ArmaValue* v = newValue(ArmaValue::BOOLEAN);
+	v->boolean = boolean;
+	return v;
+}
+
+void ArmaArray::append(ArmaValue* arr, ArmaValue* value)
+{
+	value->parent = arr;
+	value->next = nullptr;
+	if (arr->arr.last == nullptr) {
+		arr->arr.first = value;
+	}
+	else {
+		arr->arr.last->next = value;
+	}
+	arr->arr.last = value;
+	arr->arr.count++;
+}
+
+static bool isSpace(char c) {
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static ArmaValue* parseFailed(ArmaParseError& error, size_t pos, const char* message) {
+	error.pos = pos;
+	error.message = message;
+	return nullptr;
+}
+
+ArmaValue* ArmaArray::parse(std::string_view in, ArmaParseError& error)
+{
+	clear();
+	const char* data = in.data();
+	size_t n = in.size();
+	size_t i = 0;
+	while (i < n && isSpace(data[i])) i++;
+	if (i == n || data[i] != '[') return parseFailed(error, i, "Expected '['");
+	i++;
+	ArmaValue* root = newArray();
+	//innermost array that hasn't been closed yet
+	ArmaValue* open = root;
+	//whether the next thing should be an element (or the end of an empty array), rather than ',' or ']'
+	bool expectValue = true;
+	//whether `open` has no elements yet, i.e. ']' is allowed where an element would go
+	bool empty = true;
+	while (true) {
+		while (i < n && isSpace(data[i])) i++;
+		if (i == n) return parseFailed(error, i, "Unexpected end of input, expected ']'");
+		char c = data[i];
+		if (!expectValue) {
+			if (c == ',') {
+				i++;
+				expectValue = true;
+				continue;
+			}
+			if (c != ']') return parseFailed(error, i, "Expected ',' or ']'");
+		}
+		else if (c == ']' && !empty) {
+			return parseFailed(error, i, "Expected a value after ','");
+		}
+
+		if (c == ']') {
+			i++;
+			if (open == root) {
+				while (i < n && isSpace(data[i])) i++;
+				if (i != n) return parseFailed(error, i, "Unexpected data after the end of the array");
+				return root;
+			}
+			open = open->parent;
+			expectValue = false;
+			empty = false;
+			continue;
+		}
+
+		ArmaValue* value;
+		if (c == '[') {
+			i++;
+			value = newArray();
+			append(open, value);
+			open = value;
+			empty = true;
+			continue;
+		}
+		else if (c == '"' || c == '\'') {
+			//strings can use either quote, and the quote they use is escaped by doubling it
+			size_t start = i + 1;
+			size_t end;
+			bool escaped = false;
+			size_t j = start;
+			while (true) {
+				const char* q = (const char*)memchr(data + j, c, n - j);
+				if (q == nullptr) return parseFailed(error, i, "Unterminated string");
+				end = q - data;
+				if (end + 1 < n && data[end + 1] == c) {
+					escaped = true;
+					j = end + 2;
+					continue;
+				}
+				break;
+			}
+			value = newValue(ArmaValue::STRING);
+			if (!escaped) {
+				value->str.data = data + start;
+				value->str.length = end - start;
+			}
+			else {
+				char* out = (char*)this->arena.alloc(end - start, 1);
+				size_t len = 0;
+				for (size_t k = start; k < end; k++) {
+					out[len++] = data[k];
+					if (data[k] == c) k++;
+				}
+				value->str.data = out;
+				value->str.length = len;
+			}
+			i = end + 1;
+		}
+		else if (c == '-' || (c >= '0' && c <= '9')) {
+			double number;
+			auto res = std::from_chars(data + i, data + n, number);
+			if (res.ec != std::errc()) return parseFailed(error, i, "Invalid number");
+			value = newValue(ArmaValue::NUMBER);
+			value->number = number;
+			i = res.ptr - data;
+		}
+		else if (n - i >= 4 && equalsIgnoreCase(in.substr(i, 4), "true")) {
+			value = newValue(ArmaValue::BOOLEAN);
+			value->boolean = true;
+			i += 4;
+		}
+		else if (n - i >= 5 && equalsIgnoreCase(in.substr(i, 5), "false")) {
+			value = newValue(ArmaValue::BOOLEAN);
+			value->boolean = false;
+			i += 5;
+		}
+		else {
+			return parseFailed(error, i, "Expected an array, string, number or boolean");
+		}
+		append(open, value);
+		expectValue = false;
+		empty = false;
+	}
+}
+
+//writes as much as fits into a buffer, but counts everything so the caller can tell whether it all fit
+struct ArmaWriter {
+	char* out;
+	size_t outSize;
+	size_t length;
+
+	void put(const char* data, size_t len) {
+		if (this->length + len <= this->outSize) memcpy(this->out + this->length, data, len);
+		this->length += len;
+	}
+	void put(char c) {
+		if (this->length < this->outSize) this->out[this->length] = c;
+		this->length++;
+	}
+};
+
+static void writeScalar(ArmaWriter& w, const ArmaValue* value) {
+	switch (value->type) {
+	case ArmaValue::STRING: {
+		w.put('"');
+		const char* data = value->str.data;
+		const char* end = data + value->str.length;
+		while (true) {
+			const char* q = (const char*)memchr(data, '"', end - data);
+			if (q == nullptr) break;
+			w.put(data, q - data + 1);
+			w.put('"');
+			data = q + 1;
+		}
+		w.put(data, end - data);
+		w.put('"');
+		break;
+	}
+	case ArmaValue::NUMBER: {
+		char buff[32];
+		auto res = std::to_chars(buff, buff + sizeof(buff), value->number);
+		w.put(buff, res.ptr - buff);
+		break;
+	}
+	case ArmaValue::BOOLEAN:
+		if (value->boolean) w.put("true", 4);
+		else w.put("false", 5);
+		break;
+	default:
+		break;
+	}
+}
+
+static void writeValue(ArmaWriter& w, const ArmaValue* value) {
+	const ArmaValue* cur = value;
+	while (true) {
+		if (cur->type == ArmaValue::ARRAY) {
+			w.put('[');
+			if (cur->arr.first != nullptr) {
+				cur = cur->arr.first;
+				continue;
+			}
+			w.put(']');
+		}
+		else {
+			writeScalar(w, cur);
+		}
+		//climb out of every array `cur` was the last element of
+		while (cur != value && cur->next == nullptr) {
+			cur = cur->parent;
+			w.put(']');
+		}
+		if (cur == value) return;
+		w.put(", ", 2);
+		cur = cur->next;
+	}
+}
+
+size_t ArmaArray::serializedLength(const ArmaValue* value)
+{
+	ArmaWriter w = { nullptr, 0, 0 };
+	writeValue(w, value);
+	return w.length;
+}
+
+size_t ArmaArray::serialize(const ArmaValue* value, char* out, size_t outSize)
+{
+	ArmaWriter w = { out, outSize, 0 };
+	writeValue(w, value);
+	return w.length <= outSize ? w.length : 0;
+}
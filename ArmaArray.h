@@ -0,0 +1,96 @@
+#pragma once
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <cstddef>
+
+//one value in an Arma array. every value is allocated from the ArmaArray that parsed or created it.
+struct ArmaValue {
+	enum Type : unsigned char {
+		ARRAY, STRING, NUMBER, BOOLEAN
+	};
+	Type type;
+	union {
+		//children are a singly-linked list through `next`, kept in order
+		struct {
+			ArmaValue* first;
+			ArmaValue* last;
+			size_t count;
+		} arr;
+		//not null-terminated. points into the parsed input if the string had no escaped quotes
+		struct {
+			const char* data;
+			size_t length;
+		} str;
+		double number;
+		bool boolean;
+	};
+	//next element of the array this is in, or nullptr
+	ArmaValue* next;
+	//the array this is in, or nullptr for the root. lets parsing and serializing walk the tree without recursing,
+	//so deeply nested input can't overflow the stack
+	ArmaValue* parent;
+
+	std::string_view string() const {
+		return std::string_view(str.data, str.length);
+	}
+};
+
+//where and why parsing failed
+struct ArmaParseError {
+	size_t pos;
+	const char* message;
+};
+
+//bump allocator that hands out memory in growing blocks. resetting keeps the blocks, so once it has grown to fit
+//the biggest input it sees, parsing doesn't touch the heap at all.
+class ArmaArena {
+private:
+	struct Block {
+		std::unique_ptr<char[]> data;
+		size_t size;
+	};
+	static const size_t firstBlockSize = 4096;
+	std::vector<Block> blocks;
+	//block currently being allocated from
+	size_t current = 0;
+	//bytes used in the current block
+	size_t used = 0;
+public:
+	void* alloc(size_t size, size_t align);
+	//frees everything allocated so far, all at once
+	void reset() {
+		this->current = 0;
+		this->used = 0;
+	}
+};
+
+//parses Arma arrays (as produced by `str` in SQF) in a single pass, and serializes them back.
+//all values live in this object's arena until the next `parse`/`clear` or until it's destroyed.
+class ArmaArray {
+private:
+	ArmaArena arena;
+	ArmaValue* newValue(ArmaValue::Type type);
+public:
+	//parses `in`, returning the root array, or nullptr with `error` filled in if it isn't a valid array.
+	//strings without escaped quotes point straight into `in`, so `in` must outlive the result.
+	ArmaValue* parse(std::string_view in, ArmaParseError& error);
+	//frees every value this has parsed or created
+	void clear() {
+		this->arena.reset();
+	}
+
+	ArmaValue* newArray();
+	//`str` is copied into the arena
+	ArmaValue* newString(std::string_view str);
+	ArmaValue* newNumber(double number);
+	ArmaValue* newBoolean(bool boolean);
+	//adds `value` to the end of `arr`
+	static void append(ArmaValue* arr, ArmaValue* value);
+
+	//how many characters `serialize` will write for `value`
+	static size_t serializedLength(const ArmaValue* value);
+	//writes `value` to `out` in the format SQF's `parseSimpleArray` reads, without a null terminator.
+	//returns the number of characters written, or 0 if it doesn't fit in `outSize`
+	static size_t serialize(const ArmaValue* value, char* out, size_t outSize);
+};
@@ -0,0 +1,116 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//stands in for the part of Arma that extension callbacks go through. Arma keeps callbacks in a buffer of 100 and
+//only hands them to SQF once per frame, refusing new ones (the callback returns -1) while the buffer is full.
+//frames can also hitch, during which nothing is taken out of the buffer at all
+class ArmaHost {
+public:
+	typedef std::chrono::steady_clock Clock;
+	static const size_t bufferSize = 100;
+
+	struct Options {
+		double fps = 60;
+		//how long SQF spends handling each callback, which makes frames with lots of callbacks longer
+		int sqfCostUs = 0;
+		//every `hitchEveryMs` a frame takes `hitchMs` longer than usual (0 for no hitches)
+		int hitchEveryMs = 0;
+		int hitchMs = 0;
+	};
+	//called on the simulated main thread for every callback SQF handles, with the time it handled it
+	std::function<void(const std::string& function, const std::string& data, Clock::time_point handledAt)> deliver;
+
+private:
+	struct Message {
+		std::string function;
+		std::string data;
+	};
+	Options options;
+	std::mutex mutex;
+	//callbacks waiting for the next frame
+	std::vector<Message> buffer;
+	std::thread* mainThread = nullptr;
+	std::atomic<bool> running{ false };
+	//callbacks refused because the buffer was full
+	std::atomic<uint64_t> refused{ 0 };
+	std::atomic<uint64_t> frames{ 0 };
+	std::atomic<uint64_t> hitches{ 0 };
+
+	void mainLoop() {
+		auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / this->options.fps));
+		auto nextFrame = Clock::now();
+		auto nextHitch = nextFrame + std::chrono::milliseconds(this->options.hitchEveryMs);
+		std::vector<Message> handling;
+		while (this->running.load()) {
+			if (this->options.hitchEveryMs > 0 && Clock::now() >= nextHitch) {
+				//the main thread is stuck, so the buffer just fills up
+				std::this_thread::sleep_for(std::chrono::milliseconds(this->options.hitchMs));
+				nextHitch += std::chrono::milliseconds(this->options.hitchEveryMs);
+				this->hitches++;
+			}
+			{
+				std::unique_lock<std::mutex> lock(this->mutex);
+				handling.swap(this->buffer);
+			}
+			for (auto& msg : handling) {
+				if (this->options.sqfCostUs > 0) {
+					//spin rather than sleep, since SQF keeps the main thread busy
+					auto until = Clock::now() + std::chrono::microseconds(this->options.sqfCostUs);
+					while (Clock::now() < until);
+				}
+				if (this->deliver) this->deliver(msg.function, msg.data, Clock::now());
+			}
+			handling.clear();
+			this->frames++;
+			nextFrame += period;
+			auto now = Clock::now();
+			//a frame that overran just delays the next one, like a real frame rate drop
+			if (nextFrame < now) nextFrame = now;
+			std::this_thread::sleep_until(nextFrame);
+		}
+	}
+
+public:
+	~ArmaHost() {
+		stop();
+	}
+	void start(const Options& opts) {
+		this->options = opts;
+		this->buffer.reserve(bufferSize);
+		this->running = true;
+		this->mainThread = new std::thread([this]() { mainLoop(); });
+	}
+	void stop() {
+		if (this->mainThread == nullptr) return;
+		this->running = false;
+		this->mainThread->join();
+		delete this->mainThread;
+		this->mainThread = nullptr;
+	}
+	//what the extension's callback does: queue the message for the next frame, or return -1 if the buffer is full
+	int callback(const char* function, const char* data) {
+		std::unique_lock<std::mutex> lock(this->mutex);
+		if (this->buffer.size() >= bufferSize) {
+			this->refused++;
+			return -1;
+		}
+		this->buffer.push_back(Message{ function, data });
+		return 0;
+	}
+	uint64_t getRefused() const {
+		return this->refused.load();
+	}
+	uint64_t getFrames() const {
+		return this->frames.load();
+	}
+	uint64_t getHitches() const {
+		return this->hitches.load();
+	}
+};
@@ -0,0 +1,1278 @@
+//drives ArmaCOM through the same entry points Arma uses, with a fake Arma callback, and measures how many frames
+//per second get from a write to a "data_read" callback and how long each one takes. see README.md for how to build and run it.
+//results are printed as one JSON object per line so they can be collected and compared between builds.
+#ifdef _WIN32
+#include <windows.h>
+#include <tlhelp32.h>
+#else
+#include <dirent.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pty.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#define __stdcall
+#endif
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ArmaHost.h"
+
+typedef std::chrono::steady_clock Clock;
+typedef int (*ArmaCallback)(char const* name, char const* function, char const* data);
+typedef int (__stdcall* RVExtensionArgsFn)(char* output, int outputSize, const char* function, const char** argv, int argc);
+typedef void (__stdcall* RVExtensionRegisterCallbackFn)(ArmaCallback callback);
+
+//the size of the output buffer Arma hands to extensions
+static const int outputSize = 10240;
+//digits of the sequence number at the start of every payload, which is how callbacks are matched to writes
+static const int seqDigits = 8;
+
+//every callback the extension has made that we're still interested in
+struct Inbox {
+	std::mutex mutex;
+	std::condition_variable received;
+	std::vector<std::string> functions;
+	std::vector<std::string> data;
+	std::vector<Clock::time_point> times;
+} inbox;
+
+static void addToInbox(const std::string& function, const std::string& data, Clock::time_point time)
+{
+	{
+		std::unique_lock<std::mutex> lock(inbox.mutex);
+		inbox.functions.push_back(function);
+		inbox.data.push_back(data);
+		inbox.times.push_back(time);
+	}
+	inbox.received.notify_all();
+}
+
+//while a simulation is running, callbacks go through a simulated Arma instead of straight into the inbox
+static std::atomic<ArmaHost*> simHost{ nullptr };
+
+//stands in for Arma's callback. Arma copies the strings and returns straight away, so this does too
+int fakeCallback(char const*, char const* function, char const* data)
+{
+	ArmaHost* host = simHost.load();
+	if (host != nullptr) return host->callback(function, data);
+	addToInbox(function, data, Clock::now());
+	return 0;
+}
+
+class Extension {
+private:
+	RVExtensionArgsFn argsFn = nullptr;
+public:
+	bool load(const std::string& path) {
+#ifdef _WIN32
+		HMODULE lib = LoadLibraryA(path.c_str());
+		if (lib == nullptr) return false;
+		this->argsFn = (RVExtensionArgsFn)GetProcAddress(lib, "RVExtensionArgs");
+		auto registerFn = (RVExtensionRegisterCallbackFn)GetProcAddress(lib, "RVExtensionRegisterCallback");
+#else
+		void* lib = dlopen(path.c_str(), RTLD_NOW);
+		if (lib == nullptr) {
+			std::cerr << dlerror() << std::endl;
+			return false;
+		}
+		this->argsFn = (RVExtensionArgsFn)dlsym(lib, "RVExtensionArgs");
+		auto registerFn = (RVExtensionRegisterCallbackFn)dlsym(lib, "RVExtensionRegisterCallback");
+#endif
+		if (this->argsFn == nullptr || registerFn == nullptr) return false;
+		registerFn(fakeCallback);
+		return true;
+	}
+	//calls the extension like `"ArmaCOM" callExtension [function, args]`, which quotes every string argument.
+	//with `quote` false the arguments are passed as they are, the way Arma passes arrays and numbers
+	std::string call(const std::string& function, const std::vector<std::string>& args, bool quote = true) {
+		std::vector<std::string> quoted;
+		quoted.reserve(args.size());
+		for (auto& a : args) {
+			if (!quote) {
+				quoted.push_back(a);
+				continue;
+			}
+			std::string q = "\"";
+			for (char c : a) {
+				if (c == '"') q += '"';
+				q += c;
+			}
+			quoted.push_back(q + "\"");
+		}
+		std::vector<const char*> argv;
+		for (auto& q : quoted) argv.push_back(q.c_str());
+		static thread_local char output[outputSize];
+		output[0] = '\0';
+		this->argsFn(output, outputSize, function.c_str(), argv.data(), (int)argv.size());
+		return output;
+	}
+};
+
+//somewhere to write raw bytes that the extension then reads
+class Sender {
+public:
+	virtual ~Sender() {}
+	virtual bool send(const std::string& data) = 0;
+};
+
+//writes through the extension's own TCPClient, so the write path is measured too
+class ExtensionSender : public Sender {
+private:
+	Extension& ext;
+	std::string id;
+public:
+	ExtensionSender(Extension& ext, std::string id) : ext(ext), id(id) {}
+	bool send(const std::string& data) {
+		return ext.call(id, { "write", data }).rfind("[\"SUCCESS\"", 0) == 0;
+	}
+};
+
+//writes straight to the other end of a serial port pair (a pseudo-terminal's master side, or the other half of a null modem),
+//and reads back what the extension writes to its end
+class PortSender : public Sender {
+public:
+#ifdef _WIN32
+	HANDLE handle = INVALID_HANDLE_VALUE;
+	bool open(const std::string& name) {
+		this->handle = CreateFileA(("\\\\.\\" + name).c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, 0, nullptr);
+		if (this->handle == INVALID_HANDLE_VALUE) return false;
+		//reads return as soon as anything has arrived, or after 100ms
+		COMMTIMEOUTS timeouts = { MAXDWORD, MAXDWORD, 100, 0, 0 };
+		SetCommTimeouts(this->handle, &timeouts);
+		return true;
+	}
+	bool send(const std::string& data) {
+		DWORD written;
+		return WriteFile(this->handle, data.data(), (DWORD)data.length(), &written, nullptr) && written == data.length();
+	}
+	//reads whatever arrives within about 100ms, returning how much that was, or -1 on an error
+	long receive(char* buff, size_t len) {
+		DWORD read;
+		if (!ReadFile(this->handle, buff, (DWORD)len, &read, nullptr)) return -1;
+		return (long)read;
+	}
+	~PortSender() {
+		if (this->handle != INVALID_HANDLE_VALUE) CloseHandle(this->handle);
+	}
+#else
+	int fd = -1;
+	bool send(const std::string& data) {
+		size_t done = 0;
+		while (done < data.length()) {
+			ssize_t n = write(this->fd, data.data() + done, data.length() - done);
+			if (n < 0) return false;
+			done += (size_t)n;
+		}
+		return true;
+	}
+	//reads whatever arrives within about 100ms, returning how much that was, or -1 on an error
+	long receive(char* buff, size_t len) {
+		pollfd p = { this->fd, POLLIN, 0 };
+		int ready = poll(&p, 1, 100);
+		if (ready <= 0) return ready;
+		return (long)read(this->fd, buff, len);
+	}
+	~PortSender() {
+		if (this->fd >= 0) close(this->fd);
+	}
+#endif
+};
+
+//counts the lines an instance writes as they arrive at the other end, so writes can be timed until they're all out
+class LineCounter {
+public:
+	virtual ~LineCounter() {}
+	//starts counting from zero
+	virtual void start() = 0;
+	//waits up to 10 seconds for `lines` lines to have arrived since `start`, and returns how many did
+	virtual size_t await(size_t lines) = 0;
+	virtual void stop() {}
+};
+
+//counts the "data_read" callbacks of the instance on the other end of a TCP connection, which is set up to frame on "\n"
+class CallbackLineCounter : public LineCounter {
+private:
+	Extension& ext;
+	std::string id;
+public:
+	CallbackLineCounter(Extension& ext, std::string id) : ext(ext), id(id) {}
+	void start() {
+		ext.call(id, { "callbackOnChar", "\n" });
+		std::unique_lock<std::mutex> lock(inbox.mutex);
+		inbox.functions.clear();
+		inbox.data.clear();
+		inbox.times.clear();
+	}
+	size_t await(size_t lines) {
+		std::unique_lock<std::mutex> lock(inbox.mutex);
+		size_t ans = 0;
+		inbox.received.wait_for(lock, std::chrono::seconds(10), [&]() {
+			ans = (size_t)std::count(inbox.functions.begin(), inbox.functions.end(), "data_read");
+			return ans >= lines;
+		});
+		return ans;
+	}
+};
+
+//reads the other end of a serial port pair on a thread of its own, counting "\n"s
+class PortLineCounter : public LineCounter {
+private:
+	PortSender& port;
+	std::thread reader;
+	std::atomic<bool> running{ false };
+	std::mutex mutex;
+	std::condition_variable arrived;
+	size_t lines = 0;
+public:
+	PortLineCounter(PortSender& port) : port(port) {}
+	~PortLineCounter() {
+		stop();
+	}
+	void start() {
+		stop();
+		this->lines = 0;
+		this->running = true;
+		this->reader = std::thread([this]() {
+			char buff[4096];
+			while (this->running) {
+				long n = this->port.receive(buff, sizeof(buff));
+				if (n < 0) break;
+				size_t found = (size_t)std::count(buff, buff + n, '\n');
+				if (found == 0) continue;
+				{
+					std::unique_lock<std::mutex> lock(this->mutex);
+					this->lines += found;
+				}
+				this->arrived.notify_all();
+			}
+		});
+	}
+	size_t await(size_t want) {
+		std::unique_lock<std::mutex> lock(this->mutex);
+		this->arrived.wait_for(lock, std::chrono::seconds(10), [&]() { return this->lines >= want; });
+		return this->lines;
+	}
+	void stop() {
+		this->running = false;
+		if (this->reader.joinable()) this->reader.join();
+	}
+};
+
+enum class Framing { CHAR, LENGTH, PREFIX, STRING };
+static const char* framingName(Framing f) {
+	switch (f) {
+	case Framing::CHAR: return "char";
+	case Framing::LENGTH: return "length";
+	case Framing::PREFIX: return "prefix";
+	default: return "string";
+	}
+}
+
+//whether a length header byte can be passed through `write`. a 0 would end the string early, and quotes get mangled
+static bool headerByteOk(size_t b)
+{
+	return b != 0 && b != '"';
+}
+
+//sets up the receiving instance for `framing`, returning false if the combination can't be sent through SQF strings
+static bool configureFraming(Extension& ext, const std::string& id, Framing framing, size_t payload)
+{
+	switch (framing) {
+	case Framing::CHAR:
+		ext.call(id, { "callbackOnChar", "\n" });
+		return true;
+	case Framing::LENGTH:
+		ext.call(id, { "callbackOnLength", std::to_string(payload) });
+		return true;
+	case Framing::PREFIX:
+		if (payload < 256) {
+			ext.call(id, { "callbackOnLengthPrefix", "1" });
+			return headerByteOk(payload);
+		}
+		ext.call(id, { "callbackOnLengthPrefix", "2" });
+		return payload < 65536 && headerByteOk(payload >> 8) && headerByteOk(payload & 0xff);
+	default:
+		ext.call(id, { "callbackOnString", "\r\n" });
+		return true;
+	}
+}
+
+//the bytes to write for frame number `seq`
+static std::string makeFrame(Framing framing, size_t payload, int seq)
+{
+	char digits[16];
+	snprintf(digits, sizeof(digits), "%0*d", seqDigits, seq);
+	std::string body(digits, seqDigits);
+	body.resize(payload, 'x');
+	switch (framing) {
+	case Framing::CHAR: return body + "\n";
+	case Framing::LENGTH: return body;
+	case Framing::PREFIX:
+		if (payload < 256) return std::string(1, (char)payload) + body;
+		return std::string(1, (char)(payload >> 8)) + std::string(1, (char)(payload & 0xff)) + body;
+	default: return body + "\r\n";
+	}
+}
+
+//the sequence number of a "data_read" callback's frame, or -1 if it isn't one of ours
+static int frameSeq(const std::string& data)
+{
+	size_t start = data.find("\", \"");
+	if (start == std::string::npos) return -1;
+	start += 4;
+	int seq = 0;
+	for (int i = 0; i < seqDigits; i++) {
+		if (start + i >= data.length() || data[start + i] < '0' || data[start + i] > '9') return -1;
+		seq = seq * 10 + (data[start + i] - '0');
+	}
+	return seq;
+}
+
+struct Result {
+	size_t received = 0;
+	double seconds = 0;
+	std::vector<double> latenciesUs;
+};
+
+//sends `count` frames, either all at once (`burst`) or each after the last one's callback, and matches up the callbacks.
+//with `oneWrite`, a burst goes out in a single write, so it's mostly the extension's reading and framing being timed
+static Result runFrames(Sender& sender, Framing framing, size_t payload, int count, bool burst, bool oneWrite = false)
+{
+	{
+		std::unique_lock<std::mutex> lock(inbox.mutex);
+		inbox.functions.clear();
+		inbox.data.clear();
+		inbox.times.clear();
+	}
+	std::vector<Clock::time_point> sentAt(count);
+	std::vector<std::string> frames;
+	for (int i = 0; i < count; i++) frames.push_back(makeFrame(framing, payload, i));
+	auto start = Clock::now();
+	size_t seen = 0;
+	Result ans;
+	std::vector<bool> matched(count, false);
+	//takes every callback that has come in since the last call. `inbox.mutex` must be held
+	auto collect = [&]() {
+		for (; seen < inbox.data.size(); seen++) {
+			if (inbox.functions[seen] != "data_read") continue;
+			int seq = frameSeq(inbox.data[seen]);
+			if (seq < 0 || seq >= count || matched[seq]) continue;
+			matched[seq] = true;
+			ans.received++;
+			ans.latenciesUs.push_back(std::chrono::duration<double, std::micro>(inbox.times[seen] - sentAt[seq]).count());
+		}
+	};
+	const auto timeout = std::chrono::seconds(10);
+	if (oneWrite) {
+		std::string all;
+		for (auto& frame : frames) all += frame;
+		std::fill(sentAt.begin(), sentAt.end(), Clock::now());
+		if (!sender.send(all)) std::cerr << "write failed" << std::endl;
+	}
+	for (int i = 0; i < count && !oneWrite; i++) {
+		sentAt[i] = Clock::now();
+		if (!sender.send(frames[i])) {
+			std::cerr << "write failed" << std::endl;
+			break;
+		}
+		if (!burst) {
+			std::unique_lock<std::mutex> lock(inbox.mutex);
+			inbox.received.wait_for(lock, timeout, [&]() { collect(); return matched[i]; });
+		}
+	}
+	{
+		std::unique_lock<std::mutex> lock(inbox.mutex);
+		inbox.received.wait_for(lock, timeout, [&]() { collect(); return ans.received == (size_t)count; });
+		collect();
+	}
+	ans.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	return ans;
+}
+
+static double percentile(std::vector<double>& sorted, double p)
+{
+	if (sorted.empty()) return 0;
+	size_t i = (size_t)(p * (sorted.size() - 1) + 0.5);
+	return sorted[(std::min)(i, sorted.size() - 1)];
+}
+
+//whether any burst or pingpong run lost frames, for `--check`
+static bool lostFrames = false;
+
+static void report(std::ostream& out, const std::string& transport, Framing framing, size_t payload, const char* mode, int count, Result& r)
+{
+	if (r.received < (size_t)count) lostFrames = true;
+	std::sort(r.latenciesUs.begin(), r.latenciesUs.end());
+	out << "{\"transport\":\"" << transport << "\",\"framing\":\"" << framingName(framing) << "\",\"payloadBytes\":" << payload
+		<< ",\"mode\":\"" << mode << "\",\"sent\":" << count << ",\"received\":" << r.received
+		<< ",\"msgsPerSec\":" << (r.seconds > 0 ? r.received / r.seconds : 0)
+		<< ",\"p50Us\":" << percentile(r.latenciesUs, 0.5) << ",\"p99Us\":" << percentile(r.latenciesUs, 0.99)
+		<< ",\"maxUs\":" << (r.latenciesUs.empty() ? 0 : r.latenciesUs.back()) << "}" << std::endl;
+}
+
+//waits for a callback with the given function and returns its data
+static std::string awaitCallback(const std::string& function)
+{
+	std::unique_lock<std::mutex> lock(inbox.mutex);
+	std::string ans;
+	inbox.received.wait_for(lock, std::chrono::seconds(10), [&]() {
+		for (size_t i = 0; i < inbox.functions.size(); i++) {
+			if (inbox.functions[i] == function) {
+				ans = inbox.data[i];
+				return true;
+			}
+		}
+		return false;
+	});
+	return ans;
+}
+
+struct Options {
+	std::string library;
+	std::string outPath;
+	int port = 47321;
+	int frames = 10000;
+	int pings = 1000;
+	std::vector<size_t> payloads = { 16, 128, 1000, 4000 };
+	bool tcp = true;
+	bool serial = true;
+	//exit with 1 if a burst or pingpong run lost frames, so the benchmark doubles as an end to end test
+	bool check = false;
+	//how long to leave each connection idle before the runs, measuring what it costs while nothing is happening
+	double idleSeconds = 2;
+	//on Windows, the port the extension opens and the port we write to. on Linux a pseudo-terminal is used instead
+	std::string serialPort;
+	std::string serialPeer;
+	//runs a load profile against a simulated Arma instead of the usual burst and pingpong runs
+	bool sim = false;
+	ArmaHost::Options host;
+	std::string profile = "steady";
+	std::string profileFile;
+	size_t simPayload = 64;
+	//callbacks that reach SQF later than this after being written count as late
+	double lateMs = 100;
+	//the overflow policy to give the receiving instance, or empty to leave it alone
+	std::string policy;
+	//runs the cases that time one part of the extension each, instead of the usual runs
+	bool micro = false;
+	//another build of the extension to run everything against too, so each case is reported with both builds' results
+	std::string baseline;
+	//numbers of TCP connections to open at once for `--micro`, to see how many threads they need
+	std::vector<int> connectionCounts = { 1, 200 };
+	//numbers of serial ports to open at once to see how the extension scales, instead of the usual runs
+	std::vector<int> portCounts;
+	//frames per second written across all the ports, and for how long
+	double scaleRate = 2000;
+	double scaleSeconds = 2;
+};
+
+//how many times every thread in the process has been switched out so far, i.e. roughly how often they've woken up,
+//and how many threads there are. -1 where that can't be found out
+static void threadActivity(long long& switches, long long& threads)
+{
+	switches = -1;
+	threads = -1;
+#ifdef _WIN32
+	HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
+	if (snapshot == INVALID_HANDLE_VALUE) return;
+	THREADENTRY32 entry;
+	entry.dwSize = sizeof(entry);
+	threads = 0;
+	for (BOOL more = Thread32First(snapshot, &entry); more; more = Thread32Next(snapshot, &entry)) {
+		if (entry.th32OwnerProcessID == GetCurrentProcessId()) threads++;
+	}
+	CloseHandle(snapshot);
+#else
+	DIR* dir = opendir("/proc/self/task");
+	if (dir == nullptr) return;
+	switches = 0;
+	threads = 0;
+	while (dirent* entry = readdir(dir)) {
+		if (entry->d_name[0] == '.') continue;
+		threads++;
+		//both voluntary_ctxt_switches and nonvoluntary_ctxt_switches
+		std::ifstream status(std::string("/proc/self/task/") + entry->d_name + "/status");
+		std::string line;
+		while (std::getline(status, line)) {
+			if (line.find("ctxt_switches:") != std::string::npos) switches += std::stoll(line.substr(line.find(':') + 1));
+		}
+	}
+	closedir(dir);
+#endif
+}
+
+//CPU time used by the whole process so far
+static double cpuSeconds()
+{
+#ifdef _WIN32
+	FILETIME created, exited, kernel, user;
+	GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user);
+	auto seconds = [](FILETIME t) { return (double)(((unsigned long long)t.dwHighDateTime << 32) | t.dwLowDateTime) / 1e7; };
+	return seconds(kernel) + seconds(user);
+#else
+	timespec t;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &t);
+	return t.tv_sec + t.tv_nsec / 1e9;
+#endif
+}
+
+//leaves the extension alone for a while with a connection open, and reports how often its threads woke up
+//and how much CPU they used anyway
+static void measureIdle(const std::string& transport, const Options& opts, std::ostream& out)
+{
+	if (opts.idleSeconds <= 0) return;
+	long long switchesBefore, switchesAfter, threads;
+	threadActivity(switchesBefore, threads);
+	double cpuBefore = cpuSeconds();
+	std::this_thread::sleep_for(std::chrono::duration<double>(opts.idleSeconds));
+	double cpuAfter = cpuSeconds();
+	threadActivity(switchesAfter, threads);
+	out << "{\"transport\":\"" << transport << "\",\"mode\":\"idle\",\"seconds\":" << opts.idleSeconds;
+	if (threads >= 0) out << ",\"threads\":" << threads;
+	//less the one switch of this thread going to sleep
+	if (switchesAfter >= 0) out << ",\"wakeupsPerSec\":" << (switchesAfter - switchesBefore - 1) / opts.idleSeconds;
+	out << ",\"cpuPercent\":" << 100 * (cpuAfter - cpuBefore) / opts.idleSeconds << "}" << std::endl;
+}
+
+static void runAll(Extension& ext, Sender& sender, const std::string& receiverId, const std::string& transport, const Options& opts, std::ostream& out)
+{
+	for (Framing framing : { Framing::CHAR, Framing::LENGTH, Framing::PREFIX, Framing::STRING }) {
+		for (size_t payload : opts.payloads) {
+			//every payload starts with its sequence number
+			if (payload < (size_t)seqDigits) continue;
+			if (!configureFraming(ext, receiverId, framing, payload)) {
+				std::cerr << transport << ": skipped " << framingName(framing) << " framing for " << payload << " bytes, since its header can't be written" << std::endl;
+				continue;
+			}
+			Result burst = runFrames(sender, framing, payload, opts.frames, true);
+			report(out, transport, framing, payload, "burst", opts.frames, burst);
+			Result ping = runFrames(sender, framing, payload, opts.pings, false);
+			report(out, transport, framing, payload, "pingpong", opts.pings, ping);
+		}
+	}
+}
+
+//a stretch of a load profile: `rate` frames per second for `durationMs`
+struct Phase {
+	int durationMs;
+	double rate;
+};
+
+//the built-in load profiles, or the one in `opts.profileFile` (a line of `durationMs rate` per phase)
+static bool loadProfile(const Options& opts, std::vector<Phase>& phases)
+{
+	if (!opts.profileFile.empty()) {
+		std::ifstream file(opts.profileFile);
+		if (!file) return false;
+		std::string line;
+		while (std::getline(file, line)) {
+			if (line.empty() || line[0] == '#') continue;
+			std::stringstream fields(line);
+			Phase p;
+			if (fields >> p.durationMs >> p.rate) phases.push_back(p);
+		}
+		return !phases.empty();
+	}
+	if (opts.profile == "steady") {
+		phases = { { 10000, 500 } };
+	}
+	else if (opts.profile == "bursts") {
+		//short bursts well beyond what 100 callbacks a frame can keep up with, with quiet spells to catch up in
+		for (int i = 0; i < 5; i++) {
+			phases.push_back({ 200, 10000 });
+			phases.push_back({ 800, 100 });
+		}
+	}
+	else if (opts.profile == "ramp") {
+		for (double rate = 1000; rate <= 16000; rate *= 2) phases.push_back({ 2000, rate });
+	}
+	else {
+		return false;
+	}
+	return true;
+}
+
+//the `index`th number in a command's output
+static double numberAt(const std::string& output, size_t index)
+{
+	size_t i = 0;
+	for (size_t pos = 0; pos < output.length(); pos++) {
+		if (output[pos] < '0' || output[pos] > '9') continue;
+		size_t end = output.find_first_not_of("0123456789.", pos);
+		if (end == std::string::npos) end = output.length();
+		if (i++ == index) return std::stod(output.substr(pos, end - pos));
+		pos = end;
+	}
+	return 0;
+}
+
+//writes a load profile to `receiverId` while a simulated Arma handles its callbacks a frame at a time, and reports
+//how many frames got to SQF, how late they were, and how long the writer was held up by the receiver falling behind
+static void runSim(Extension& ext, Sender& sender, const std::string& receiverId, const std::string& transport, const Options& opts, std::ostream& out)
+{
+	std::vector<Phase> phases;
+	if (!loadProfile(opts, phases)) {
+		std::cerr << "sim: unknown or empty profile " << (opts.profileFile.empty() ? opts.profile : opts.profileFile) << std::endl;
+		return;
+	}
+	size_t payload = (std::max)(opts.simPayload, (size_t)seqDigits);
+	configureFraming(ext, receiverId, Framing::CHAR, payload);
+	if (!opts.policy.empty()) {
+		std::string res = ext.call(receiverId, { "setOverflowPolicy", opts.policy });
+		if (res.rfind("[\"SUCCESS\"", 0) != 0) {
+			std::cerr << "sim: couldn't set the overflow policy: " << res << std::endl;
+			return;
+		}
+	}
+	int total = 0;
+	for (auto& p : phases) total += (int)(p.durationMs * p.rate / 1000);
+	std::vector<std::string> frames;
+	for (int i = 0; i < total; i++) frames.push_back(makeFrame(Framing::CHAR, payload, i));
+	std::vector<Clock::time_point> sentAt(total);
+	{
+		std::unique_lock<std::mutex> lock(inbox.mutex);
+		inbox.functions.clear();
+		inbox.data.clear();
+		inbox.times.clear();
+	}
+	std::string statsBefore = ext.call(receiverId, { "getStats" });
+	std::string overflowBefore = ext.call(receiverId, { "getOverflowStats" });
+
+	ArmaHost host;
+	host.deliver = addToInbox;
+	host.start(opts.host);
+	simHost = &host;
+
+	//a write that takes this long means the receiver has stopped reading and the writer is waiting for room
+	const auto stallThreshold = std::chrono::milliseconds(1);
+	Clock::duration stalled{ 0 };
+	int sent = 0;
+	auto start = Clock::now();
+	auto phaseStart = start;
+	for (auto& p : phases) {
+		int count = (int)(p.durationMs * p.rate / 1000);
+		for (int i = 0; i < count && sent < total; i++) {
+			//frames go out on schedule, and any that are overdue (because a write stalled) go out straight away
+			std::this_thread::sleep_until(phaseStart + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(i / p.rate)));
+			sentAt[sent] = Clock::now();
+			if (!sender.send(frames[sent])) {
+				std::cerr << "write failed" << std::endl;
+				break;
+			}
+			auto took = Clock::now() - sentAt[sent];
+			if (took > stallThreshold) stalled += took;
+			sent++;
+		}
+		phaseStart += std::chrono::milliseconds(p.durationMs);
+	}
+	auto sendEnd = Clock::now();
+
+	//give whatever is still queued a chance to get through
+	size_t received = 0;
+	std::vector<double> latenciesUs;
+	std::vector<bool> matched(total, false);
+	size_t seen = 0;
+	auto collect = [&]() {
+		for (; seen < inbox.data.size(); seen++) {
+			if (inbox.functions[seen] != "data_read") continue;
+			int seq = frameSeq(inbox.data[seen]);
+			if (seq < 0 || seq >= sent || matched[seq]) continue;
+			matched[seq] = true;
+			received++;
+			latenciesUs.push_back(std::chrono::duration<double, std::micro>(inbox.times[seen] - sentAt[seq]).count());
+		}
+	};
+	{
+		std::unique_lock<std::mutex> lock(inbox.mutex);
+		//stops early once nothing has arrived for a while, since dropped frames are never coming
+		while (received < (size_t)sent) {
+			size_t before = received;
+			inbox.received.wait_for(lock, std::chrono::seconds(2), [&]() { collect(); return received == (size_t)sent; });
+			if (received == before) break;
+		}
+		collect();
+	}
+	simHost = nullptr;
+	host.stop();
+
+	std::string statsAfter = ext.call(receiverId, { "getStats" });
+	std::string overflowAfter = ext.call(receiverId, { "getOverflowStats" });
+	std::sort(latenciesUs.begin(), latenciesUs.end());
+	size_t late = latenciesUs.end() - std::upper_bound(latenciesUs.begin(), latenciesUs.end(), opts.lateMs * 1000);
+	double sendSeconds = std::chrono::duration<double>(sendEnd - start).count();
+	out << "{\"transport\":\"" << transport << "\",\"mode\":\"sim\",\"profile\":\"" << (opts.profileFile.empty() ? opts.profile : opts.profileFile)
+		<< "\",\"payloadBytes\":" << payload << ",\"fps\":" << opts.host.fps << ",\"sqfCostUs\":" << opts.host.sqfCostUs
+		<< ",\"hitchEveryMs\":" << opts.host.hitchEveryMs << ",\"hitchMs\":" << opts.host.hitchMs
+		<< ",\"policy\":\"" << (opts.policy.empty() ? "default" : opts.policy) << "\""
+		<< ",\"sent\":" << sent << ",\"received\":" << received << ",\"dropped\":" << (sent - (int)received)
+		<< ",\"late\":" << late << ",\"lateMs\":" << opts.lateMs
+		<< ",\"p50Us\":" << percentile(latenciesUs, 0.5) << ",\"p99Us\":" << percentile(latenciesUs, 0.99)
+		<< ",\"maxUs\":" << (latenciesUs.empty() ? 0 : latenciesUs.back())
+		<< ",\"sendSeconds\":" << sendSeconds << ",\"writerStallMs\":" << std::chrono::duration<double, std::milli>(stalled).count()
+		<< ",\"gameFrames\":" << host.getFrames() << ",\"hitches\":" << host.getHitches() << ",\"callbacksRefused\":" << host.getRefused()
+		<< ",\"callbackRetries\":" << (numberAt(statsAfter, 6) - numberAt(statsBefore, 6))
+		<< ",\"callbacksDropped\":" << (numberAt(statsAfter, 9) - numberAt(statsBefore, 9))
+		<< ",\"policyDrops\":" << (numberAt(overflowAfter, 0) - numberAt(overflowBefore, 0)) << "}" << std::endl;
+}
+
+//times the commands SQF calls most, straight through `RVExtensionArgs`, `--frames` calls each. the writes are plain,
+//unthreaded ones, so each call includes sending its two bytes
+static void runDispatch(Extension& ext, const std::string& writerId, LineCounter& counter, const std::string& transport,
+	const Options& opts, std::ostream& out)
+{
+	const int calls = opts.frames;
+	for (const char* command : { "isConnected", "write" }) {
+		bool write = strcmp(command, "write") == 0;
+		std::vector<std::string> args = { command };
+		if (write) {
+			args.push_back("x\n");
+			counter.start();
+		}
+		std::vector<double> callUs;
+		callUs.reserve(calls);
+		auto start = Clock::now();
+		for (int i = 0; i < calls; i++) {
+			auto before = Clock::now();
+			ext.call(writerId, args);
+			callUs.push_back(std::chrono::duration<double, std::micro>(Clock::now() - before).count());
+		}
+		double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		//everything written has to be out of the way before the next case
+		if (write) {
+			if (counter.await(calls) < (size_t)calls) lostFrames = true;
+			counter.stop();
+		}
+		std::sort(callUs.begin(), callUs.end());
+		out << "{\"transport\":\"" << transport << "\",\"mode\":\"dispatch\",\"command\":\"" << command << "\",\"calls\":" << calls
+			<< ",\"usPerCall\":" << seconds * 1e6 / calls << ",\"p50Us\":" << percentile(callUs, 0.5) << ",\"p99Us\":" << percentile(callUs, 0.99)
+			<< ",\"maxUs\":" << (callUs.empty() ? 0 : callUs.back()) << "}" << std::endl;
+	}
+}
+
+//times `write` with threaded writes on, while `writers` threads write at once, and how long it takes until everything
+//they wrote has come out the other end
+static void runThreadedWrites(Extension& ext, const std::string& writerId, LineCounter& counter, const std::string& transport,
+	const Options& opts, std::ostream& out)
+{
+	const int writers = 4;
+	const int perWriter = opts.frames / writers;
+	std::string res = ext.call(writerId, { "enableThreadedWrites" });
+	if (res.rfind("[\"SUCCESS\"", 0) != 0) {
+		std::cerr << transport << ": skipped threadedWrites: " << res << std::endl;
+		return;
+	}
+	counter.start();
+	std::vector<std::vector<double>> callUs(writers);
+	std::vector<std::thread> threads;
+	auto start = Clock::now();
+	for (int w = 0; w < writers; w++) {
+		threads.emplace_back([&, w]() {
+			callUs[w].reserve(perWriter);
+			for (int i = 0; i < perWriter; i++) {
+				char line[32];
+				snprintf(line, sizeof(line), "%d %0*d\n", w, seqDigits, i);
+				auto before = Clock::now();
+				ext.call(writerId, { "write", line });
+				callUs[w].push_back(std::chrono::duration<double, std::micro>(Clock::now() - before).count());
+			}
+		});
+	}
+	for (auto& t : threads) t.join();
+	int sent = writers * perWriter;
+	size_t received = counter.await(sent);
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	counter.stop();
+	//serial can't turn threaded writes back off, which is why this runs last
+	ext.call(writerId, { "disableThreadedWrites" });
+	std::vector<double> all;
+	for (auto& us : callUs) all.insert(all.end(), us.begin(), us.end());
+	std::sort(all.begin(), all.end());
+	if (received < (size_t)sent) lostFrames = true;
+	out << "{\"transport\":\"" << transport << "\",\"mode\":\"threadedWrites\",\"writers\":" << writers << ",\"sent\":" << sent
+		<< ",\"received\":" << received << ",\"writesPerSec\":" << received / seconds
+		<< ",\"callP50Us\":" << percentile(all, 0.5) << ",\"callP99Us\":" << percentile(all, 0.99)
+		<< ",\"callMaxUs\":" << (all.empty() ? 0 : all.back()) << "}" << std::endl;
+}
+
+//the cases for `--micro` that go through a connection. `writerId` is the instance whose writes arrive at `counter`
+static void runMicro(Extension& ext, Sender& sender, const std::string& receiverId, const std::string& writerId, LineCounter& counter,
+	const std::string& transport, const Options& opts, std::ostream& out)
+{
+	//how fast the extension reads and frames data that's already waiting, with the frames arriving in one big write
+	const size_t payload = 200;
+	configureFraming(ext, receiverId, Framing::CHAR, payload);
+	Result bulk = runFrames(sender, Framing::CHAR, payload, opts.frames, true, true);
+	report(out, transport, Framing::CHAR, payload, "readThroughput", opts.frames, bulk);
+	runDispatch(ext, writerId, counter, transport, opts, out);
+	runThreadedWrites(ext, writerId, counter, transport, opts, out);
+}
+
+static void run(Extension& ext, Sender& sender, const std::string& receiverId, const std::string& writerId, LineCounter& counter,
+	const std::string& transport, const Options& opts, std::ostream& out)
+{
+	if (opts.sim) runSim(ext, sender, receiverId, transport, opts, out);
+	else if (opts.micro) runMicro(ext, sender, receiverId, writerId, counter, transport, opts, out);
+	else {
+		measureIdle(transport, opts, out);
+		runAll(ext, sender, receiverId, transport, opts, out);
+	}
+}
+
+static void benchTcp(Extension& ext, const Options& opts, std::ostream& out)
+{
+	std::string port = std::to_string(opts.port);
+	std::string server = ext.call("tcpserver", { "create", port });
+	ext.call(server, { "listen" });
+	std::string client = ext.call("tcpclient", { "create", "127.0.0.1", port });
+	std::string res = ext.call(client, { "connect" });
+	if (res.rfind("[\"SUCCESS\"", 0) != 0) {
+		std::cerr << "tcp: couldn't connect: " << res << std::endl;
+		return;
+	}
+	//`["serverID", "connectionID"]`
+	std::string conn = awaitCallback("new_tcp_connection");
+	size_t idStart = conn.find("\", \"");
+	if (idStart == std::string::npos) {
+		std::cerr << "tcp: the server never reported the connection" << std::endl;
+		return;
+	}
+	conn = conn.substr(idStart + 4, conn.length() - idStart - 6);
+	ExtensionSender sender(ext, client);
+	CallbackLineCounter counter(ext, conn);
+	run(ext, sender, conn, client, counter, "tcp", opts, out);
+	ext.call(client, { "disconnect" });
+	ext.call(server, { "disconnectAll" });
+	ext.call(server, { "stopListening" });
+	ext.call("destroy", { client });
+	ext.call("destroy", { server });
+}
+
+#ifndef _WIN32
+//opens a pseudo-terminal, whose slave side ArmaCOM opens as a serial port while we write to the master side
+static bool openPseudoTerminal(int& master, int& slave, std::string& slaveName)
+{
+	char name[256];
+	if (openpty(&master, &slave, name, nullptr, nullptr) != 0) return false;
+	//raw mode on our side too, so the line discipline doesn't translate or echo anything
+	termios tio;
+	tcgetattr(master, &tio);
+	cfmakeraw(&tio);
+	tcsetattr(master, TCSANOW, &tio);
+	slaveName = name;
+	return true;
+}
+#endif
+
+static void benchSerial(Extension& ext, const Options& opts, std::ostream& out)
+{
+	PortSender sender;
+	std::string portName;
+#ifdef _WIN32
+	if (opts.serialPort.empty() || !sender.open(opts.serialPeer)) {
+		std::cerr << "serial: skipped, pass --serial <port ArmaCOM opens> <port to write to> (e.g. a com0com pair)" << std::endl;
+		return;
+	}
+	portName = opts.serialPort;
+#else
+	int slave;
+	if (!openPseudoTerminal(sender.fd, slave, portName)) {
+		std::cerr << "serial: skipped, couldn't open a pseudo-terminal" << std::endl;
+		return;
+	}
+#endif
+	std::string id = ext.call("serial", { "create", portName });
+	//serial's connect replies with a plain message rather than a SUCCESS array
+	std::string res = ext.call(id, { "connect" });
+	if (ext.call(id, { "isConnected" }) != "1") {
+		std::cerr << "serial: couldn't connect to " << portName << ": " << res << std::endl;
+		return;
+	}
+	PortLineCounter counter(sender);
+	run(ext, sender, id, id, counter, "serial", opts, out);
+	ext.call(id, { "disconnect" });
+	ext.call("destroy", { id });
+#ifndef _WIN32
+	close(slave);
+#endif
+}
+
+//whether a scaling run lost frames or needed more threads for more ports, for `--check`
+static bool scalingFailed = false;
+
+//opens `count` serial ports at once, each with its own framing, and measures what they cost idle and while frames
+//are spread across all of them at a fixed total rate. the number of threads and the CPU used shouldn't grow with `count`
+static void runScaling(Extension& ext, int count, const Options& opts, std::ostream& out, long long& firstThreads)
+{
+#ifdef _WIN32
+	std::cerr << "serial: --ports needs pseudo-terminals, so it only runs on Linux" << std::endl;
+#else
+	const size_t payload = 64;
+	std::vector<PortSender> senders(count);
+	std::vector<int> slaves;
+	std::vector<std::string> ids;
+	for (int i = 0; i < count; i++) {
+		int slave;
+		std::string name;
+		if (!openPseudoTerminal(senders[i].fd, slave, name)) {
+			std::cerr << "serial: couldn't open pseudo-terminal " << i << " of " << count << std::endl;
+			break;
+		}
+		slaves.push_back(slave);
+		std::string id = ext.call("serial", { "create", name });
+		std::string res = ext.call(id, { "connect" });
+		if (ext.call(id, { "isConnected" }) != "1") {
+			std::cerr << "serial: couldn't connect to " << name << ": " << res << std::endl;
+			ext.call("destroy", { id });
+			break;
+		}
+		configureFraming(ext, id, (Framing)(i % 4), payload);
+		ids.push_back(id);
+	}
+	{
+		std::unique_lock<std::mutex> lock(inbox.mutex);
+		inbox.functions.clear();
+		inbox.data.clear();
+		inbox.times.clear();
+	}
+	long long switchesBefore, switchesAfter, threads = -1;
+	double idleWakeups = 0, idleCpu = 0;
+	if (opts.idleSeconds > 0) {
+		threadActivity(switchesBefore, threads);
+		double cpuBefore = cpuSeconds();
+		std::this_thread::sleep_for(std::chrono::duration<double>(opts.idleSeconds));
+		idleCpu = 100 * (cpuSeconds() - cpuBefore) / opts.idleSeconds;
+		threadActivity(switchesAfter, threads);
+		idleWakeups = (switchesAfter - switchesBefore - 1) / opts.idleSeconds;
+	}
+	//the same total rate however many ports there are, taking turns so frames for different ports are interleaved
+	int sent = (int)(opts.scaleRate * opts.scaleSeconds);
+	std::vector<Clock::time_point> sentAt(sent);
+	auto start = Clock::now();
+	double cpuBefore = cpuSeconds();
+	threadActivity(switchesBefore, threads);
+	for (int seq = 0; seq < sent && !ids.empty(); seq++) {
+		std::this_thread::sleep_until(start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seq / opts.scaleRate)));
+		size_t port = seq % ids.size();
+		sentAt[seq] = Clock::now();
+		senders[port].send(makeFrame((Framing)(port % 4), payload, seq));
+	}
+	Result r;
+	std::vector<bool> matched(sent, false);
+	size_t seen = 0;
+	{
+		std::unique_lock<std::mutex> lock(inbox.mutex);
+		inbox.received.wait_for(lock, std::chrono::seconds(10), [&]() {
+			for (; seen < inbox.data.size(); seen++) {
+				int seq = frameSeq(inbox.data[seen]);
+				if (inbox.functions[seen] != "data_read" || seq < 0 || seq >= sent || matched[seq]) continue;
+				matched[seq] = true;
+				r.received++;
+				r.latenciesUs.push_back(std::chrono::duration<double, std::micro>(inbox.times[seen] - sentAt[seq]).count());
+			}
+			return r.received == (size_t)sent;
+		});
+	}
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	double busyCpu = 100 * (cpuSeconds() - cpuBefore) / seconds;
+	threadActivity(switchesAfter, threads);
+	std::sort(r.latenciesUs.begin(), r.latenciesUs.end());
+	out << "{\"transport\":\"serial\",\"mode\":\"scaling\",\"ports\":" << ids.size() << ",\"payloadBytes\":" << payload;
+	if (switchesAfter >= 0) out << ",\"threads\":" << threads << ",\"idleWakeupsPerSec\":" << idleWakeups;
+	out << ",\"idleCpuPercent\":" << idleCpu << ",\"sent\":" << sent << ",\"received\":" << r.received << ",\"busyCpuPercent\":" << busyCpu;
+	if (switchesAfter >= 0) out << ",\"busyWakeupsPerSec\":" << (switchesAfter - switchesBefore) / seconds;
+	out << ",\"p50Us\":" << percentile(r.latenciesUs, 0.5) << ",\"p99Us\":" << percentile(r.latenciesUs, 0.99) << "}" << std::endl;
+	if (r.received < (size_t)sent || (int)ids.size() < count) scalingFailed = true;
+	if (firstThreads < 0) firstThreads = threads;
+	else if (threads > firstThreads) scalingFailed = true;
+	for (auto& id : ids) {
+		ext.call(id, { "disconnect" });
+		ext.call("destroy", { id });
+	}
+	for (int slave : slaves) close(slave);
+#endif
+}
+
+//times `checkArray`, which parses an array and writes it back out, on arrays of 1KB to 1MB. the arrays are already in the
+//extension's output format, so each one should come back unchanged, if cut short by the output buffer
+static void runParse(Extension& ext, std::ostream& out)
+{
+	if (ext.call("checkArray", { "[1]" }, false) != "[1]") {
+		std::cerr << "parse: skipped, this build has no checkArray" << std::endl;
+		return;
+	}
+	for (size_t size : { (size_t)1 << 10, (size_t)1 << 14, (size_t)1 << 17, (size_t)1 << 20 }) {
+		//a bit of everything: strings, numbers, booleans and nested arrays
+		std::string arr = "[";
+		for (int i = 0; arr.length() < size; i++) {
+			if (i > 0) arr += ", ";
+			switch (i % 4) {
+			case 0: arr += "\"name_" + std::to_string(i) + "\""; break;
+			case 1: arr += std::to_string(i); break;
+			case 2: arr += "true"; break;
+			default: arr += "[1, \"x\", false]"; break;
+			}
+		}
+		arr += "]";
+		std::string first = ext.call("checkArray", { arr }, false);
+		if (first.empty() || arr.compare(0, first.length(), first) != 0) {
+			std::cerr << "parse: " << arr.length() << " bytes didn't come back unchanged: " << first.substr(0, 100) << std::endl;
+			lostFrames = true;
+			continue;
+		}
+		int calls = (int)(std::max)((size_t)10, ((size_t)1 << 24) / arr.length());
+		auto start = Clock::now();
+		for (int i = 0; i < calls; i++) ext.call("checkArray", { arr }, false);
+		double us = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / calls;
+		out << "{\"mode\":\"parse\",\"arrayBytes\":" << arr.length() << ",\"calls\":" << calls << ",\"usPerCall\":" << us
+			<< ",\"MBPerSec\":" << arr.length() / us << "}" << std::endl;
+	}
+}
+
+//opens `count` TCP connections to one server at once and reports how many threads the process has while they're idle,
+//and how often those threads wake up. neither should grow with `count`
+static void runConnections(Extension& ext, int count, int portNumber, const Options& opts, std::ostream& out)
+{
+	std::string port = std::to_string(portNumber);
+	std::string server = ext.call("tcpserver", { "create", port });
+	std::string res = ext.call(server, { "listen" });
+	if (res.rfind("[\"SUCCESS\"", 0) != 0) {
+		std::cerr << "tcp: couldn't listen on " << port << ": " << res << std::endl;
+		ext.call("destroy", { server });
+		lostFrames = true;
+		return;
+	}
+	{
+		std::unique_lock<std::mutex> lock(inbox.mutex);
+		inbox.functions.clear();
+		inbox.data.clear();
+		inbox.times.clear();
+	}
+	std::vector<std::string> clients;
+	for (int i = 0; i < count; i++) {
+		std::string id = ext.call("tcpclient", { "create", "127.0.0.1", port });
+		res = ext.call(id, { "connect" });
+		if (res.rfind("[\"SUCCESS\"", 0) != 0) {
+			std::cerr << "tcp: couldn't open connection " << i << " of " << count << ": " << res << std::endl;
+			ext.call("destroy", { id });
+			break;
+		}
+		clients.push_back(id);
+	}
+	//the server's side of every connection should be set up too before anything is measured
+	size_t accepted = 0;
+	{
+		std::unique_lock<std::mutex> lock(inbox.mutex);
+		inbox.received.wait_for(lock, std::chrono::seconds(10), [&]() {
+			accepted = (size_t)std::count(inbox.functions.begin(), inbox.functions.end(), "new_tcp_connection");
+			return accepted >= clients.size();
+		});
+	}
+	if (accepted < (size_t)count) lostFrames = true;
+	long long switchesBefore, switchesAfter, threads;
+	threadActivity(switchesBefore, threads);
+	double cpuBefore = cpuSeconds();
+	if (opts.idleSeconds > 0) std::this_thread::sleep_for(std::chrono::duration<double>(opts.idleSeconds));
+	double cpuAfter = cpuSeconds();
+	threadActivity(switchesAfter, threads);
+	out << "{\"transport\":\"tcp\",\"mode\":\"connections\",\"connections\":" << clients.size() << ",\"accepted\":" << accepted;
+	if (threads >= 0) out << ",\"threads\":" << threads;
+	if (opts.idleSeconds > 0) {
+		if (switchesAfter >= 0) out << ",\"idleWakeupsPerSec\":" << (switchesAfter - switchesBefore - 1) / opts.idleSeconds;
+		out << ",\"idleCpuPercent\":" << 100 * (cpuAfter - cpuBefore) / opts.idleSeconds;
+	}
+	out << "}" << std::endl;
+	for (auto& id : clients) {
+		ext.call(id, { "disconnect" });
+		ext.call("destroy", { id });
+	}
+	ext.call(server, { "disconnectAll" });
+	ext.call(server, { "stopListening" });
+	ext.call("destroy", { server });
+}
+
+//loads `--lib` and runs whatever the options ask for, returning the exit code
+static int runBench(const Options& opts, std::ostream& out)
+{
+	Extension ext;
+	if (!ext.load(opts.library)) {
+		std::cerr << "couldn't load " << opts.library << std::endl;
+		return 1;
+	}
+	if (!opts.portCounts.empty()) {
+		long long firstThreads = -1;
+		for (int count : opts.portCounts) runScaling(ext, count, opts, out, firstThreads);
+		return opts.check && scalingFailed ? 1 : 0;
+	}
+	if (opts.micro) runParse(ext, out);
+	if (opts.tcp) benchTcp(ext, opts, out);
+	if (opts.tcp && opts.micro) {
+		//a fresh port each time, since the extension won't create a second server for a port that's had one
+		for (size_t i = 0; i < opts.connectionCounts.size(); i++) runConnections(ext, opts.connectionCounts[i], opts.port + 1 + (int)i, opts, out);
+	}
+	if (opts.serial) benchSerial(ext, opts, out);
+	return opts.check && lostFrames ? 1 : 0;
+}
+
+//the fields of a result line that say which case it's for, as opposed to what was measured
+static std::string caseKey(const std::string& line)
+{
+	std::string key;
+	for (const char* field : { "transport", "framing", "payloadBytes", "mode", "profile", "policy", "ports", "connections", "command", "arrayBytes" }) {
+		std::string name = std::string("\"") + field + "\":";
+		size_t start = line.find(name);
+		if (start == std::string::npos) continue;
+		size_t end = line.find_first_of(",}", start);
+		key += line.substr(start, end - start) + ",";
+	}
+	return key;
+}
+
+static std::string quoteArg(const std::string& arg)
+{
+	return "\"" + arg + "\"";
+}
+
+//runs everything against `--baseline` in a child process first, so the two builds never share a process (and the
+//threads and CPU use measured only ever belong to one of them), then against `--lib`, and reports each case once,
+//with the baseline's result for it under "baseline"
+static int runWithBaseline(int argc, char** argv, const Options& opts, std::ostream& out)
+{
+	const std::string baselinePath = "armacom-bench-baseline.tmp";
+	std::remove(baselinePath.c_str());
+	std::string command = quoteArg(argv[0]);
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--baseline" || arg == "--lib" || arg == "--out") i++;
+		else command += " " + quoteArg(arg);
+	}
+	command += " --lib " + quoteArg(opts.baseline) + " --out " + quoteArg(baselinePath);
+#ifdef _WIN32
+	//cmd drops the outermost quotes, leaving the ones around each argument alone
+	command = "\"" + command + "\"";
+#endif
+	if (std::system(command.c_str()) != 0) std::cerr << "baseline: " << opts.baseline << " didn't run cleanly" << std::endl;
+	std::vector<std::string> baseline;
+	{
+		std::ifstream file(baselinePath);
+		std::string line;
+		while (std::getline(file, line)) {
+			if (!line.empty()) baseline.push_back(line);
+		}
+	}
+	std::remove(baselinePath.c_str());
+
+	std::stringstream current;
+	int status = runBench(opts, current);
+	std::vector<bool> used(baseline.size(), false);
+	std::string line;
+	while (std::getline(current, line)) {
+		if (line.empty() || line.back() != '}') continue;
+		std::string key = caseKey(line);
+		size_t match = 0;
+		while (match < baseline.size() && (used[match] || caseKey(baseline[match]) != key)) match++;
+		if (match == baseline.size()) {
+			out << line << std::endl;
+			continue;
+		}
+		used[match] = true;
+		out << line.substr(0, line.length() - 1) << ",\"baseline\":" << baseline[match] << "}" << std::endl;
+	}
+	//cases only the baseline had, e.g. because the current build skipped them
+	for (size_t i = 0; i < baseline.size(); i++) {
+		if (!used[i]) out << "{\"baseline\":" << baseline[i] << "}" << std::endl;
+	}
+	return status;
+}
+
+int main(int argc, char** argv)
+{
+	Options opts;
+#ifdef _WIN32
+	opts.library = "ArmaCOM_x64.dll";
+#else
+	opts.library = "./ArmaCOM_x64.so";
+#endif
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		auto next = [&]() { return i + 1 < argc ? std::string(argv[++i]) : std::string(); };
+		if (arg == "--lib") opts.library = next();
+		else if (arg == "--out") opts.outPath = next();
+		else if (arg == "--port") opts.port = std::stoi(next());
+		else if (arg == "--frames") opts.frames = std::stoi(next());
+		else if (arg == "--pings") opts.pings = std::stoi(next());
+		else if (arg == "--tcp-only") opts.serial = false;
+		else if (arg == "--serial-only") opts.tcp = false;
+		else if (arg == "--check") opts.check = true;
+		else if (arg == "--micro") opts.micro = true;
+		else if (arg == "--baseline") opts.baseline = next();
+		else if (arg == "--idle") opts.idleSeconds = std::stod(next());
+		else if (arg == "--serial") {
+			opts.serialPort = next();
+			opts.serialPeer = next();
+		}
+		else if (arg == "--payloads") {
+			opts.payloads.clear();
+			std::stringstream list(next());
+			std::string size;
+			while (std::getline(list, size, ',')) opts.payloads.push_back((size_t)std::stoul(size));
+		}
+		else if (arg == "--sim") opts.sim = true;
+		else if (arg == "--profile") opts.profile = next();
+		else if (arg == "--profile-file") opts.profileFile = next();
+		else if (arg == "--sim-payload") opts.simPayload = (size_t)std::stoul(next());
+		else if (arg == "--fps") opts.host.fps = std::stod(next());
+		else if (arg == "--sqf-cost-us") opts.host.sqfCostUs = std::stoi(next());
+		else if (arg == "--hitch") {
+			//`everyMs:lengthMs`
+			std::string hitch = next();
+			size_t colon = hitch.find(':');
+			if (colon == std::string::npos) {
+				std::cerr << "--hitch takes everyMs:lengthMs" << std::endl;
+				return 2;
+			}
+			opts.host.hitchEveryMs = std::stoi(hitch.substr(0, colon));
+			opts.host.hitchMs = std::stoi(hitch.substr(colon + 1));
+		}
+		else if (arg == "--late-ms") opts.lateMs = std::stod(next());
+		else if (arg == "--policy") opts.policy = next();
+		else if (arg == "--ports") {
+			std::stringstream list(next());
+			std::string count;
+			while (std::getline(list, count, ',')) opts.portCounts.push_back(std::stoi(count));
+		}
+		else if (arg == "--connections") {
+			opts.connectionCounts.clear();
+			std::stringstream list(next());
+			std::string count;
+			while (std::getline(list, count, ',')) opts.connectionCounts.push_back(std::stoi(count));
+		}
+		else if (arg == "--scale-rate") opts.scaleRate = std::stod(next());
+		else if (arg == "--scale-seconds") opts.scaleSeconds = std::stod(next());
+		else {
+			std::cerr << "usage: " << argv[0] << " [--lib path] [--out results.jsonl] [--port n] [--frames n] [--pings n]"
+				<< " [--payloads 16,128,...] [--tcp-only | --serial-only] [--serial port peer] [--check] [--idle seconds] [--baseline path] [--micro [--connections 1,200,...]]"
+				<< " [--sim [--profile steady|bursts|ramp | --profile-file path] [--sim-payload n] [--fps n] [--sqf-cost-us n]"
+				<< " [--hitch everyMs:lengthMs] [--late-ms n] [--policy name]] [--ports 1,8,... [--scale-rate n] [--scale-seconds n]]" << std::endl;
+			return 2;
+		}
+	}
+	std::ofstream file;
+	if (!opts.outPath.empty()) file.open(opts.outPath, std::ios::app);
+	std::ostream& out = opts.outPath.empty() ? std::cout : file;
+	if (!opts.baseline.empty()) return runWithBaseline(argc, argv, opts, out);
+	return runBench(opts, out);
+}
@@ -12,6 +12,7 @@ using NUnit.Framework;
 using System.Net.Sockets;
 using System.Net;
 using System.Diagnostics;
+using System.Runtime.InteropServices;
 
 namespace ArmaCOMTests
 {
@@ -29,10 +30,37 @@ namespace ArmaCOMTests
         public Action<string, string, string> callbackAction;
         public int nextCallbackReturn = 0;
         private bool callbackEnabled = false;
+        private string dllPath;
         public ExtensionFixture()
         {
             //we go up several levels because the VS integrated test explorer starts us in the build directory
-            this.extension = new ArmaExtension(TestContext.CurrentContext.TestDirectory + "\\..\\..\\..\\..\\x64\\Release\\ArmaCOM_x64.dll");
+            this.dllPath = TestContext.CurrentContext.TestDirectory + "\\..\\..\\..\\..\\x64\\Release\\ArmaCOM_x64.dll";
+            this.extension = new ArmaExtension(this.dllPath);
+        }
+
+        //the size of the output buffer Arma gives extensions
+        public const int OUTPUT_SIZE = 10240;
+        [DllImport("kernel32", CharSet = CharSet.Ansi)]
+        private static extern IntPtr LoadLibrary(string path);
+        [DllImport("kernel32", CharSet = CharSet.Ansi)]
+        private static extern IntPtr GetProcAddress(IntPtr module, string name);
+        [UnmanagedFunctionPointer(CallingConvention.StdCall)]
+        private delegate int RVExtensionArgsFunc(byte[] output, int outputSize, [MarshalAs(UnmanagedType.LPStr)] string function,
+            [MarshalAs(UnmanagedType.LPArray, ArraySubType = UnmanagedType.LPStr)] string[] argv, int argc);
+        private RVExtensionArgsFunc rvExtensionArgs;
+        //calls RVExtensionArgs directly, the way Arma does, so its return code can be checked too
+        public (string, int) CallArgsWithCode(string function, params string[] args)
+        {
+            if (this.rvExtensionArgs == null) {
+                //the extension is already loaded, so this just gets its handle
+                IntPtr module = LoadLibrary(this.dllPath);
+                this.rvExtensionArgs = Marshal.GetDelegateForFunctionPointer<RVExtensionArgsFunc>(GetProcAddress(module, "RVExtensionArgs"));
+            }
+            var output = new byte[OUTPUT_SIZE];
+            int code = this.rvExtensionArgs(output, OUTPUT_SIZE, function, args, args.Length);
+            string ans = Encoding.UTF8.GetString(output, 0, Array.IndexOf(output, (byte)0));
+            TestContext.Out.WriteLine($"Extension call \"{function}\" returned {ans.Length} characters and code {code}");
+            return (ans, code);
         }
         public string Call(string function)
         {
@@ -112,6 +140,93 @@ namespace ArmaCOMTests
         {
             Assert.AreEqual("ArmaCOM v2.0-beta", extension.GetVersion());
         }
+
+        [Test]
+        public void IOThreads()
+        {
+            //growing the pool always takes effect right away, whether or not it's running
+            Assert.AreEqual("[\"SUCCESS\", \"IO thread count set to 8\"]", extension.CallArgs("setIOThreads", "8"));
+            Assert.AreEqual("8", extension.CallArgs("getIOThreads"));
+            Assert.IsTrue(extension.CallArgs("setIOThreads", "0").StartsWith("[\"FAILURE\""));
+        }
+
+        [Test]
+        public void ArgumentHandling()
+        {
+            string expected = extension.CallArgs("serial", "listBaudRates");
+            //quotes Arma puts around strings are stripped
+            Assert.AreEqual(expected, extension.CallArgs("serial", "\"listBaudRates\""));
+            //more arguments than fit in the extension's stack buffer
+            var args = new[] { "listBaudRates" }.Concat(Enumerable.Repeat("\"unused\"", 20)).ToArray();
+            Assert.AreEqual(expected, extension.CallArgs("serial", args));
+        }
+
+        [Test]
+        public void CheckArray()
+        {
+            Assert.AreEqual("[]", extension.CallArgs("checkArray", " [ ] "));
+            Assert.AreEqual("[1, -2.5, true, false, [[], [\"x\"]]]", extension.CallArgs("checkArray", "[1,-2.5,TRUE,false,[[],[\"x\"]]]"));
+            //both kinds of quote, with their escapes
+            Assert.AreEqual("[\"a\"\"b\", \"c'd\"]", extension.CallArgs("checkArray", "[\"a\"\"b\", 'c''d']"));
+            Assert.AreEqual("[\"FAILURE\", \"Error parsing array at position 3: Expected a value after ','\"]", extension.CallArgs("checkArray", "[1,]"));
+            Assert.AreEqual("[\"FAILURE\", \"Error parsing array at position 4: Unterminated string\"]", extension.CallArgs("checkArray", "[1, \"abc]"));
+            //deep nesting shouldn't overflow the stack
+            string deep = new string('[', 100000) + new string(']', 100000);
+            Assert.AreEqual(deep.Substring(0, 100), extension.extension.TimedCallArgs("checkArray", new[] { deep }).Item1.Substring(0, 100));
+        }
+
+        [Test]
+        public void PagedReplies()
+        {
+            var sb = new StringBuilder("[");
+            for (int i = 0; sb.Length < 50000; i++) sb.Append(i == 0 ? "" : ", ").Append($"\"item {i}\"");
+            string arr = sb.Append("]").ToString();
+            //short replies don't need fetching
+            Assert.AreEqual(("[]", 0), extension.CallArgsWithCode("checkArray", "[]"));
+            var (reply, token) = extension.CallArgsWithCode("checkArray", arr);
+            Assert.AreEqual(ExtensionFixture.OUTPUT_SIZE - 1, reply.Length);
+            Assert.AreNotEqual(0, token);
+            int fetches = 0;
+            for (int code = token; code != 0; fetches++) {
+                string part;
+                (part, code) = extension.CallArgsWithCode("fetch", token.ToString());
+                if (code != 0) Assert.AreEqual(token, code);
+                reply += part;
+            }
+            Assert.AreEqual(arr, reply);
+            Assert.AreEqual((arr.Length - 1) / (ExtensionFixture.OUTPUT_SIZE - 1), fetches);
+            //once it's all been fetched it's gone
+            Assert.IsTrue(extension.CallArgs("fetch", token.ToString()).StartsWith("[\"FAILURE\""));
+        }
+
+        [Test]
+        public void ArrayParsingThroughput()
+        {
+            foreach (int size in new[] { 1 << 10, 1 << 14, 1 << 17, 1 << 20 }) {
+                var sb = new StringBuilder("[");
+                for (int i = 0; sb.Length < size; i++) {
+                    if (i > 0) sb.Append(", ");
+                    switch (i % 4) {
+                        case 0: sb.Append($"\"name_{i}\""); break;
+                        case 1: sb.Append(i); break;
+                        case 2: sb.Append("true"); break;
+                        case 3: sb.Append("[1, \"x\", false]"); break;
+                    }
+                }
+                string arr = sb.Append("]").ToString();
+                var args = new[] { arr };
+                //the array is already in the extension's output format, so it should come back unchanged (if cut short).
+                //the timings are only a rough guide, ArmaCOMBench's parse case compares them between builds
+                string first = extension.extension.TimedCallArgs("checkArray", args).Item1;
+                Assert.IsTrue(arr.StartsWith(first) && first.Length > 0);
+                int calls = Math.Max(10, (1 << 24) / arr.Length);
+                var stopwatch = Stopwatch.StartNew();
+                for (int i = 0; i < calls; i++) extension.extension.TimedCallArgs("checkArray", args);
+                stopwatch.Stop();
+                double perCall = stopwatch.Elapsed.TotalMilliseconds * 1000 / calls;
+                TestContext.Out.WriteLine($"{arr.Length} bytes: {perCall}us per call, {arr.Length / perCall}MB/s");
+            }
+        }
     }
 
     [NonParallelizable]
@@ -309,6 +424,38 @@ namespace ArmaCOMTests
         }
 
         [Test, Order(3)]
+        public void ThreadedWriteThroughput()
+        {
+            EnsureConnected();
+            //several threads queue writes at once to make sure none get lost or mangled, timing how long
+            //each call takes to queue its write and how long it takes for everything to come out the other end.
+            //the timings are only a rough guide, ArmaCOMBench's threadedWrites case compares them between builds
+            const int threads = 4;
+            const int perThread = 250;
+            ourPort.ReadTimeout = 10000;
+            var enqueueMs = new double[threads * perThread];
+            var stopwatch = Stopwatch.StartNew();
+            var producers = Enumerable.Range(0, threads).Select(t => Task.Run(() => {
+                for (int i = 0; i < perThread; i++) {
+                    (string ans, TimeSpan time) = extension.extension.TimedCallArgs(theirPort, "write", $"{t} {i:000}\n");
+                    enqueueMs[t * perThread + i] = time.TotalMilliseconds;
+                }
+            })).ToArray();
+            var next = new int[threads];
+            for (int i = 0; i < threads * perThread; i++) {
+                var parts = ourPort.ReadLine().Split(' ');
+                int t = int.Parse(parts[0]);
+                //writes from the same thread must stay in order
+                Assert.AreEqual(next[t]++, int.Parse(parts[1]));
+            }
+            stopwatch.Stop();
+            Task.WaitAll(producers);
+            Array.Sort(enqueueMs);
+            TestContext.Out.WriteLine($"{threads * perThread} writes in {stopwatch.Elapsed.TotalSeconds}s: {threads * perThread / stopwatch.Elapsed.TotalSeconds} writes/s");
+            TestContext.Out.WriteLine($"Enqueue time: average {enqueueMs.Average()}ms, median {enqueueMs[enqueueMs.Length / 2]}ms, max {enqueueMs.Max()}ms");
+        }
+
+        [Test, Order(Int32.MaxValue)]
         public void CanDisconnectAndDestroy()
         {
             EnsureConnected();
@@ -557,7 +704,298 @@ namespace ArmaCOMTests
             TestContext.Out.WriteLine($"Max time: {sTaken.Max()}, Min time: {sTaken.Min()}");
             //must be less than 2 seconds
             Assert.Less(sTaken.Sum(), 2);
-            
+
+        }
+
+        [Test, Order(9)]
+        public void ReadThroughput()
+        {
+            EnsureConnected();
+            extension.CallArgs(theirSocket, "callbackOnChar", "\n");
+            var reader = extension.ReadMany();
+            //5000 lines of 200 bytes each, about 1MB total, sent in as few socket writes as possible.
+            //the timing is only a rough guide, ArmaCOMBench's readThroughput case compares it between builds
+            const int lines = 5000;
+            string line = new string('x', 199) + "\n";
+            var all = new StringBuilder(lines * line.Length);
+            for (int i = 0; i < lines; i++) all.Append(line);
+            var stopwatch = Stopwatch.StartNew();
+            Write(all.ToString());
+            for (int i = 0; i < lines; i++) {
+                (_, List<object> data) = Utils.AwaitWithTimeout(reader.Read());
+                Assert.AreEqual(line.Substring(0, 199), (string)data[1]);
+            }
+            stopwatch.Stop();
+            double seconds = stopwatch.Elapsed.TotalSeconds;
+            TestContext.Out.WriteLine($"Read {lines} lines ({lines * line.Length} bytes) in {seconds}s: {lines / seconds} lines/s, {lines * line.Length / seconds / 1024} KB/s");
+        }
+
+        [Test, Order(10)]
+        public void Batching()
+        {
+            EnsureConnected();
+            extension.CallArgs(theirSocket, "callbackOnChar", "\n");
+            var reader = extension.ReadMany();
+            //hold batches back long enough that all three lines end up in the same one
+            extension.CallArgs(theirSocket, "enableBatching", "8192", "200");
+            Write("One\nTwo\nThree\n");
+            (string f, List<object> data) = Utils.AwaitWithTimeout(reader.Read());
+            Assert.AreEqual("data_read_batch", f);
+            Assert.AreEqual(theirSocket, data[0]);
+            Assert.That((List<object>)data[1], Is.EqualTo(new List<object> { "One", "Two", "Three" }));
+            extension.CallArgs(theirSocket, "disableBatching");
+            Write("Four\n");
+            (f, data) = Utils.AwaitWithTimeout(reader.Read());
+            Assert.AreEqual("data_read", f);
+            Assert.AreEqual("Four", data[1]);
+        }
+
+        [Test, Order(11)]
+        public void ThreadedWrites()
+        {
+            EnsureConnected();
+            var reader = extension.ReadMany();
+            extension.CallArgs(theirSocket, "enableThreadedWrites");
+            Assert.AreEqual("[\"SUCCESS\", \"Write successfully queued\"]", extension.CallArgs(theirSocket, "write", "One"));
+            extension.CallArgs(theirSocket, "write", "Two");
+            extension.CallArgs(theirSocket, "write", "Three");
+            string received = "";
+            while (received.Length < "OneTwoThree".Length) received += Read();
+            Assert.AreEqual("OneTwoThree", received);
+            //writes queued together are sent together, so there's one callback per send rather than per write
+            int bytes = 0;
+            while (bytes < received.Length) {
+                (string f, List<object> data) = Utils.AwaitWithTimeout(reader.Read());
+                Assert.AreEqual(theirSocket, f);
+                Assert.AreEqual("SUCCESS", data[0]);
+                bytes += int.Parse(((string)data[1]).Split(' ')[2]);
+            }
+            extension.CallArgs(theirSocket, "disableThreadedWrites");
+            extension.CallArgs(theirSocket, "write", "Four");
+            Assert.AreEqual("Four", Read());
+        }
+
+        [Test, Order(12)]
+        public void SteadyStateAllocations()
+        {
+            EnsureConnected();
+            extension.CallArgs(theirSocket, "callbackOnChar", "\n");
+            var reader = extension.ReadMany();
+            const int lines = 500;
+            string line = new string('x', 99) + "\n";
+            Action readLines = () => {
+                Write(string.Concat(Enumerable.Repeat(line, lines)));
+                for (int i = 0; i < lines; i++) Utils.AwaitWithTimeout(reader.Read());
+            };
+            //the first lot fills up the pools, after which buffers should just be reused
+            readLines();
+            var before = Utils.ParseArmaArray(extension.CallArgs(theirSocket, "getAllocationStats"));
+            readLines();
+            var after = Utils.ParseArmaArray(extension.CallArgs(theirSocket, "getAllocationStats"));
+            double allocated = Convert.ToDouble(after[0]) - Convert.ToDouble(before[0]);
+            TestContext.Out.WriteLine($"{allocated} allocations for {lines} frames once warmed up ({after[2]}/s)");
+            Assert.Less(allocated, lines / 10);
+        }
+
+        [Test, Order(13)]
+        public void DispatchCost()
+        {
+            EnsureConnected();
+            //time the hottest commands straight through the extension interface, without the logging CallArgs does.
+            //the timings are only a rough guide, ArmaCOMBench's dispatch case compares them between builds
+            const int calls = 10000;
+            foreach (var (command, arg, expected) in new[] { ("isConnected", (string)null, "1"), ("write", "x", "[\"SUCCESS\"") }) {
+                var args = arg == null ? new[] { command } : new[] { command, arg };
+                var stopwatch = Stopwatch.StartNew();
+                for (int i = 0; i < calls; i++) {
+                    //every call has to have gone through to the right command, or the timing means nothing
+                    StringAssert.StartsWith(expected, extension.extension.TimedCallArgs(theirSocket, args).Item1);
+                }
+                stopwatch.Stop();
+                TestContext.Out.WriteLine($"{command}: {stopwatch.Elapsed.TotalMilliseconds * 1000 / calls}us per call");
+            }
+            //drain what the writes sent so later tests start clean
+            int received = 0;
+            while (received < calls) received += Read().Length;
+        }
+
+        [Test, Order(14)]
+        public void CallbackOnLengthPrefix()
+        {
+            EnsureConnected();
+            var reader = extension.ReadMany();
+            //2 byte big endian lengths, with a frame split across writes
+            extension.CallArgs(theirSocket, "callbackOnLengthPrefix", "2");
+            Write("\u0000\u0005hello\u0000\u0003ab");
+            (_, List<object> data) = Utils.AwaitWithTimeout(reader.Read());
+            Assert.AreEqual("hello", data[1]);
+            Write("c");
+            (_, data) = Utils.AwaitWithTimeout(reader.Read());
+            Assert.AreEqual("abc", data[1]);
+
+            //a type byte before a 1 byte length, sent along with the frame
+            extension.CallArgs(theirSocket, "callbackOnLengthPrefix", "1", "false", "1", "true");
+            Write("T\u0002hi");
+            (_, data) = Utils.AwaitWithTimeout(reader.Read());
+            Assert.AreEqual("T\u0002hi", data[1]);
+
+            //frames over the limit are reported and skipped, and the next frame still comes through
+            extension.CallArgs(theirSocket, "callbackOnLengthPrefix", "1", "true", "0", "false", "4");
+            Write("\u0006toobig\u0002ok");
+            (string function, List<object> error) = Utils.AwaitWithTimeout(reader.Read());
+            Assert.AreEqual(theirSocket, function);
+            Assert.AreEqual("FAILURE", error[0]);
+            (_, data) = Utils.AwaitWithTimeout(reader.Read());
+            Assert.AreEqual("ok", data[1]);
+
+            Assert.IsTrue(extension.CallArgs(theirSocket, "callbackOnLengthPrefix", "3").StartsWith("[\"FAILURE\""));
+        }
+
+        [Test, Order(15)]
+        public void CallbackOnString()
+        {
+            EnsureConnected();
+            var reader = extension.ReadMany();
+            extension.CallArgs(theirSocket, "callbackOnString", "\r\n");
+            //a lone \r or \n isn't a delimiter, and one can be split across reads
+            Write("a\rb\nc\r");
+            Thread.Sleep(100);
+            Write("\nd\r\n");
+            (_, List<object> data) = Utils.AwaitWithTimeout(reader.Read());
+            Assert.AreEqual("a\rb\nc", data[1]);
+            (_, data) = Utils.AwaitWithTimeout(reader.Read());
+            Assert.AreEqual("d", data[1]);
+
+            extension.CallArgs(theirSocket, "callbackOnString", "</msg>");
+            Write("<msg>one</m");
+            Thread.Sleep(100);
+            Write("sg><msg>two</msg>");
+            (_, data) = Utils.AwaitWithTimeout(reader.Read());
+            Assert.AreEqual("<msg>one", data[1]);
+            (_, data) = Utils.AwaitWithTimeout(reader.Read());
+            Assert.AreEqual("<msg>two", data[1]);
+
+            Assert.IsTrue(extension.CallArgs(theirSocket, "callbackOnString", new string('x', 16)).StartsWith("[\"FAILURE\""));
+        }
+
+        [Test, Order(16)]
+        public void Polling()
+        {
+            EnsureConnected();
+            var reader = extension.ReadMany();
+            extension.CallArgs(theirSocket, "callbackOnChar", "\n");
+            extension.CallArgs(theirSocket, "enablePolling", "3");
+            Assert.AreEqual("[[], 0]", extension.CallArgs(theirSocket, "readAvailable"));
+            //more frames than the limit, which just makes the extension stop reading until some are collected
+            const int frames = 20;
+            Write(string.Concat(Enumerable.Range(0, frames).Select(i => $"frame {i}\n")));
+            var received = new List<object>();
+            var stopwatch = Stopwatch.StartNew();
+            while (received.Count < frames && stopwatch.ElapsedMilliseconds < 5000) {
+                var ans = Utils.ParseArmaArray(extension.CallArgs(theirSocket, "readAvailable"));
+                received.AddRange((List<object>)ans[0]);
+                Thread.Sleep(10);
+            }
+            CollectionAssert.AreEqual(Enumerable.Range(0, frames).Select(i => $"frame {i}"), received);
+            //none of them should have come through the callback
+            Assert.IsFalse(reader.Read().Wait(100));
+
+            extension.CallArgs(theirSocket, "disablePolling");
+            Write("after\n");
+            (_, List<object> data) = Utils.AwaitWithTimeout(reader.Read());
+            Assert.AreEqual("after", data[1]);
+        }
+
+        [Test, Order(17)]
+        public void OverflowPolicies()
+        {
+            EnsureConnected();
+            extension.CallArgs(theirSocket, "callbackOnChar", "\n");
+            extension.CallArgs(theirSocket, "enablePolling");
+            StringAssert.StartsWith("[\"FAILURE\"", extension.CallArgs(theirSocket, "setOverflowPolicy", "sometimes"));
+            Assert.AreEqual("[0, 0, 0]", extension.CallArgs(theirSocket, "getOverflowStats"));
+
+            //writes the frames, waits until they've all been either queued or dropped, then collects whatever is waiting
+            List<object> WriteAndCollect(string prefix, int frames, int expectedDropped) {
+                Write(string.Concat(Enumerable.Range(0, frames).Select(i => $"{prefix}{i}\n")));
+                var stopwatch = Stopwatch.StartNew();
+                while (stopwatch.ElapsedMilliseconds < 5000) {
+                    var stats = Utils.ParseArmaArray(extension.CallArgs(theirSocket, "getOverflowStats"));
+                    if (Convert.ToInt32(stats[0]) >= expectedDropped) break;
+                    Thread.Sleep(10);
+                }
+                var ans = Utils.ParseArmaArray(extension.CallArgs(theirSocket, "readAvailable"));
+                return (List<object>)ans[0];
+            }
+
+            StringAssert.StartsWith("[\"SUCCESS\"", extension.CallArgs(theirSocket, "setOverflowPolicy", "dropNewest", "3"));
+            CollectionAssert.AreEqual(new[] { "a0", "a1", "a2" }, WriteAndCollect("a", 10, 7));
+            Assert.AreEqual("[7, 14, 0]", extension.CallArgs(theirSocket, "getOverflowStats"));
+
+            extension.CallArgs(theirSocket, "setOverflowPolicy", "dropOldest", "3");
+            CollectionAssert.AreEqual(new[] { "b2", "b3", "b4" }, WriteAndCollect("b", 5, 9));
+
+            extension.CallArgs(theirSocket, "setOverflowPolicy", "conflateLatest", "3");
+            CollectionAssert.AreEqual(new[] { "c0", "c1", "c4" }, WriteAndCollect("c", 5, 11));
+            Assert.AreEqual("[11, 22, 0]", extension.CallArgs(theirSocket, "getOverflowStats"));
+
+            extension.CallArgs(theirSocket, "setOverflowPolicy", "block");
+            extension.CallArgs(theirSocket, "disablePolling");
+        }
+
+        [Test, Order(18)]
+        public void Stats()
+        {
+            EnsureConnected();
+            extension.CallArgs(theirSocket, "callbackOnChar", "\n");
+            var reader = extension.ReadMany();
+            var before = Utils.ParseArmaArray(extension.CallArgs(theirSocket, "getStats")).Select(Convert.ToInt64).ToList();
+            Assert.AreEqual(10, before.Count);
+            Write("One\nTwo\n");
+            Utils.AwaitWithTimeout(reader.Read());
+            Utils.AwaitWithTimeout(reader.Read());
+            extension.CallArgs(theirSocket, "write", "Three");
+            Assert.AreEqual("Three", Read());
+            var after = Utils.ParseArmaArray(extension.CallArgs(theirSocket, "getStats")).Select(Convert.ToInt64).ToList();
+            //bytesIn, framesIn, bytesOut, writesQueued, writesCompleted, then nothing left in the write queue
+            Assert.AreEqual(8, after[0] - before[0]);
+            Assert.AreEqual(2, after[1] - before[1]);
+            Assert.AreEqual(5, after[2] - before[2]);
+            Assert.AreEqual(1, after[3] - before[3]);
+            Assert.AreEqual(1, after[4] - before[4]);
+            Assert.AreEqual(0, after[5]);
+            //the global totals include this instance
+            var total = Utils.ParseArmaArray(extension.CallArgs("stats")).Select(Convert.ToInt64).ToList();
+            Assert.AreEqual(11, total.Count);
+            Assert.GreaterOrEqual(total[0], after[0]);
+        }
+
+        [Test, Order(19)]
+        public void Latency()
+        {
+            EnsureConnected();
+            extension.CallArgs(theirSocket, "callbackOnChar", "\n");
+            var reader = extension.ReadMany();
+            StringAssert.StartsWith("[\"SUCCESS\"", extension.CallArgs(theirSocket, "resetLatency"));
+            Assert.AreEqual("[[0, 0, 0, 0, 0], [0, 0, 0, 0, 0]]", extension.CallArgs(theirSocket, "getLatency"));
+            Write("One\n");
+            Utils.AwaitWithTimeout(reader.Read());
+            extension.CallArgs(theirSocket, "write", "Two");
+            Assert.AreEqual("Two", Read());
+            //the callback's latency is recorded just after Arma accepts it, which may be a moment after we see it
+            List<object> ans = null;
+            var stopwatch = Stopwatch.StartNew();
+            do {
+                ans = Utils.ParseArmaArray(extension.CallArgs(theirSocket, "getLatency"));
+            } while (Convert.ToInt64(((List<object>)ans[0])[0]) == 0 && stopwatch.ElapsedMilliseconds < 1000);
+            foreach (List<object> hist in ans) {
+                var values = hist.Select(Convert.ToInt64).ToList();
+                Assert.AreEqual(1, values[0]);
+                //with one value every percentile is that value
+                Assert.AreEqual(values[4], values[1]);
+                //nothing here should take anywhere near a second
+                Assert.Less(values[4], 1000000);
+            }
         }
 
         [Test, Order(Int32.MaxValue)]
@@ -745,6 +1183,43 @@ namespace ArmaCOMTests
             extension.CallArgs("destroy", theirC);
         }
 
+        [Test, Order(5)]
+        public void ManyConnections()
+        {
+            EnsureConnected();
+            //reads are done on the shared io_context, so thousands of connections shouldn't mean thousands of threads
+            const int count = 2000;
+            var reader = extension.ReadMany();
+            int threadsBefore = Process.GetCurrentProcess().Threads.Count;
+            var clients = new List<TcpClient>();
+            var conns = new List<string>();
+            for (int i = 0; i < count; i++) {
+                TcpClient c = new TcpClient();
+                c.Connect("localhost", Settings.TCP_PORT);
+                clients.Add(c);
+                (string f, List<object> args) = Utils.AwaitWithTimeout(reader.Read());
+                Assert.AreEqual("new_tcp_connection", f);
+                conns.Add((string)args[1]);
+            }
+            int threadsAfter = Process.GetCurrentProcess().Threads.Count;
+            TestContext.Out.WriteLine($"Threads with {count} connections open: {threadsAfter} (was {threadsBefore})");
+            Assert.Less(threadsAfter - threadsBefore, 50);
+
+            //every connection should still be reading
+            var message = Encoding.ASCII.GetBytes("Many\n");
+            clients[count - 1].GetStream().Write(message, 0, message.Length);
+            (string func, List<object> data) = Utils.AwaitWithTimeout(reader.Read());
+            Assert.AreEqual("data_read", func);
+            Assert.AreEqual(conns[count - 1], data[0]);
+            Assert.AreEqual("Many", data[1]);
+
+            foreach (var conn in conns) {
+                extension.CallArgs(conn, "disconnect");
+                extension.CallArgs("destroy", conn);
+            }
+            foreach (var c in clients) c.Close();
+        }
+
         [Test, Order(Int32.MaxValue)]
         public void CanDisconnectAndDestroy()
         {
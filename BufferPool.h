@@ -0,0 +1,122 @@
+#pragma once
+#include <mutex>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <cstdint>
+#include "WriteQueue.h"
+
+//recycles write nodes and frame strings so a handler that's been running for a while doesn't touch the heap at all.
+//buffers are kept in size classes (64 bytes up to 64KB, each 4x the last) so small messages don't tie up big buffers
+//and big messages don't have to regrow small ones. anything bigger than the largest class goes straight to the heap.
+class BufferPool {
+private:
+	static const int classCount = 6;
+	static const size_t smallestClass = 64;
+	//at most this many spare buffers are kept per class, so a burst doesn't pin memory forever
+	static const size_t maxSpares = 128;
+
+	//must be held to touch the spare lists
+	std::mutex mutex;
+	std::vector<QueuedWrite*> spareWrites[classCount];
+	std::vector<std::string> spareStrings[classCount];
+
+	//number of buffers that had to come from the heap
+	std::atomic<uint64_t> allocations;
+	//number of buffers handed out from the spare lists instead
+	std::atomic<uint64_t> reuses;
+
+	static size_t classSize(int c) {
+		return smallestClass << (2 * c);
+	}
+	//the smallest class that can hold `size` bytes, or `classCount` if none can
+	static int classFor(size_t size) {
+		for (int c = 0; c < classCount; c++) {
+			if (size <= classSize(c)) return c;
+		}
+		return classCount;
+	}
+	//the largest class a buffer with this capacity can serve, or -1 if it's too small (or big) to keep
+	static int classOfCapacity(size_t capacity) {
+		if (capacity > classSize(classCount - 1) * 4) return -1;
+		for (int c = classCount - 1; c >= 0; c--) {
+			if (capacity >= classSize(c)) return c;
+		}
+		return -1;
+	}
+public:
+	BufferPool() : allocations(0), reuses(0) {}
+	~BufferPool() {
+		for (auto& spares : spareWrites) {
+			for (auto w : spares) delete w;
+		}
+	}
+
+	//returns an empty string that can hold at least `size` bytes without reallocating
+	std::string acquireString(size_t size) {
+		int c = classFor(size);
+		if (c < classCount) {
+			std::unique_lock<std::mutex> lock(this->mutex);
+			if (!this->spareStrings[c].empty()) {
+				std::string s = std::move(this->spareStrings[c].back());
+				this->spareStrings[c].pop_back();
+				lock.unlock();
+				this->reuses++;
+				s.clear();
+				return s;
+			}
+		}
+		this->allocations++;
+		std::string s;
+		s.reserve(c < classCount ? classSize(c) : size);
+		return s;
+	}
+	void releaseString(std::string&& s) {
+		int c = classOfCapacity(s.capacity());
+		if (c < 0) return;
+		std::unique_lock<std::mutex> lock(this->mutex);
+		if (this->spareStrings[c].size() < maxSpares) this->spareStrings[c].push_back(std::move(s));
+	}
+
+	//returns a write node holding a copy of `data`
+	QueuedWrite* acquireWrite(const char* data, size_t len) {
+		QueuedWrite* w = nullptr;
+		int c = classFor(len);
+		if (c < classCount) {
+			std::unique_lock<std::mutex> lock(this->mutex);
+			if (!this->spareWrites[c].empty()) {
+				w = this->spareWrites[c].back();
+				this->spareWrites[c].pop_back();
+			}
+		}
+		if (w != nullptr) {
+			this->reuses++;
+		}
+		else {
+			this->allocations++;
+			w = new QueuedWrite();
+			w->data.reserve(c < classCount ? classSize(c) : len);
+		}
+		w->next.store(nullptr, std::memory_order_relaxed);
+		w->data.assign(data, len);
+		return w;
+	}
+	void releaseWrite(QueuedWrite* w) {
+		int c = classOfCapacity(w->data.capacity());
+		if (c >= 0) {
+			std::unique_lock<std::mutex> lock(this->mutex);
+			if (this->spareWrites[c].size() < maxSpares) {
+				this->spareWrites[c].push_back(w);
+				return;
+			}
+		}
+		delete w;
+	}
+
+	uint64_t getAllocations() {
+		return this->allocations.load();
+	}
+	uint64_t getReuses() {
+		return this->reuses.load();
+	}
+};
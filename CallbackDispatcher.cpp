@@ -0,0 +1,210 @@
+#include "CallbackDispatcher.h"
+#include "util.h"
+#include "Tracer.h"
+#include <chrono>
+
+extern ArmaCallback callback;
+
+//the longest we'll wait between attempts when Arma says its buffer is full. Arma empties its buffer once
+//per frame, so there's no point waiting much longer than a frame at 60 FPS.
+static const std::chrono::milliseconds maxBackoff(8);
+
+CallbackDispatcher::CallbackDispatcher()
+{
+	//the dispatcher lives as long as the extension is loaded, so the thread is never joined
+	this->dispatchThread = new std::thread([](CallbackDispatcher* d) { d->dispatchThreadFunction(); }, this);
+}
+
+CallbackDispatcher& CallbackDispatcher::get()
+{
+	//intentionally never freed so the dispatch thread can't outlive the object it's using
+	static CallbackDispatcher* instance = new CallbackDispatcher();
+	return *instance;
+}
+
+void CallbackDispatcher::waitForSpace(std::unique_lock<std::mutex>& lock)
+{
+	this->notFull.wait(lock, [this]() { return this->queue.size() < capacity; });
+}
+
+bool CallbackDispatcher::dropIfOverloaded(const std::shared_ptr<IOStats>& stats)
+{
+	if (this->queue.size() < postCapacity) return false;
+	IOStats::add(this->drops);
+	if (stats) IOStats::add(stats->read.callbacksDropped);
+	return true;
+}
+
+void CallbackDispatcher::enqueue(const char* function, std::string&& data, const std::string& batchId,
+	std::chrono::steady_clock::time_point readyAt, const std::shared_ptr<BufferPool>& pool, const std::shared_ptr<IOStats>& stats,
+	std::chrono::steady_clock::time_point readAt)
+{
+	if (this->spareNodes.empty()) this->queue.emplace_back();
+	else this->queue.splice(this->queue.end(), this->spareNodes, this->spareNodes.begin());
+	Message& msg = this->queue.back();
+	//assigning rather than constructing lets the strings reuse whatever capacity the node had left over
+	msg.function.assign(function);
+	msg.data = std::move(data);
+	msg.batchId.assign(batchId);
+	msg.readyAt = readyAt;
+	msg.pool = pool;
+	msg.stats = stats;
+	msg.readAt = readAt;
+}
+
+void CallbackDispatcher::send(const char* function, std::string data, std::shared_ptr<BufferPool> pool, std::shared_ptr<IOStats> stats,
+	std::chrono::steady_clock::time_point readAt)
+{
+	{
+		std::unique_lock<std::mutex> lock(this->queueMutex);
+		waitForSpace(lock);
+		enqueue(function, std::move(data), "", std::chrono::steady_clock::now(), pool, stats, readAt);
+	}
+	this->notEmpty.notify_one();
+}
+
+void CallbackDispatcher::post(const char* function, std::string data, std::shared_ptr<BufferPool> pool, std::shared_ptr<IOStats> stats,
+	std::chrono::steady_clock::time_point readAt)
+{
+	{
+		std::unique_lock<std::mutex> lock(this->queueMutex);
+		if (dropIfOverloaded(stats)) {
+			lock.unlock();
+			if (pool) pool->releaseString(std::move(data));
+			return;
+		}
+		enqueue(function, std::move(data), "", std::chrono::steady_clock::now(), pool, stats, readAt);
+	}
+	this->notEmpty.notify_one();
+}
+
+void CallbackDispatcher::sendBatched(const std::string& id, const char* frame, size_t len, const BatchOptions& options, bool wait,
+	const std::shared_ptr<BufferPool>& pool, const std::shared_ptr<IOStats>& stats, std::chrono::steady_clock::time_point readAt)
+{
+	auto now = std::chrono::steady_clock::now();
+	{
+		std::unique_lock<std::mutex> lock(this->queueMutex);
+		auto open = this->openBatches.find(id);
+		if (open != this->openBatches.end()) {
+			Message* batch = open->second;
+			//+2 for the quotes, +2 for the separator, +2 for the closing brackets added when it's sent
+			if (batch->data.length() + len + 6 <= options.maxBytes) {
+				batch->data.append(", \"").append(frame, len).append("\"");
+				return;
+			}
+			//full, so close it off and let it go out right away
+			batch->readyAt = now;
+			this->openBatches.erase(open);
+		}
+		if (wait) waitForSpace(lock);
+		else if (dropIfOverloaded(stats)) return;
+		//sized for just the first frame (+10 for the brackets, quotes and separator around it) rather than the whole of
+		//`options.maxBytes`, so batches that never fill up don't each hold a buffer that big. later frames grow it as needed
+		std::string data = pool->acquireString(id.length() + len + 10);
+		data.append("[\"").append(id).append("\", [\"").append(frame, len).append("\"");
+		enqueue("data_read_batch", std::move(data), id, now + std::chrono::milliseconds(options.maxLatencyMs), pool, stats, readAt);
+		this->openBatches[id] = &this->queue.back();
+	}
+	this->notEmpty.notify_one();
+}
+
+std::list<CallbackDispatcher::Message>::iterator CallbackDispatcher::findReady(std::chrono::steady_clock::time_point& wakeAt)
+{
+	auto now = std::chrono::steady_clock::now();
+	wakeAt = std::chrono::steady_clock::time_point::max();
+	//usually the first message is ready, but a batch waiting for more frames shouldn't hold up anyone else
+	for (auto it = this->queue.begin(); it != this->queue.end(); it++) {
+		if (it->readyAt <= now) return it;
+		if (it->readyAt < wakeAt) wakeAt = it->readyAt;
+	}
+	return this->queue.end();
+}
+
+size_t CallbackDispatcher::queued()
+{
+	std::unique_lock<std::mutex> lock(this->queueMutex);
+	return this->queue.size();
+}
+
+bool CallbackDispatcher::full()
+{
+	std::unique_lock<std::mutex> lock(this->queueMutex);
+	return this->queue.size() >= capacity;
+}
+
+bool CallbackDispatcher::offer(const Message& msg)
+{
+	TRACE_SCOPE_DETAIL("callback", msg.function);
+	return callback("ArmaCOM", msg.function.c_str(), msg.data.c_str()) != -1;
+}
+
+uint64_t CallbackDispatcher::retried()
+{
+	return this->retries.load(std::memory_order_relaxed);
+}
+
+uint64_t CallbackDispatcher::dropped()
+{
+	return this->drops.load(std::memory_order_relaxed);
+}
+
+void CallbackDispatcher::setCallback(ArmaCallback c)
+{
+	{
+		//set under the lock the dispatch thread checks it with, so it can't miss the notification
+		std::unique_lock<std::mutex> lock(this->queueMutex);
+		callback = c;
+	}
+	this->registered.notify_all();
+}
+
+void CallbackDispatcher::dispatchThreadFunction()
+{
+	TRACE_THREAD_NAME("dispatcher");
+	while (true) {
+		Message* msg = &this->delivered[this->deliveredInd++];
+		if (this->deliveredInd == 101) this->deliveredInd = 0;
+		{
+			std::unique_lock<std::mutex> lock(this->queueMutex);
+			//until Arma gives us its callback there's nowhere to deliver anything, which isn't the same as Arma being busy
+			this->registered.wait(lock, []() { return callback != nullptr; });
+			std::chrono::steady_clock::time_point wakeAt;
+			auto ready = findReady(wakeAt);
+			while (ready == this->queue.end()) {
+				if (wakeAt == std::chrono::steady_clock::time_point::max()) this->notEmpty.wait(lock);
+				else this->notEmpty.wait_until(lock, wakeAt);
+				ready = findReady(wakeAt);
+			}
+			if (!ready->batchId.empty()) {
+				//once it's been taken no more frames can be added, so close off the array
+				auto open = this->openBatches.find(ready->batchId);
+				if (open != this->openBatches.end() && open->second == &*ready) this->openBatches.erase(open);
+				ready->data.append("]]");
+			}
+			//Arma is done with whatever was in this slot 101 messages ago, so its buffer can be reused
+			if (msg->pool) msg->pool->releaseString(std::move(msg->data));
+			//moved into its slot before it's offered so the pointer we give Arma never changes
+			std::swap(*msg, *ready);
+			ready->pool = nullptr;
+			ready->stats = nullptr;
+			this->spareNodes.splice(this->spareNodes.end(), this->queue, ready);
+		}
+		this->notFull.notify_one();
+		//start by just yielding since Arma may be about to empty its buffer, then back off
+		//exponentially so a stalled game doesn't cost us a core
+		std::chrono::milliseconds backoff(0);
+		while (!offer(*msg)) {
+			IOStats::add(this->retries);
+			if (msg->stats) IOStats::add(msg->stats->read.callbackRetries);
+			if (backoff.count() == 0) {
+				std::this_thread::yield();
+				backoff = std::chrono::milliseconds(1);
+			}
+			else {
+				std::this_thread::sleep_for(backoff);
+				if (backoff < maxBackoff) backoff *= 2;
+			}
+		}
+		if (msg->stats && msg->readAt != std::chrono::steady_clock::time_point()) msg->stats->callbackLatency.recordSince(msg->readAt);
+	}
+}
@@ -0,0 +1,134 @@
+#pragma once
+#include <string>
+#include <list>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <map>
+#include <memory>
+#include "BufferPool.h"
+#include "IOStats.h"
+#include "util.h"
+
+//options for coalescing many frames read by one instance into a single callback
+struct BatchOptions {
+	bool enabled;
+	//a batch is closed once adding another frame would make its payload longer than this
+	size_t maxBytes;
+	//a batch is held back for at most this long after its first frame so more frames can join it
+	int maxLatencyMs;
+};
+
+//owns every call into the callback Arma gives us. producers (read threads, io_context handlers, etc.) queue
+//messages here and a single dispatch thread hands them to Arma, backing off while Arma's callback buffer is full.
+//this means only one thread ever waits on Arma, instead of every producer spinning on its own.
+class CallbackDispatcher
+{
+private:
+	struct Message {
+		std::string function;
+		std::string data;
+		//if this is a batch, the ID of the instance it belongs to, otherwise empty
+		std::string batchId;
+		//the message won't be offered to Arma before this time
+		std::chrono::steady_clock::time_point readyAt;
+		//where `data` goes once Arma is done with it, if anywhere
+		std::shared_ptr<BufferPool> pool;
+		//the counters of the instance the message came from, if any
+		std::shared_ptr<IOStats> stats;
+		//when the data in the message was read, if it was. the time until Arma accepts it is recorded in `stats`
+		std::chrono::steady_clock::time_point readAt;
+	};
+
+	//how many messages may be queued before `send` starts waiting for space
+	static const size_t capacity = 1024;
+	//how many messages may be queued before `post` starts dropping them. it can't wait, so it gets more room than `send`
+	static const size_t postCapacity = 4 * capacity;
+
+	//must be held to touch `queue`
+	std::mutex queueMutex;
+	//notified when a message is queued
+	std::condition_variable notEmpty;
+	//notified when a message is taken off the queue
+	std::condition_variable notFull;
+	//notified when Arma registers its callback
+	std::condition_variable registered;
+	//a list rather than a deque so messages can be taken from the middle without moving the others
+	std::list<Message> queue;
+	//nodes taken off `queue`, kept so queueing a message doesn't have to allocate a new one
+	std::list<Message> spareNodes;
+	//batches in `queue` that can still have frames added, by instance ID.
+	//elements of a list never move, so these pointers stay valid until the message is taken off the queue.
+	std::map<std::string, Message*> openBatches;
+
+	//messages that have been handed to Arma. Arma's internal buffer for callback data is only 100 long, and
+	//it's not clear whether Arma copies the strings right away or only when SQF gets to them, so we keep the
+	//last 101 (the 100 Arma may still be holding plus the one currently being offered) alive here.
+	Message delivered[101];
+	int deliveredInd = 0;
+
+	std::thread* dispatchThread = nullptr;
+	//times Arma's callback buffer was full when offering any message, including ones that don't belong to an instance
+	std::atomic<uint64_t> retries{ 0 };
+	//messages `post` and `sendBatched` have thrown away because the queue was at `postCapacity`, including ones that don't belong to an instance
+	std::atomic<uint64_t> drops{ 0 };
+
+	CallbackDispatcher();
+	//adds a message to the end of `queue`, reusing a spare node if there is one. `queueMutex` must be held
+	void enqueue(const char* function, std::string&& data, const std::string& batchId,
+		std::chrono::steady_clock::time_point readyAt, const std::shared_ptr<BufferPool>& pool, const std::shared_ptr<IOStats>& stats,
+		std::chrono::steady_clock::time_point readAt);
+	void dispatchThreadFunction();
+	//hands a message to Arma, returning false if its callback buffer was full
+	bool offer(const Message& msg);
+	//waits until `queue` has space. `lock` must hold `queueMutex`
+	void waitForSpace(std::unique_lock<std::mutex>& lock);
+	//if `queue` is at `postCapacity`, counts a dropped message (in `stats` too, if given) and returns true. `queueMutex` must be held
+	bool dropIfOverloaded(const std::shared_ptr<IOStats>& stats);
+	//returns the first message in `queue` that may be offered to Arma, or `queue.end()` if there is none,
+	//setting `wakeAt` to when the next one will be ready. `queueMutex` must be held
+	std::list<Message>::iterator findReady(std::chrono::steady_clock::time_point& wakeAt);
+public:
+	//returns the dispatcher, starting its thread the first time it's used
+	static CallbackDispatcher& get();
+
+	//queues a callback, waiting (without spinning) while the queue is full.
+	//meant for dedicated read threads, where waiting just leaves data in the OS buffer for a bit.
+	//if `pool` is given, `data` is given back to it once Arma can't be using it anymore.
+	//if `stats` is given, times Arma was too busy to take the message are counted there, and if `readAt` is given too,
+	//the time from then until Arma accepts the message is recorded there.
+	void send(const char* function, std::string data, std::shared_ptr<BufferPool> pool = nullptr, std::shared_ptr<IOStats> stats = nullptr,
+		std::chrono::steady_clock::time_point readAt = {});
+
+	//queues a callback without ever waiting, even if the queue is already at capacity.
+	//meant for io_context handlers and status messages, which must never stall the thread they're on.
+	//if the queue has fallen `postCapacity` messages behind, the callback is dropped and counted instead.
+	void post(const char* function, std::string data, std::shared_ptr<BufferPool> pool = nullptr, std::shared_ptr<IOStats> stats = nullptr,
+		std::chrono::steady_clock::time_point readAt = {});
+
+	//queues a frame read by instance `id` as part of a batch, sent to Arma as `["id", ["frame1", "frame2", ...]]`
+	//with the function "data_read_batch". frames are added to the instance's open batch, if it has one, until
+	//`options.maxBytes` is reached or the batch is taken by the dispatch thread, so while Arma is busy every frame
+	//read since the last delivery goes out in one callback. waits like `send` if a new batch is needed and the queue is full.
+	//if `wait` is false, a new batch is queued even if the queue is full, or dropped, like `post`.
+	//new batches are taken from and returned to `pool`, and retries are counted in `stats`. a batch's latency is measured from
+	//`readAt` of its first frame.
+	void sendBatched(const std::string& id, const char* frame, size_t len, const BatchOptions& options, bool wait,
+		const std::shared_ptr<BufferPool>& pool, const std::shared_ptr<IOStats>& stats, std::chrono::steady_clock::time_point readAt);
+
+	//number of messages waiting to be accepted by Arma
+	size_t queued();
+
+	//whether the queue is at capacity, meaning `send` would wait
+	bool full();
+
+	//total number of times Arma's callback buffer was full when a message was offered
+	uint64_t retried();
+
+	//total number of messages dropped by `post` and `sendBatched` because the queue was too far behind
+	uint64_t dropped();
+
+	//stores the callback Arma gives us and wakes the dispatch thread, which holds messages back until it has one
+	void setCallback(ArmaCallback c);
+};
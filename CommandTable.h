@@ -0,0 +1,52 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <sstream>
+#include <unordered_map>
+#include <initializer_list>
+#include <utility>
+#include <cctype>
+#include <cstdint>
+#include "util.h"
+
+//hashes strings without regard to case (FNV-1a over the lowercased characters), so commands can be
+//looked up as SQF wrote them without lowercasing a copy first
+struct CaseInsensitiveHash {
+	size_t operator()(std::string_view s) const {
+		uint64_t hash = 14695981039346656037ULL;
+		for (char c : s) {
+			hash ^= (unsigned char)std::tolower((unsigned char)c);
+			hash *= 1099511628211ULL;
+		}
+		return (size_t)hash;
+	}
+};
+
+struct CaseInsensitiveEqual {
+	bool operator()(std::string_view a, std::string_view b) const {
+		return equalsIgnoreCase(a, b);
+	}
+};
+
+//maps command names (case insensitive) to the functions that handle them, so finding a command takes the same time
+//no matter how many others there are. `Self` is the comm method instance commands run on, or `void` for static commands.
+template<class Self>
+class CommandTable {
+public:
+	typedef void (*Handler)(Self* self, std::string_view* argv, int argc, ResponseWriter& ans);
+	CommandTable(std::initializer_list<std::pair<const std::string_view, Handler>> commands) {
+		//the command set never changes, so leave plenty of buckets to keep collisions rare
+		this->commands.max_load_factor(0.25f);
+		this->commands.insert(commands.begin(), commands.end());
+	}
+	//runs the command called `name`, returning false if there's no such command
+	bool run(Self* self, std::string_view name, std::string_view* argv, int argc, ResponseWriter& ans) const {
+		auto it = this->commands.find(name);
+		if (it == this->commands.end()) return false;
+		it->second(self, argv, argc, ans);
+		return true;
+	}
+private:
+	//names are always string literals, so views of them never dangle
+	std::unordered_map<std::string_view, Handler, CaseInsensitiveHash, CaseInsensitiveEqual> commands;
+};
@@ -1,6 +1,70 @@
 #pragma once
 #include <boost/asio.hpp>
+#include <future>
+#include <memory>
+#include "ReadWriteHandler.h"
+#include "Tracer.h"
 
 
 extern boost::asio::io_context ioContext;
 
+//the io_context is run by several threads, so each instance gets one of these to keep its handlers from running concurrently
+typedef boost::asio::strand<boost::asio::io_context::executor_type> IOStrand;
+
+//runs `fn` on `strand` and waits for it, for touching a socket or port from outside while its handlers may be running.
+//must not be called from a handler on the same strand
+inline void runOnStrand(IOStrand& strand, std::function<void()> fn) {
+	std::promise<void> done;
+	boost::asio::post(strand, [&]() {
+		fn();
+		done.set_value();
+	});
+	done.get_future().wait();
+}
+
+//async hooks for a ReadWriteHandler over any asio stream (a TCP socket, a serial port, ...), run on the shared io_context
+//instead of threads per stream. everything runs through `strand`, which must outlive the handler.
+template<class Stream>
+typename ReadWriteHandler<Stream>::AsyncOps streamAsyncOps(IOStrand& strand) {
+	typename ReadWriteHandler<Stream>::AsyncOps ops;
+	typedef typename ReadWriteHandler<Stream>::ReadResult ReadResult;
+	ops.readSome = [&strand](Stream* handle, char* buff, DWORD buffSize, std::function<void(ReadResult, DWORD)> done) {
+		handle->async_read_some(boost::asio::buffer(buff, buffSize), boost::asio::bind_executor(strand, [done](const boost::system::error_code& ec, size_t bytesRead) {
+			TRACE_SCOPE("io read");
+			if (!ec) done(ReadResult::OK, (DWORD)bytesRead);
+			//eof is the other end closing the connection, and operation_aborted is us closing or cancelling it
+			else if (ec == boost::asio::error::eof || ec == boost::asio::error::operation_aborted) done(ReadResult::CLOSED, 0);
+			else done(ReadResult::FAILED, 0);
+		}));
+	};
+	ops.writeAll = [&strand](Stream* handle, const std::vector<QueuedWrite*>& writes, std::function<void(bool, size_t, std::string)> done) {
+		//gather every queued write into a single send
+		std::vector<boost::asio::const_buffer> buffers;
+		buffers.reserve(writes.size());
+		for (auto w : writes) buffers.push_back(boost::asio::buffer(w->data));
+		boost::asio::async_write(*handle, buffers, boost::asio::bind_executor(strand, [done](const boost::system::error_code& ec, size_t written) {
+			TRACE_SCOPE("io write");
+			done(!ec, written, ec.message());
+		}));
+	};
+	ops.post = [&strand](int delayMs, std::function<void()> fn) {
+		if (delayMs == 0) {
+			boost::asio::post(strand, [fn]() {
+				TRACE_SCOPE("io post");
+				fn();
+			});
+			return;
+		}
+		//the timer has to live until it fires, so the handler holds on to it
+		auto timer = std::make_shared<boost::asio::steady_timer>(ioContext, std::chrono::milliseconds(delayMs));
+		timer->async_wait(boost::asio::bind_executor(strand, [timer, fn](const boost::system::error_code&) {
+			TRACE_SCOPE("io timer");
+			fn();
+		}));
+	};
+	return ops;
+}
+
+inline ReadWriteHandler<boost::asio::ip::tcp::socket>::AsyncOps tcpAsyncOps(IOStrand& strand) {
+	return streamAsyncOps<boost::asio::ip::tcp::socket>(strand);
+}
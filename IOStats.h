@@ -0,0 +1,92 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include "ResponseWriter.h"
+#include "LatencyHistogram.h"
+
+//a plain copy of an instance's counters, which can be added together for totals
+struct IOStatsSnapshot {
+	uint64_t bytesIn = 0;
+	uint64_t framesIn = 0;
+	uint64_t readErrors = 0;
+	uint64_t callbackRetries = 0;
+	uint64_t bytesOut = 0;
+	uint64_t writesQueued = 0;
+	uint64_t writesCompleted = 0;
+	uint64_t writeErrors = 0;
+	uint64_t callbacksDropped = 0;
+
+	IOStatsSnapshot& operator+=(const IOStatsSnapshot& other) {
+		this->bytesIn += other.bytesIn;
+		this->framesIn += other.framesIn;
+		this->readErrors += other.readErrors;
+		this->callbackRetries += other.callbackRetries;
+		this->bytesOut += other.bytesOut;
+		this->writesQueued += other.writesQueued;
+		this->writesCompleted += other.writesCompleted;
+		this->writeErrors += other.writeErrors;
+		this->callbacksDropped += other.callbacksDropped;
+		return *this;
+	}
+	//writes that have been queued but haven't finished (successfully or not) yet
+	uint64_t writeQueueDepth() const {
+		uint64_t done = this->writesCompleted + this->writeErrors;
+		return this->writesQueued > done ? this->writesQueued - done : 0;
+	}
+	//outputs `[bytesIn, framesIn, bytesOut, writesQueued, writesCompleted, writeQueueDepth, callbackRetries, readErrors, writeErrors, callbacksDropped]`
+	void write(ResponseWriter& out) const {
+		out << "[";
+		writeFields(out);
+		out << "]";
+	}
+	//outputs the counters without the surrounding brackets, so callers can add their own fields
+	void writeFields(ResponseWriter& out) const {
+		out << this->bytesIn << ", " << this->framesIn << ", " << this->bytesOut << ", " << this->writesQueued << ", "
+			<< this->writesCompleted << ", " << writeQueueDepth() << ", " << this->callbackRetries << ", "
+			<< this->readErrors << ", " << this->writeErrors << ", " << this->callbacksDropped;
+	}
+};
+
+//counters for what an instance has been doing. they're always on, so every update is a single relaxed increment.
+//the read side (read thread and dispatcher) and the write side (game thread and write thread) are each on their own
+//cache line, so the threads updating them never fight over one
+struct IOStats {
+	struct alignas(64) ReadCounters {
+		std::atomic<uint64_t> bytesIn{ 0 };
+		//frames cut from the data read, before any overflow policy drops them
+		std::atomic<uint64_t> framesIn{ 0 };
+		std::atomic<uint64_t> readErrors{ 0 };
+		//times Arma's callback buffer was full (the callback returned -1) when offering this instance's callbacks
+		std::atomic<uint64_t> callbackRetries{ 0 };
+		//callbacks thrown away because the dispatcher's queue was too far behind to take them without waiting
+		std::atomic<uint64_t> callbacksDropped{ 0 };
+	} read;
+	struct alignas(64) WriteCounters {
+		std::atomic<uint64_t> bytesOut{ 0 };
+		std::atomic<uint64_t> writesQueued{ 0 };
+		std::atomic<uint64_t> writesCompleted{ 0 };
+		std::atomic<uint64_t> writeErrors{ 0 };
+	} write;
+	//time from data being read to Arma accepting the callback it went out in
+	LatencyHistogram callbackLatency;
+	//time from a write being queued (or started, if it isn't queued) to it finishing
+	LatencyHistogram writeLatency;
+
+	static void add(std::atomic<uint64_t>& counter, uint64_t n = 1) {
+		counter.fetch_add(n, std::memory_order_relaxed);
+	}
+	//the counters are read one at a time, so a snapshot taken while I/O is happening may be off by the odd update
+	IOStatsSnapshot snapshot() const {
+		IOStatsSnapshot ans;
+		ans.bytesIn = this->read.bytesIn.load(std::memory_order_relaxed);
+		ans.framesIn = this->read.framesIn.load(std::memory_order_relaxed);
+		ans.readErrors = this->read.readErrors.load(std::memory_order_relaxed);
+		ans.callbackRetries = this->read.callbackRetries.load(std::memory_order_relaxed);
+		ans.callbacksDropped = this->read.callbacksDropped.load(std::memory_order_relaxed);
+		ans.bytesOut = this->write.bytesOut.load(std::memory_order_relaxed);
+		ans.writesQueued = this->write.writesQueued.load(std::memory_order_relaxed);
+		ans.writesCompleted = this->write.writesCompleted.load(std::memory_order_relaxed);
+		ans.writeErrors = this->write.writeErrors.load(std::memory_order_relaxed);
+		return ans;
+	}
+};
@@ -0,0 +1,82 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+#include "ResponseWriter.h"
+
+//an HDR-style histogram of latencies in microseconds. values under 16us get a bucket each, and above that every
+//power of two is split into 16 buckets, so a reported value is never more than 1/16th above the real one.
+//recording is a few relaxed atomic operations, so it's cheap enough to leave on all the time
+class LatencyHistogram {
+private:
+	static const int subBuckets = 16;
+	//powers of two above the exact range, which takes us past 2^40us (about 12 days)
+	static const int magnitudes = 37;
+	static const int bucketCount = subBuckets + magnitudes * subBuckets;
+
+	std::atomic<uint64_t> counts[bucketCount];
+	std::atomic<uint64_t> maxValue;
+
+	static int bucketFor(uint64_t us) {
+		if (us < subBuckets) return (int)us;
+		//shift until only the top 5 bits are left, which picks the power of two and the bucket within it
+		int shift = 0;
+		while ((us >> shift) >= 2 * subBuckets) shift++;
+		int bucket = subBuckets + shift * subBuckets + (int)((us >> shift) - subBuckets);
+		return (std::min)(bucket, bucketCount - 1);
+	}
+	//the largest value that lands in bucket `i`
+	static uint64_t bucketTop(int i) {
+		if (i < subBuckets) return (uint64_t)i;
+		int shift = (i - subBuckets) / subBuckets;
+		uint64_t sub = (uint64_t)((i - subBuckets) % subBuckets);
+		return ((subBuckets + sub + 1) << shift) - 1;
+	}
+public:
+	LatencyHistogram() {
+		reset();
+	}
+	void record(uint64_t us) {
+		this->counts[bucketFor(us)].fetch_add(1, std::memory_order_relaxed);
+		uint64_t prev = this->maxValue.load(std::memory_order_relaxed);
+		while (us > prev && !this->maxValue.compare_exchange_weak(prev, us, std::memory_order_relaxed));
+	}
+	//records the time from `start` until now
+	void recordSince(std::chrono::steady_clock::time_point start) {
+		auto elapsed = std::chrono::steady_clock::now() - start;
+		record((uint64_t)(std::max)((long long)0, (long long)std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()));
+	}
+	//clears everything recorded so far. values recorded while this runs may or may not survive it
+	void reset() {
+		for (auto& c : this->counts) c.store(0, std::memory_order_relaxed);
+		this->maxValue.store(0, std::memory_order_relaxed);
+	}
+	//outputs `[count, p50, p99, p999, max]`, in microseconds. everything is 0 if nothing has been recorded
+	void write(ResponseWriter& out) const {
+		uint64_t snapshot[bucketCount];
+		uint64_t total = 0;
+		for (int i = 0; i < bucketCount; i++) {
+			snapshot[i] = this->counts[i].load(std::memory_order_relaxed);
+			total += snapshot[i];
+		}
+		uint64_t maxUs = this->maxValue.load(std::memory_order_relaxed);
+		out << "[" << total;
+		for (double fraction : { 0.5, 0.99, 0.999 }) {
+			//the smallest value that at least `fraction` of the recorded values are at or below
+			uint64_t target = (uint64_t)(fraction * total);
+			if (target < fraction * total || target == 0) target++;
+			uint64_t seen = 0;
+			uint64_t value = 0;
+			for (int i = 0; i < bucketCount && total != 0; i++) {
+				seen += snapshot[i];
+				if (seen >= target) {
+					value = (std::min)(bucketTop(i), maxUs);
+					break;
+				}
+			}
+			out << ", " << value;
+		}
+		out << ", " << maxUs << "]";
+	}
+};
@@ -6,19 +6,72 @@
 #include <sstream>
 #include <mutex>
 #include <atomic>
-#include "BufferedWrite.h"
-
-extern ArmaCallback callback;
+#include <memory>
+#include <condition_variable>
+#include <deque>
+#include <chrono>
+#include "WriteQueue.h"
+#include "BufferPool.h"
+#include "CallbackDispatcher.h"
+#include "Tracer.h"
 
 template<class HandleType>
 class ReadWriteHandler
 {
+public:
+	//a frame that has been read but not delivered yet
+	struct InboundFrame {
+		std::string data;
+		//when the data it came from was read
+		std::chrono::steady_clock::time_point readAt;
+	};
+	//how an async read ended
+	enum class ReadResult {
+		OK,
+		//the stream was closed, either by the other end or by us cancelling the read, so there's nothing more to read
+		CLOSED,
+		FAILED
+	};
+	//hooks for reading and writing without dedicated threads, driven by the owner's event loop instead (e.g. an io_context)
+	struct AsyncOps {
+		//starts reading up to the given number of bytes into the given buffer and returns right away.
+		//once the read finishes, the callback must be called with how it ended and how many bytes were read.
+		std::function<void(HandleType*, char*, DWORD, std::function<void(ReadResult, DWORD)>)> readSome;
+		//starts writing all of the given writes, in order, and returns right away. the writes stay valid until the callback
+		//is called with whether it succeeded, how many bytes were written, and an error message if it didn't succeed.
+		std::function<void(HandleType*, const std::vector<QueuedWrite*>&, std::function<void(bool, size_t, std::string)>)> writeAll;
+		//runs the given function after at least the given number of milliseconds (0 meaning as soon as possible).
+		//the function must never run at the same time as a read or write callback.
+		std::function<void(int, std::function<void()>)> post;
+	};
 private:
 	//mutex for working on the read thread. probably not necessary, but just in case
 	std::mutex readThreadMutex;
 	std::thread* readThread = nullptr;
-	//used to terminate the read thread
-	std::atomic<bool> usingReadThread = true;
+	//used to terminate the read thread, or stop issuing async reads
+	std::atomic<bool> usingReadThread = false;
+	//set by `setReadInterrupt` to cancel an outstanding async read when stopping
+	std::function<void()> interruptRead;
+
+	//set by `useAsyncOps`, in which case reads (and threaded writes) are issued through these instead of on their own threads
+	AsyncOps asyncOps;
+	bool useAsync = false;
+	//buffer async reads go into. has to outlive the call that starts the read, so it can't be on the stack
+	std::unique_ptr<char[]> asyncBuffer;
+	//must be held to touch `asyncOutstanding`
+	std::mutex asyncMutex;
+	//notified when `asyncOutstanding` drops to 0
+	std::condition_variable asyncDone;
+	//number of async reads, writes and posted functions that haven't finished yet. the handler can't be stopped until this is 0
+	int asyncOutstanding = 0;
+	//number of writes queued but not yet written in async mode. whoever takes this from 0 to 1 starts a flush,
+	//and a flush keeps going until it brings it back down to 0, so there's never more than one flush at a time
+	std::atomic<size_t> asyncWritesQueued = 0;
+	//notified (holding `flushMutex`) when a flush brings `asyncWritesQueued` back down to 0
+	std::mutex flushMutex;
+	std::condition_variable flushDone;
+	//the writes currently being flushed. there's only ever one flush at a time, so this is reused for every one
+	std::vector<QueuedWrite*> flushing;
 
 	//mutex for working on the write thread. probably not necessary, but just in case
 	std::mutex writeThreadMutex;
@@ -26,11 +79,18 @@ private:
 	//whether we should be using the write thread
 	std::atomic<bool> usingWriteThread = false;
 
-	//the next bit of data the write thread hasn't gotten to yet (head of the linked list)
-	BufferedWrite* toWrite = nullptr;
-
-	//the most recent write queued (tail of the linked list)
-	BufferedWrite* lastWrite = nullptr;
+	//writes waiting for the write thread. any thread may queue writes
+	WriteQueue writeQueue;
+	//write nodes and frame strings are recycled through here. shared with the dispatcher, since frames
+	//are only given back once Arma is done with them, which may be after this handler is gone
+	std::shared_ptr<BufferPool> pool = std::make_shared<BufferPool>();
+	//I/O counters, shared with the dispatcher so it can count retries on this handler's callbacks
+	std::shared_ptr<IOStats> stats = std::make_shared<IOStats>();
+	//allocation count and time when `allocationStats` was last called, for working out the rate
+	uint64_t lastAllocations = 0;
+	std::chrono::steady_clock::time_point lastAllocationCheck = std::chrono::steady_clock::now();
+	//wakes the write thread when something is queued or it's told to stop
+	EventCount writeReady;
 
 	//the file handle to the serial port
 	HandleType* handle;
@@ -41,8 +101,27 @@ private:
 	std::mutex writeMutex;
 	//writes a string to the handle
 	std::function<bool(HandleType*, char*, DWORD, DWORD*)> writeString;
-	//reads one char from the handle
-	std::function<bool(HandleType*, char*)> readOneChar;
+	//reads up to the given number of bytes from the handle into the given buffer, storing how many were read.
+	//should return as soon as any data is available rather than waiting for the buffer to fill.
+	std::function<bool(HandleType*, char*, DWORD, DWORD*)> readSome;
+
+	//size of the buffer handed to `readSome`. since reads return as soon as anything is available,
+	//this only limits how much can be picked up by one call.
+	static const DWORD readBufferSize = 4096;
+
+	//data that has been read but not yet sent to Arma. only touched by the read thread (or async read callbacks).
+	std::string pending;
+	//how much of `pending` has already been searched for the ON_CHAR/ON_STRING delimiter, so we never search the same bytes twice.
+	//for ON_STRING this is the first position a delimiter could start at that hasn't been checked yet
+	size_t scanned = 0;
+	//in ON_PREFIX mode, how many more bytes of an oversized frame have to be thrown away as they arrive
+	size_t skipping = 0;
+	//when data was last read, which is when the frames cut from it count as having arrived
+	std::chrono::steady_clock::time_point lastReadAt;
+	//the ID of the owning comm method, cached when reading starts
+	std::string readId;
+	//the callback options used for the last read, so we know when they change
+	ReadCallbackOptions prevOptions;
 
 	//whether a read thread should be used
 	bool useReadThread;
@@ -56,51 +135,105 @@ private:
 	//should only be used directly in its getter and setter
 	ReadCallbackOptions callbackOptions;
 
+	std::mutex batchOptionsMutex;
+	//whether and how frames are coalesced into batches. like callbackOptions, only use it through its getter and setter
+	BatchOptions batchOptions;
+
+	//must be held to touch `polling`, `inbound`, `maxInbound` or `overflowPolicy`
+	std::mutex inboundMutex;
+	//notified when there's room in `inbound` again or reading stops, so a read thread waiting for room can carry on
+	std::condition_variable inboundSpace;
+	//whether frames wait in `inbound` for `readAvailable` instead of being sent via the callback
+	std::atomic<bool> polling = false;
+	//frames read but not delivered yet, oldest first. when polling they wait here for `readAvailable`.
+	//otherwise, unless the policy is BLOCK, they wait here while Arma's callback buffer is full
+	std::deque<InboundFrame> inbound;
+	//what happens once this many frames are waiting is up to `overflowPolicy`
+	size_t maxInbound = 1024;
+	OverflowPolicy overflowPolicy = OverflowPolicy::BLOCK;
+	//frames (and their bytes) thrown away by the overflow policy
+	std::atomic<uint64_t> droppedFrames = 0;
+	std::atomic<uint64_t> droppedBytes = 0;
+	//whether an async timer is already set to move `inbound` along to the dispatcher
+	std::atomic<bool> pumpScheduled = false;
+
 public:
 	ReadWriteHandler(HandleType* handle, ICommunicationMethod* commMethod, std::function<bool(HandleType*, char*, DWORD, DWORD*)> writeString,
-		std::function<bool(HandleType*, char*)> readOneChar, bool useReadThread, bool useWriteThread) {
+		std::function<bool(HandleType*, char*, DWORD, DWORD*)> readSome, bool useReadThread, bool useWriteThread) {
 		this->handle = handle;
 		this->commMethod = commMethod;
 		this->writeString = writeString;
-		this->readOneChar = readOneChar;
+		this->readSome = readSome;
 		this->useReadThread = useReadThread;
 		this->useWriteThread = useWriteThread;
-		this->lastWrite = this->toWrite = new BufferedWrite(nullptr, 0);
-		this->toWrite->dummy = true;
 		this->callbackOptions.type = ReadCallbackTypes::ON_CHAR;
 		this->callbackOptions.value.onChar = '\n';
+		this->batchOptions.enabled = false;
+		this->batchOptions.maxBytes = 0;
+		this->batchOptions.maxLatencyMs = 0;
 	}
-	void write(std::string& data, std::stringstream& out) {
+	void write(std::string_view data, ResponseWriter& out) {
+		IOStats::add(stats->write.writesQueued);
+		auto queuedAt = std::chrono::steady_clock::now();
 		if (usingWriteThread.load()) {
-			{
-				std::unique_lock<std::mutex> l(lastWrite->nextLock);
-				lastWrite->next = new BufferedWrite(data.c_str(), (DWORD)data.length());
+			QueuedWrite* w = pool->acquireWrite(data.data(), data.length());
+			w->queuedAt = queuedAt;
+			if (useAsync) {
+				//counted before it's pushed, so a flush that's already running can never pop (and subtract) a write
+				//that hasn't been counted yet
+				bool startFlush = asyncWritesQueued.fetch_add(1) == 0;
+				writeQueue.push(w);
+				if (startFlush) asyncPost(0, [this]() { asyncFlush(); });
+			}
+			else {
+				writeQueue.push(w);
+				writeReady.notify();
 			}
-			lastWrite->cond.notify_all();
-			lastWrite = lastWrite->next;
 			sendSuccessArr(out, "Write successfully queued");
 		}
 		else {
 			DWORD written;
 			std::unique_lock<std::mutex> lock(writeMutex);
-			if (!this->writeString(handle, (char*)data.c_str(), (DWORD)data.length(), &written)) {
+			if (!this->writeString(handle, (char*)data.data(), (DWORD)data.length(), &written)) {
 				DWORD err = GetLastError();
-				sendFailureArr(out, "Error while writing: " + formatErr(err));
+				IOStats::add(stats->write.writeErrors);
+				stats->writeLatency.recordSince(queuedAt);
+				sendFailureArr(out, "Error while writing: ", formatErr(err));
 			}
 			else {
-				sendSuccessArr(out, "Successfully wrote " + std::to_string(written) + " bytes");
+				IOStats::add(stats->write.writesCompleted);
+				stats->writeLatency.recordSince(queuedAt);
+				IOStats::add(stats->write.bytesOut, written);
+				sendSuccessArr(out, "Successfully wrote ", written, " bytes");
 			}
 		}
 	}
+	//for async reads, which only finish once data arrives: `fn` must make the outstanding read finish. `stopThreads` calls it
+	//once queued writes have been flushed and no more reads will be started, so the handle can stay open until then
+	void setReadInterrupt(std::function<void()> fn) {
+		this->interruptRead = fn;
+	}
+	//makes reads and threaded writes go through `ops` instead of their own threads. must be called before `startThreads`.
+	void useAsyncOps(AsyncOps ops) {
+		this->asyncOps = ops;
+		this->useAsync = true;
+		this->asyncBuffer.reset(new char[readBufferSize]);
+	}
 	void startThreads() {
 		//start up the read thread
-		if (useReadThread) {
+		if (useReadThread && useAsync) {
+			startAsyncReads();
+		}
+		else if (useReadThread) {
 			std::unique_lock<std::mutex> lock(readThreadMutex);
 			this->usingReadThread = true;
 			readThread = new std::thread([](ReadWriteHandler<HandleType>* rwh) { rwh->readThreadFunction(); }, this);
 			
 		}
-		if (useWriteThread) {
+		if (useWriteThread && useAsync) {
+			this->usingWriteThread = true;
+		}
+		else if (useWriteThread) {
 			std::unique_lock<std::mutex> lock(this->writeThreadMutex);
 			this->usingWriteThread = true;
 			writeThread = new std::thread([](ReadWriteHandler<HandleType>* rwh) { rwh->writeThreadFunction(); }, this);
@@ -111,18 +244,42 @@ public:
 		callbackOptionsMutex.lock();
 		this->callbackOptions = val;
 		callbackOptionsMutex.unlock();
+		callbackOptionsChanged();
 	}
 	void callbackOnLength(int length) {
 		callbackOptionsMutex.lock();
 		this->callbackOptions.type = ReadCallbackTypes::ON_LENGTH;
 		this->callbackOptions.value.onLength = length;
 		callbackOptionsMutex.unlock();
+		callbackOptionsChanged();
 	}
 	void callbackOnChar(char c) {
 		callbackOptionsMutex.lock();
 		this->callbackOptions.type = ReadCallbackTypes::ON_CHAR;
 		this->callbackOptions.value.onChar = c;
 		callbackOptionsMutex.unlock();
+		callbackOptionsChanged();
+	}
+	void callbackOnString(std::string_view delimiter) {
+		callbackOptionsMutex.lock();
+		this->callbackOptions.type = ReadCallbackTypes::ON_STRING;
+		this->callbackOptions.value.onString.length = (unsigned char)delimiter.length();
+		memcpy(this->callbackOptions.value.onString.chars, delimiter.data(), delimiter.length());
+		callbackOptionsMutex.unlock();
+		callbackOptionsChanged();
+	}
+	void callbackOnLengthPrefix(LengthPrefixOptions options) {
+		callbackOptionsMutex.lock();
+		this->callbackOptions.type = ReadCallbackTypes::ON_PREFIX;
+		this->callbackOptions.value.onPrefix = options;
+		callbackOptionsMutex.unlock();
+		callbackOptionsChanged();
+	}
+	//a read thread picks up new options the next time its read returns, but async reads might not return for
+	//a long time, so data already read has to be re-checked against the new options separately
+	void callbackOptionsChanged() {
+		if (!useAsync || !usingReadThread.load()) return;
+		asyncPost(0, [this]() { if (usingReadThread.load()) onRead(nullptr, 0); });
 	}
 	ReadCallbackOptions getCallbackOptions() {
 		callbackOptionsMutex.lock();
@@ -130,7 +287,131 @@ public:
 		callbackOptionsMutex.unlock();
 		return ans;
 	}
-	void enableWriteThread(std::stringstream& out) {
+	void setBatchOptions(BatchOptions val) {
+		std::unique_lock<std::mutex> lock(batchOptionsMutex);
+		this->batchOptions = val;
+	}
+	BatchOptions getBatchOptions() {
+		std::unique_lock<std::mutex> lock(batchOptionsMutex);
+		return this->batchOptions;
+	}
+	void enableBatching(size_t maxBytes, int maxLatencyMs, ResponseWriter& out) {
+		setBatchOptions(BatchOptions{ true, maxBytes, maxLatencyMs });
+		sendSuccessArr(out, "Batching enabled");
+	}
+	void disableBatching(ResponseWriter& out) {
+		setBatchOptions(BatchOptions{ false, 0, 0 });
+		sendSuccessArr(out, "Batching disabled");
+	}
+	void enablePolling(size_t maxFrames, ResponseWriter& out) {
+		{
+			std::unique_lock<std::mutex> lock(inboundMutex);
+			this->maxInbound = maxFrames;
+			this->polling = true;
+		}
+		inboundSpace.notify_all();
+		sendSuccessArr(out, "Polling enabled");
+	}
+	void disablePolling(ResponseWriter& out) {
+		{
+			std::unique_lock<std::mutex> lock(inboundMutex);
+			this->polling = false;
+		}
+		inboundSpace.notify_all();
+		sendSuccessArr(out, "Polling disabled");
+	}
+	void setOverflowPolicy(OverflowPolicy policy, size_t maxFrames, ResponseWriter& out) {
+		{
+			std::unique_lock<std::mutex> lock(inboundMutex);
+			this->overflowPolicy = policy;
+			this->maxInbound = maxFrames;
+		}
+		inboundSpace.notify_all();
+		sendSuccessArr(out, "Overflow policy set");
+	}
+	//outputs `[droppedFrames, droppedBytes, waitingFrames]`
+	void overflowStats(ResponseWriter& out) {
+		size_t waiting;
+		{
+			std::unique_lock<std::mutex> lock(inboundMutex);
+			waiting = inbound.size();
+		}
+		out << "[" << droppedFrames.load() << ", " << droppedBytes.load() << ", " << waiting << "]";
+	}
+	//whether reading should pause until Arma or SQF catches up. only the BLOCK policy ever pauses;
+	//the others keep reading and let the policy decide what to throw away
+	bool readingPaused() {
+		std::unique_lock<std::mutex> lock(inboundMutex);
+		if (overflowPolicy != OverflowPolicy::BLOCK) return false;
+		if (polling.load()) return inbound.size() >= maxInbound;
+		lock.unlock();
+		return CallbackDispatcher::get().full();
+	}
+	//outputs `[[frame1, frame2, ...], remaining]`, taking as many waiting frames as fit in Arma's output buffer.
+	//at least one frame is always taken if there are any, since a reply too long for the buffer can still be fetched in parts
+	void readAvailable(ResponseWriter& out) {
+		//leaves room for the closing brackets and the count after the last frame
+		const size_t suffixLength = 24;
+		size_t taken = 0;
+		std::unique_lock<std::mutex> lock(inboundMutex);
+		out << "[[";
+		while (!inbound.empty()) {
+			std::string& frame = inbound.front().data;
+			if (taken != 0 && out.str().length() + frame.length() + 4 + suffixLength > out.getCapacity()) break;
+			if (taken != 0) out << ", ";
+			out << "\"" << frame << "\"";
+			pool->releaseString(std::move(frame));
+			inbound.pop_front();
+			taken++;
+		}
+		size_t remaining = inbound.size();
+		lock.unlock();
+		if (taken != 0) inboundSpace.notify_all();
+		out << "], " << remaining << "]";
+	}
+	IOStatsSnapshot getStats() {
+		return stats->snapshot();
+	}
+	//counts a write the owner made itself instead of going through `write` (e.g. a plain send on a socket), which started
+	//at `startedAt`, the same way `write` would have
+	void recordWrite(std::chrono::steady_clock::time_point startedAt, bool ok, size_t written) {
+		stats->writeLatency.recordSince(startedAt);
+		IOStats::add(stats->write.writesQueued);
+		if (ok) {
+			IOStats::add(stats->write.writesCompleted);
+			IOStats::add(stats->write.bytesOut, written);
+		}
+		else {
+			IOStats::add(stats->write.writeErrors);
+		}
+	}
+	//outputs `[[count, p50, p99, p999, max], [count, p50, p99, p999, max]]` for callbacks and writes, in microseconds
+	void latencyStats(ResponseWriter& out) {
+		out << "[";
+		stats->callbackLatency.write(out);
+		out << ", ";
+		stats->writeLatency.write(out);
+		out << "]";
+	}
+	void resetLatency(ResponseWriter& out) {
+		stats->callbackLatency.reset();
+		stats->writeLatency.reset();
+		sendSuccessArr(out, "Latency histograms reset");
+	}
+	//outputs `[allocations, reuses, allocationsPerSecond]` for this handler's buffers, where the rate covers the time since this was last called
+	void allocationStats(ResponseWriter& out) {
+		auto now = std::chrono::steady_clock::now();
+		uint64_t allocations = pool->getAllocations();
+		double seconds = std::chrono::duration<double>(now - lastAllocationCheck).count();
+		double rate = seconds > 0 ? (allocations - lastAllocations) / seconds : 0;
+		lastAllocations = allocations;
+		lastAllocationCheck = now;
+		out << "[" << allocations << ", " << pool->getReuses() << ", " << (uint64_t)rate << "]";
+	}
+	bool isUsingWriteThread() {
+		return usingWriteThread.load();
+	}
+	void enableWriteThread(ResponseWriter& out) {
 		this->useWriteThread = true;
 		std::unique_lock<std::mutex> lock(this->writeThreadMutex);
 		if (usingWriteThread.load()) {
@@ -138,174 +419,409 @@ public:
 			return;
 		}
 		usingWriteThread = true;
-		writeThread = new std::thread([](ReadWriteHandler<HandleType>* rwh) { rwh->writeThreadFunction(); }, this);
+		//in async mode writes are flushed by the event loop, so there's no thread to start
+		if (!useAsync) writeThread = new std::thread([](ReadWriteHandler<HandleType>* rwh) { rwh->writeThreadFunction(); }, this);
 		sendSuccessArr(out, "Write thread activated");
 	}
-	void disableWriteThread(std::stringstream& out) {
+	void disableWriteThread(ResponseWriter& out) {
 		{
 			std::unique_lock<std::mutex> lock(this->writeThreadMutex);
 			this->usingWriteThread = false;
 		}
+		if (useAsync) {
+			//anything already queued still gets written. the socket's read is always outstanding, so this can't wait for
+			//every async op like `stopThreads` does, only for the flushes
+			waitForFlushes();
+			sendSuccessArr(out, "Successfully terminated write thread");
+			return;
+		}
+		writeReady.notify();
 		this->writeThread->join();
 		sendSuccessArr(out, "Successfully terminated write thread");
 		delete this->writeThread;
 		this->writeThread = nullptr;
 	}
-	void readThreadFunction() {
-		std::stringstream line;
-		char readChar[20]; //only needs to be 1, marking 20 just in case
-		bool readOk;
-		//We need to buffer the strings we send to arma because I don't know if Arma
-		//copies the string data when it writes it to its internal callback buffer,
-		//or when it gets removed from that buffer and used in SQF, and if it's
-		//the latter we could end up with nasty stuff.
-		//The idea here is that we have a circular buffer of 101 strings, and since 
-		//ARMA's internal buffer for callback data is only 100 long, we can safely assume
-		//that any string older than that is done for (and we also have to account for
-		//the "current" string which may be rejected do to a full buffer).
-		//There's a good chance Arma is doing the right thing and copying the strings
-		//right away, especially since it *seems* to work ok without the buffer,
-		//but until I go do the work to find out this'll do ok
-		std::string* buffd[101];
-		for (int i = 0; i < 101; i++) buffd[i] = nullptr;
-		int ind = 0;
-		size_t charsRead = 0;
-		ReadCallbackOptions prevOptions = getCallbackOptions();
-		std::function<void(std::string, std::string)> send = [&](std::string id, std::string str) {
-			if (buffd[ind] != nullptr) delete (buffd[ind]);
-			buffd[ind] = new std::string("[\"" + id + "\", \"" + str + "\"]");
-			std::string* ans = buffd[ind++];
-			if (ind == 101) ind = 0;
-			//callback should never be nullptr at this point. if it is, something
-			//has gone seriously wrong
-			while (callback("ArmaCOM", "data_read", ans->c_str()) == -1) {
-				//if the callback returns -1, the game's buffer for callback data is full,
-				//so we have to wait until that's cleared. Which may be never.
-				//Oh well.
-				Sleep(1);
+	//hands a frame to the dispatcher, waiting for room if `wait` is set
+	void deliverFrame(const std::string& id, const char* data, size_t len, std::chrono::steady_clock::time_point readAt, const BatchOptions& batch, bool wait) {
+		if (batch.enabled) {
+			CallbackDispatcher::get().sendBatched(id, data, len, batch, wait, pool, stats, readAt);
+			return;
+		}
+		std::string ans = pool->acquireString(id.length() + len + 8);
+		ans.append("[\"").append(id).append("\", \"").append(data, len).append("\"]");
+		//the dispatcher owns the string from here on and keeps it alive as long as Arma might need it
+		if (wait) CallbackDispatcher::get().send("data_read", std::move(ans), pool, stats, readAt);
+		else CallbackDispatcher::get().post("data_read", std::move(ans), pool, stats, readAt);
+	}
+	//adds a frame to `inbound`, applying the overflow policy if it's full. `inboundMutex` must be held
+	void queueInbound(const char* data, size_t len) {
+		if (inbound.size() >= maxInbound) {
+			switch (overflowPolicy) {
+			case OverflowPolicy::DROP_OLDEST:
+				droppedFrames++;
+				droppedBytes += inbound.front().data.length();
+				pool->releaseString(std::move(inbound.front().data));
+				inbound.pop_front();
+				break;
+			case OverflowPolicy::DROP_NEWEST:
+				droppedFrames++;
+				droppedBytes += len;
+				return;
+			case OverflowPolicy::CONFLATE_LATEST:
+				droppedFrames++;
+				droppedBytes += inbound.back().data.length();
+				inbound.back().data.assign(data, len);
+				inbound.back().readAt = this->lastReadAt;
+				return;
+			default:
+				//BLOCK: reading pauses once we're over, so this can only go over by what one read held
+				break;
 			}
-		};
-		while (true) {
-			auto cbo = getCallbackOptions();
-			//if callbackOptions has changed, make sure the existing buffer doesn't have data that should
-			//be sent to Arma by the rules of the new callbackOptions
-			if (prevOptions != cbo) {
-				if (cbo.type == ReadCallbackTypes::ON_CHAR) {
-					char cbOn = cbo.value.onChar;
-					auto str = line.str();
-					auto it = str.begin();
-					auto end = str.end();
-					line.str("");
-					charsRead = 0;
-					for (; it < end; it++) {
-						if (*it == cbOn) {
-							send(commMethod->getID(), line.str());
-							line.str("");
-							charsRead = 0;
-						}
-						else {
-							line << *it;
-							charsRead++;
-						}
-					}
+		}
+		std::string frame = pool->acquireString(len);
+		frame.append(data, len);
+		inbound.push_back(InboundFrame{ std::move(frame), this->lastReadAt });
+	}
+	//moves waiting frames along to the dispatcher until it's full. `inboundMutex` must be held
+	void pumpInbound(const std::string& id, const BatchOptions& batch) {
+		while (!inbound.empty() && !CallbackDispatcher::get().full()) {
+			InboundFrame& frame = inbound.front();
+			deliverFrame(id, frame.data.data(), frame.data.length(), frame.readAt, batch, false);
+			pool->releaseString(std::move(frame.data));
+			inbound.pop_front();
+		}
+	}
+	//moves frames waiting for room in Arma's callback buffer along, returning whether any are still waiting
+	bool pumpWaiting(const BatchOptions& batch) {
+		std::unique_lock<std::mutex> lock(inboundMutex);
+		if (polling.load() || overflowPolicy == OverflowPolicy::BLOCK) return false;
+		pumpInbound(this->readId, batch);
+		return !inbound.empty();
+	}
+	//a read thread gets to pump after every read (which times out often), but async reads only finish when data arrives,
+	//so a timer keeps waiting frames moving in the meantime
+	void schedulePump() {
+		if (pumpScheduled.exchange(true)) return;
+		asyncPost(5, [this]() {
+			pumpScheduled = false;
+			if (usingReadThread.load() && pumpWaiting(getBatchOptions())) schedulePump();
+		});
+	}
+	//sends one frame of read data back to Arma as `["id", "data"]`, or adds it to a batch if batching is on,
+	//or leaves it in `inbound` if it has to wait
+	void sendFrame(const std::string& id, const char* data, size_t len, const BatchOptions& batch) {
+		IOStats::add(stats->read.framesIn);
+		TRACE_INSTANT("frame");
+		std::unique_lock<std::mutex> lock(inboundMutex);
+		if (polling.load()) {
+			queueInbound(data, len);
+			return;
+		}
+		if (overflowPolicy == OverflowPolicy::BLOCK) {
+			lock.unlock();
+			//if the dispatcher's queue is full a read thread waits, which just leaves data sitting in the OS buffer for a bit.
+			//async reads run on a shared thread that must never wait, so they handle a full queue in `continueAsyncReads`
+			deliverFrame(id, data, len, this->lastReadAt, batch, !useAsync);
+			return;
+		}
+		//frames already waiting go first so nothing is delivered out of order
+		pumpInbound(id, batch);
+		if (inbound.empty() && !CallbackDispatcher::get().full()) {
+			deliverFrame(id, data, len, this->lastReadAt, batch, false);
+		}
+		else {
+			queueInbound(data, len);
+		}
+	}
+	//sends every complete frame in `pending` according to `cbo` and drops the sent data from `pending`.
+	//frames are sliced straight out of `pending` rather than being built up a character at a time.
+	void processPending(const std::string& id, const ReadCallbackOptions& cbo, const BatchOptions& batch) {
+		const char* data = this->pending.data();
+		size_t len = this->pending.length();
+		//start of the frame currently being built
+		size_t start = 0;
+		//how much has been searched for a delimiter, or where the next search should start for ON_STRING
+		size_t searched = len;
+		if (cbo.type == ReadCallbackTypes::ON_CHAR) {
+			//memchr is vectorized by the CRT, so this is much faster than checking each char ourselves
+			size_t pos = this->scanned;
+			while (pos < len) {
+				auto found = (const char*)memchr(data + pos, cbo.value.onChar, len - pos);
+				if (found == nullptr) break;
+				size_t end = found - data;
+				sendFrame(id, data + start, end - start, batch);
+				start = pos = end + 1;
+			}
+		}
+		else if (cbo.type == ReadCallbackTypes::ON_LENGTH) {
+			size_t cbOn = (size_t)cbo.value.onLength;
+			while (len - start >= cbOn) {
+				sendFrame(id, data + start, cbOn, batch);
+				start += cbOn;
+			}
+		}
+		else if (cbo.type == ReadCallbackTypes::ON_STRING) {
+			const StringDelimiter& delim = cbo.value.onString;
+			size_t delimLen = delim.length;
+			//a delimiter can't start in its last delimLen - 1 bytes yet, so those are left for when more data arrives.
+			//each search only covers positions that haven't been checked before, even when a delimiter spans two reads
+			size_t pos = this->scanned;
+			size_t lastStart = len >= delimLen ? len - delimLen + 1 : 0;
+			while (pos < lastStart) {
+				//find the delimiter's first char with memchr, then check the rest
+				auto found = (const char*)memchr(data + pos, delim.chars[0], lastStart - pos);
+				if (found == nullptr) {
+					pos = lastStart;
+					break;
 				}
-				else if (cbo.type == ReadCallbackTypes::ON_LENGTH) {
-					auto cbOn = cbo.value.onLength;
-					if (charsRead >= cbOn) {
-						auto str = line.str();
-						line.str("");
-						for (size_t i = 0; i <= charsRead - cbOn; i += cbOn) {
-							send(commMethod->getID(), str.substr(i, cbOn));
-						}
-						auto leftover = charsRead % cbOn;
-						if (leftover == 0) {
-							charsRead = 0;
-						}
-						else {
-							line << str.substr(charsRead - leftover, leftover);
-							charsRead = leftover;
-						}
-					}
+				size_t at = found - data;
+				if (memcmp(found + 1, delim.chars + 1, delimLen - 1) == 0) {
+					sendFrame(id, data + start, at - start, batch);
+					start = pos = at + delimLen;
 				}
 				else {
-					throw "Unimplemented ReadCallbackType in ReadWriteHandler read thread";
+					pos = at + 1;
 				}
 			}
-			prevOptions = cbo;
-			//this may fail but there's nothing we can really do, so....
-			if (readOk = this->readOneChar(this->handle, readChar)) {
-				if (cbo.type != ReadCallbackTypes::ON_CHAR || readChar[0] != cbo.value.onChar) {
-					line << readChar[0];
-					charsRead++;
+			searched = (std::max)(pos, start);
+		}
+		else if (cbo.type == ReadCallbackTypes::ON_PREFIX) {
+			const LengthPrefixOptions& prefix = cbo.value.onPrefix;
+			size_t headerLen = (size_t)prefix.lengthOffset + prefix.lengthSize;
+			while (true) {
+				if (this->skipping != 0) {
+					size_t skipped = (std::min)(this->skipping, len - start);
+					start += skipped;
+					this->skipping -= skipped;
+					if (this->skipping != 0) break;
 				}
+				if (len - start < headerLen) break;
+				const unsigned char* field = (const unsigned char*)data + start + prefix.lengthOffset;
+				size_t frameLen = 0;
+				for (int i = 0; i < prefix.lengthSize; i++) {
+					frameLen = (frameLen << 8) | field[prefix.bigEndian ? i : prefix.lengthSize - 1 - i];
+				}
+				if (frameLen > (size_t)prefix.maxFrameSize) {
+					//there's no telling where the next frame starts other than by skipping this one, so that's all we can do
+					callbackFailureArr(id, "Dropped a frame of " + std::to_string(frameLen) + " bytes, which is over the maximum of " + std::to_string(prefix.maxFrameSize));
+					this->skipping = headerLen + frameLen;
+					continue;
+				}
+				if (len - start < headerLen + frameLen) break;
+				if (prefix.includeHeader) sendFrame(id, data + start, headerLen + frameLen, batch);
+				else sendFrame(id, data + start + headerLen, frameLen, batch);
+				start += headerLen + frameLen;
 			}
-			bool shouldCallback = false;
-			if (this->callbackOptions.type == ReadCallbackTypes::ON_CHAR && readOk) {
-				shouldCallback = readChar[0] == cbo.value.onChar;
-			}
-			else if (this->callbackOptions.type == ReadCallbackTypes::ON_LENGTH) {
-				shouldCallback = (charsRead >= cbo.value.onLength);
+		}
+		else {
+			throw "Unimplemented ReadCallbackType in ReadWriteHandler read thread";
+		}
+		this->pending.erase(0, start);
+		//everything left over has been searched, so only new data needs to be searched next time
+		this->scanned = searched - start;
+	}
+	//handles `len` newly read bytes (0 if a read timed out), sending any complete frames to Arma.
+	//only ever runs on one thread at a time.
+	void onRead(const char* data, DWORD len) {
+		auto cbo = getCallbackOptions();
+		auto batch = getBatchOptions();
+		//if callbackOptions has changed, make sure the existing buffer doesn't have data that should
+		//be sent to Arma by the rules of the new callbackOptions
+		if (prevOptions != cbo) {
+			this->scanned = 0;
+			this->skipping = 0;
+			processPending(readId, cbo, batch);
+		}
+		prevOptions = cbo;
+		if (len != 0) {
+			TRACE_SCOPE("read");
+			this->lastReadAt = std::chrono::steady_clock::now();
+			IOStats::add(stats->read.bytesIn, len);
+			this->pending.append(data, len);
+			processPending(readId, cbo, batch);
+		}
+		if (pumpWaiting(batch) && useAsync) schedulePump();
+	}
+	void readThreadFunction() {
+		TRACE_THREAD_NAME("read thread");
+		char readBuffer[readBufferSize];
+		this->readId = commMethod->getID();
+		this->prevOptions = getCallbackOptions();
+		while (true) {
+			//if SQF isn't keeping up with polling, wait for it instead of piling up frames
+			{
+				std::unique_lock<std::mutex> lock(inboundMutex);
+				inboundSpace.wait(lock, [this]() {
+					return !polling.load() || overflowPolicy != OverflowPolicy::BLOCK || inbound.size() < maxInbound || !usingReadThread.load();
+				});
 			}
-			if (shouldCallback) {
-				send(commMethod->getID(), line.str());
-				line.str("");
-				charsRead = 0;
+			if (!usingReadThread.load()) return;
+			//this may fail but there's nothing we can really do, so....
+			DWORD bytesRead = 0;
+			if (!this->readSome(this->handle, readBuffer, readBufferSize, &bytesRead)) {
+				IOStats::add(stats->read.readErrors);
+				bytesRead = 0;
 			}
+			onRead(readBuffer, bytesRead);
 			if (!usingReadThread.load()) return;
 		}
 	}
+	//posts `fn` through `asyncOps`, keeping track of it so `stopThreads` can wait for it
+	void asyncPost(int delayMs, std::function<void()> fn) {
+		{
+			std::unique_lock<std::mutex> lock(asyncMutex);
+			asyncOutstanding++;
+		}
+		asyncOps.post(delayMs, [this, fn]() {
+			fn();
+			asyncFinished();
+		});
+	}
+	//marks one async operation as finished
+	void asyncFinished() {
+		std::unique_lock<std::mutex> lock(asyncMutex);
+		if (--asyncOutstanding == 0) asyncDone.notify_all();
+	}
+	//waits until every write queued in async mode has been flushed
+	void waitForFlushes() {
+		std::unique_lock<std::mutex> lock(flushMutex);
+		flushDone.wait(lock, [this]() { return asyncWritesQueued.load() == 0; });
+	}
+	void waitForAsyncOps() {
+		std::unique_lock<std::mutex> lock(asyncMutex);
+		asyncDone.wait(lock, [this]() { return asyncOutstanding == 0; });
+	}
+	void startAsyncReads() {
+		this->readId = commMethod->getID();
+		this->prevOptions = getCallbackOptions();
+		this->usingReadThread = true;
+		asyncRead();
+	}
+	void asyncRead() {
+		{
+			std::unique_lock<std::mutex> lock(asyncMutex);
+			asyncOutstanding++;
+		}
+		asyncOps.readSome(handle, asyncBuffer.get(), readBufferSize, [this](ReadResult result, DWORD bytesRead) {
+			if (result == ReadResult::OK) {
+				onRead(asyncBuffer.get(), bytesRead);
+				if (usingReadThread.load()) continueAsyncReads();
+			}
+			//otherwise the stream was closed or broke, so there's no point reading again.
+			//being closed is how every connection ends, so it isn't counted as an error
+			else if (result == ReadResult::FAILED) {
+				IOStats::add(stats->read.readErrors);
+			}
+			asyncFinished();
+		});
+	}
+	void continueAsyncReads() {
+		//if Arma is falling behind, leave data in the OS buffer for a bit instead of piling it up in the dispatcher (or poll queue).
+		//we can't just wait here like a read thread would since that would hold up everyone else using the event loop.
+		if (readingPaused()) {
+			asyncPost(5, [this]() { if (usingReadThread.load()) continueAsyncReads(); });
+		}
+		else {
+			asyncRead();
+		}
+	}
+	//writes everything queued so far in one go, reporting how it went with one callback
+	void asyncFlush() {
+		while (QueuedWrite* w = writeQueue.pop()) flushing.push_back(w);
+		if (flushing.empty()) {
+			//whoever queued the write we were started for hasn't finished linking it into the queue yet
+			asyncPost(0, [this]() { asyncFlush(); });
+			return;
+		}
+		{
+			std::unique_lock<std::mutex> lock(asyncMutex);
+			asyncOutstanding++;
+		}
+		asyncOps.writeAll(handle, flushing, [this](bool ok, size_t written, std::string err) {
+			size_t count = flushing.size();
+			for (auto w : flushing) {
+				stats->writeLatency.recordSince(w->queuedAt);
+				pool->releaseWrite(w);
+			}
+			flushing.clear();
+			IOStats::add(stats->write.bytesOut, written);
+			IOStats::add(ok ? stats->write.writesCompleted : stats->write.writeErrors, count);
+			if (ok) callbackSuccessArr(commMethod->getID(), "Successfully wrote " + std::to_string(written) + " bytes");
+			else callbackFailureArr(commMethod->getID(), "Error while writing: " + err);
+			//more writes were queued while this one was in progress
+			if (asyncWritesQueued.fetch_sub(count) != count) asyncFlush();
+			else {
+				std::unique_lock<std::mutex> lock(flushMutex);
+				flushDone.notify_all();
+			}
+			asyncFinished();
+		});
+	}
 	void writeThreadFunction() {
+		TRACE_THREAD_NAME("write thread");
 		DWORD written;
 		while (true) {
-			if (!this->toWrite->dummy) {
-				//this may fail, since we're doing threaded writes there's not really anything
-				//we can do about it
-				writeMutex.lock();
-				this->writeString(handle, this->toWrite->data, this->toWrite->dataSize, &written);
-				writeMutex.unlock();
-			}
-			//if next is null, wait for the notification that it's not null anymore
-			{
-				auto lock = std::unique_lock<std::mutex>(toWrite->nextLock);
-				while (toWrite->next == nullptr) {
-					toWrite->cond.wait_for(lock, std::chrono::seconds(1));
-					//this code is not currently used
-					//since write threads can't be turned off once they're turned on right now,
-					//but I'm putting it here so I know what's up if I change that later
-					if (!usingWriteThread.load()) {
-						//clear out the rest of the write buffer
-						while (toWrite->next != nullptr) {
-							auto prev = toWrite;
-							toWrite = toWrite->next;
-							delete prev;
-							if (!toWrite->dummy) {
-								DWORD written;
-								writeMutex.lock();
-								auto wrote = this->writeString(handle, this->toWrite->data, this->toWrite->dataSize, &written);
-								writeMutex.unlock();
-							}
-						}
-						return;
-					}
+			QueuedWrite* w = writeQueue.pop();
+			if (w == nullptr) {
+				//once we've been told to stop, keep going until everything queued before that has been written
+				if (!usingWriteThread.load()) return;
+				auto key = writeReady.prepareWait();
+				//something may have been queued (or we may have been stopped) since we last checked,
+				//in which case the notify for it might have come before prepareWait and we'd never wake up
+				w = writeQueue.pop();
+				if (w == nullptr && usingWriteThread.load()) {
+					writeReady.wait(key);
+					continue;
 				}
+				writeReady.cancelWait();
+				if (w == nullptr) continue;
+			}
+			//this may fail, since we're doing threaded writes there's not really anything
+			//we can do about it
+			TRACE_SCOPE("write");
+			writeMutex.lock();
+			bool ok = this->writeString(handle, (char*)w->data.c_str(), (DWORD)w->data.length(), &written);
+			writeMutex.unlock();
+			stats->writeLatency.recordSince(w->queuedAt);
+			if (ok) {
+				IOStats::add(stats->write.writesCompleted);
+				IOStats::add(stats->write.bytesOut, written);
+			}
+			else {
+				IOStats::add(stats->write.writeErrors);
 			}
-			//free the old toWrite and replace it with the next queued write
-			auto prev = toWrite;
-			toWrite = toWrite->next;
-			delete prev;
+			pool->releaseWrite(w);
 		}
 	}
 	void stopThreads() {
-		if (this->usingWriteThread) {
+		if (this->usingWriteThread && this->useAsync) {
+			//queued writes are still flushed in the background, so wait for them before anything is cancelled
+			this->usingWriteThread = false;
+			waitForFlushes();
+		}
+		else if (this->usingWriteThread) {
 			std::unique_lock<std::mutex> lock(this->writeThreadMutex);
 			this->usingWriteThread = false;
+			writeReady.notify();
 			this->writeThread->join();
 			delete this->writeThread;
 			this->writeThread = nullptr;
 		}
-		if (this->usingReadThread) {
-			std::unique_lock<std::mutex> lock(this->readThreadMutex);
+		if (this->useAsync) {
+			//the owner has to cancel or close the handle first, or give `setReadInterrupt` something that does,
+			//so the outstanding read finishes
 			this->usingReadThread = false;
+			if (this->interruptRead) this->interruptRead();
+			waitForAsyncOps();
+		}
+		else if (this->usingReadThread) {
+			std::unique_lock<std::mutex> lock(this->readThreadMutex);
+			{
+				//the read thread might be waiting for room to poll into
+				std::unique_lock<std::mutex> inboundLock(inboundMutex);
+				this->usingReadThread = false;
+			}
+			inboundSpace.notify_all();
 			this->readThread->join();
 			delete this->readThread;
 			this->readThread = nullptr;
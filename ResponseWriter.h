@@ -0,0 +1,112 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <cstring>
+#include <charconv>
+#include <type_traits>
+#include <algorithm>
+
+//builds a command's reply straight in the output buffer Arma gives us, so a typical reply is formatted in place with
+//no allocation and no extra copy. a reply that outgrows the buffer moves to the heap, and Arma gets as much as fits.
+class ResponseWriter {
+private:
+	char* out;
+	//how much of `out` we can use, leaving room for the null terminator
+	size_t capacity;
+	size_t length = 0;
+	//whether the reply has moved to `overflow`
+	bool overflowed = false;
+	//the whole reply, once it doesn't fit in `out`
+	std::string overflow;
+	//what RVExtensionArgs returns to Arma (the second element of callExtension's result)
+	int returnCode = 0;
+
+	void spill(size_t needed) {
+		this->overflowed = true;
+		this->overflow.reserve((std::max)(needed, this->capacity * 2));
+		this->overflow.assign(this->out, this->length);
+	}
+public:
+	ResponseWriter(char* out, int outSize) {
+		this->out = outSize > 0 ? out : nullptr;
+		this->capacity = outSize > 0 ? (size_t)outSize - 1 : 0;
+	}
+	ResponseWriter(const ResponseWriter&) = delete;
+	ResponseWriter& operator=(const ResponseWriter&) = delete;
+
+	//makes room for `len` more characters and returns where to put them
+	char* append(size_t len) {
+		if (!this->overflowed && this->length + len > this->capacity) spill(this->length + len);
+		char* ans;
+		if (this->overflowed) {
+			this->overflow.resize(this->length + len);
+			ans = &this->overflow[this->length];
+		}
+		else {
+			ans = this->out + this->length;
+		}
+		this->length += len;
+		return ans;
+	}
+	ResponseWriter& write(const char* data, size_t len) {
+		if (len != 0) memcpy(append(len), data, len);
+		return *this;
+	}
+	ResponseWriter& operator<<(std::string_view str) {
+		return write(str.data(), str.length());
+	}
+	//formats the same way std::stringstream did: chars as themselves, bools as 1 or 0
+	template<typename T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
+	ResponseWriter& operator<<(T value) {
+		if constexpr (std::is_same<T, bool>::value) {
+			return write(value ? "1" : "0", 1);
+		}
+		else if constexpr (std::is_same<T, char>::value) {
+			return write(&value, 1);
+		}
+		else {
+			char buff[24];
+			auto res = std::to_chars(buff, buff + sizeof(buff), value);
+			return write(buff, res.ptr - buff);
+		}
+	}
+	ResponseWriter& operator<<(double value) {
+		char buff[32];
+		auto res = std::to_chars(buff, buff + sizeof(buff), value);
+		return write(buff, res.ptr - buff);
+	}
+
+	//the whole reply so far, including anything that didn't fit in Arma's buffer
+	std::string_view str() const {
+		if (this->overflowed) return this->overflow;
+		return std::string_view(this->out, this->length);
+	}
+	bool didOverflow() const {
+		return this->overflowed;
+	}
+	//the most that fits in Arma's buffer in one go
+	size_t getCapacity() const {
+		return this->capacity;
+	}
+	//hands over the whole reply once it has overflowed. call after `finish`
+	std::string takeOverflow() {
+		return std::move(this->overflow);
+	}
+	void setReturnCode(int code) {
+		this->returnCode = code;
+	}
+	int getReturnCode() const {
+		return this->returnCode;
+	}
+	//null-terminates Arma's buffer, first filling it with as much of the reply as fits if it overflowed
+	void finish() {
+		if (this->out == nullptr) return;
+		if (this->overflowed) {
+			memcpy(this->out, this->overflow.data(), this->capacity);
+			this->out[this->capacity] = '\0';
+		}
+		else {
+			this->out[this->length] = '\0';
+		}
+	}
+};
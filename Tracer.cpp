@@ -0,0 +1,143 @@
+#include "Tracer.h"
+
+#ifdef ARMACOM_TRACE
+#include <mutex>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+
+//everything shared between threads. only touched when a thread gets its ring, names itself, or exits, and when dumping
+struct TraceRegistry {
+	std::mutex mutex;
+	//every ring ever made. rings are never freed, just handed to a new thread once theirs exits, so a thread that
+	//has stopped (like the read thread of a closed port) can still be seen in the trace until its ring is reused
+	std::vector<TraceRing*> rings;
+	std::vector<TraceRing*> freeRings;
+	//the last name each thread was given, by tracer thread ID
+	std::map<uint32_t, std::string> threadNames;
+	uint32_t nextTid = 1;
+	//a reference point for turning ticks into microseconds
+	uint64_t startTicks = Tracer::now();
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+};
+
+static TraceRegistry& registry() {
+	//intentionally never freed, since threads can exit (and give their rings back) after static destructors have run
+	static TraceRegistry* reg = new TraceRegistry();
+	return *reg;
+}
+//set up the registry when the extension loads, so its reference point comes before any event
+static TraceRegistry& initRegistry = registry();
+
+//gives the calling thread's ring back when the thread exits
+struct TraceRingHolder {
+	TraceRing* ring = nullptr;
+	~TraceRingHolder() {
+		if (this->ring == nullptr) return;
+		TraceRegistry& reg = registry();
+		std::unique_lock<std::mutex> lock(reg.mutex);
+		reg.freeRings.push_back(this->ring);
+	}
+};
+static thread_local TraceRingHolder ringHolder;
+
+TraceRing& Tracer::ring()
+{
+	if (ringHolder.ring != nullptr) return *ringHolder.ring;
+	TraceRegistry& reg = registry();
+	std::unique_lock<std::mutex> lock(reg.mutex);
+	TraceRing* r;
+	if (reg.freeRings.empty()) {
+		r = new TraceRing();
+		reg.rings.push_back(r);
+	}
+	else {
+		r = reg.freeRings.back();
+		reg.freeRings.pop_back();
+	}
+	//a new ID, so events the ring still holds from its last thread aren't shown as this one's
+	r->tid = reg.nextTid++;
+	r->threadName = nullptr;
+	ringHolder.ring = r;
+	return *r;
+}
+
+void Tracer::nameThreadSlow(TraceRing& r, const char* name)
+{
+	TraceRegistry& reg = registry();
+	std::unique_lock<std::mutex> lock(reg.mutex);
+	r.threadName = name;
+	reg.threadNames[r.tid] = name;
+}
+
+//writes `str` as a JSON string, quotes included
+static void writeJsonString(std::ofstream& out, const char* str)
+{
+	out << '"';
+	for (const char* c = str; *c != '\0'; c++) {
+		if (*c == '"' || *c == '\\') out << '\\' << *c;
+		else if ((unsigned char)*c < 0x20) out << "\\u00" << "0123456789abcdef"[(*c >> 4) & 0xf] << "0123456789abcdef"[*c & 0xf];
+		else out << *c;
+	}
+	out << '"';
+}
+
+long long Tracer::dump(const std::string& path)
+{
+	TraceRegistry& reg = registry();
+	std::unique_lock<std::mutex> lock(reg.mutex);
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	if (!out) return -1;
+	//work out how fast the timestamp counter ticks from how far it has moved since the extension loaded
+	double elapsedUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - reg.startTime).count();
+	double ticksPerUs = elapsedUs > 0 ? (double)(Tracer::now() - reg.startTicks) / elapsedUs : 1;
+	if (ticksPerUs <= 0) ticksPerUs = 1;
+
+	out << std::fixed << std::setprecision(3) << "{\"traceEvents\":[\n";
+	bool first = true;
+	for (auto& name : reg.threadNames) {
+		if (!first) out << ",\n";
+		first = false;
+		out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << name.first << ",\"args\":{\"name\":";
+		writeJsonString(out, name.second.c_str());
+		out << "}}";
+	}
+	long long written = 0;
+	for (auto r : reg.rings) {
+		uint64_t count = r->count.load(std::memory_order_acquire);
+		//the owning thread keeps recording while we read, so once a ring has wrapped around its oldest events may be
+		//being overwritten. skipping a few of them keeps us clear of that
+		const uint64_t margin = 64;
+		uint64_t from = count > TraceRing::capacity - margin ? count - (TraceRing::capacity - margin) : 0;
+		for (uint64_t i = from; i < count; i++) {
+			const TraceEvent& e = r->events[i & (TraceRing::capacity - 1)];
+			if (e.end < e.start) continue;
+			double ts = ((double)e.start - (double)reg.startTicks) / ticksPerUs;
+			if (ts < 0) ts = 0;
+			if (!first) out << ",\n";
+			first = false;
+			out << "{\"name\":";
+			writeJsonString(out, e.name);
+			if (e.end == e.start) {
+				out << ",\"ph\":\"i\",\"s\":\"t\"";
+			}
+			else {
+				out << ",\"ph\":\"X\",\"dur\":" << (double)(e.end - e.start) / ticksPerUs;
+			}
+			out << ",\"ts\":" << ts << ",\"pid\":1,\"tid\":" << e.tid;
+			if (e.detail[0] != '\0') {
+				out << ",\"args\":{\"detail\":";
+				writeJsonString(out, e.detail);
+				out << "}";
+			}
+			out << "}";
+			written++;
+		}
+	}
+	out << "\n]}\n";
+	out.close();
+	return out ? written : -1;
+}
+#endif
@@ -0,0 +1,106 @@
+#pragma once
+#include <string>
+#include <string_view>
+
+//records what each thread was doing, for working out where a stall came from. every thread writes events into its
+//own ring buffer without locking, and `Tracer::dump` writes all of the rings out as a Chrome trace_event JSON file
+//(open it in chrome://tracing or https://ui.perfetto.dev).
+//tracing is only compiled in when ARMACOM_TRACE is defined. otherwise the TRACE_ macros expand to nothing.
+
+#ifdef ARMACOM_TRACE
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+
+struct TraceEvent {
+	const char* name;
+	//in ticks of `Tracer::now`. equal for events that don't last any time
+	uint64_t start;
+	uint64_t end;
+	//the tracer's ID for the thread that recorded the event
+	uint32_t tid;
+	//e.g. a command name. copied in, since whatever it came from may be gone by the time the trace is dumped
+	char detail[20];
+};
+
+//one thread's events. only the thread that owns the ring writes to it
+struct TraceRing {
+	//a power of two, so wrapping around is just a mask
+	static const size_t capacity = 8192;
+	TraceEvent events[capacity];
+	//how many events have ever been recorded. the last `capacity` of them are still in `events`
+	std::atomic<uint64_t> count{ 0 };
+	//the ID of the thread that owns the ring now. rings are reused once their thread exits
+	uint32_t tid = 0;
+	//the last name given to the owning thread, so naming it again is free
+	const char* threadName = nullptr;
+
+	void record(const char* name, uint64_t start, uint64_t end, std::string_view detail) {
+		uint64_t n = this->count.load(std::memory_order_relaxed);
+		TraceEvent& e = this->events[n & (capacity - 1)];
+		e.name = name;
+		e.start = start;
+		e.end = end;
+		e.tid = this->tid;
+		size_t len = (std::min)(detail.length(), sizeof(e.detail) - 1);
+		memcpy(e.detail, detail.data(), len);
+		e.detail[len] = '\0';
+		this->count.store(n + 1, std::memory_order_release);
+	}
+};
+
+class Tracer {
+public:
+	//the CPU's timestamp counter, which is much cheaper to read than any OS clock. converted to real time when dumping
+	static uint64_t now() {
+		return __rdtsc();
+	}
+	//the calling thread's ring, set up the first time the thread records anything
+	static TraceRing& ring();
+	//gives the calling thread a name to show in the trace. `name` must be a string literal (or live just as long)
+	static void nameThread(const char* name) {
+		TraceRing& r = ring();
+		if (r.threadName != name) nameThreadSlow(r, name);
+	}
+	static void nameThreadSlow(TraceRing& r, const char* name);
+	//writes every thread's events to `path`, returning how many were written, or -1 if the file couldn't be written
+	static long long dump(const std::string& path);
+};
+
+//records an event lasting from its construction until it goes out of scope
+class TraceScope {
+private:
+	const char* name;
+	std::string_view detail;
+	uint64_t start;
+public:
+	TraceScope(const char* name, std::string_view detail = std::string_view()) : name(name), detail(detail), start(Tracer::now()) {}
+	~TraceScope() {
+		Tracer::ring().record(this->name, this->start, Tracer::now(), this->detail);
+	}
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+//records an event covering the rest of the enclosing scope
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+//the same, with a short string (only the first 19 chars are kept) that has to stay valid until the end of the scope
+#define TRACE_SCOPE_DETAIL(name, detail) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name, detail)
+//records an event that doesn't last any time
+#define TRACE_INSTANT(name) do { uint64_t traceNow = Tracer::now(); Tracer::ring().record(name, traceNow, traceNow, std::string_view()); } while (0)
+#define TRACE_THREAD_NAME(name) Tracer::nameThread(name)
+
+#else
+
+#define TRACE_SCOPE(name)
+#define TRACE_SCOPE_DETAIL(name, detail)
+#define TRACE_INSTANT(name) do {} while (0)
+#define TRACE_THREAD_NAME(name)
+
+#endif
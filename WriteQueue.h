@@ -0,0 +1,104 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <string>
+#include <chrono>
+
+//one write waiting in a WriteQueue
+struct QueuedWrite {
+	std::atomic<QueuedWrite*> next;
+	std::string data;
+	//when the write was queued, for measuring how long it took to go out
+	std::chrono::steady_clock::time_point queuedAt;
+	QueuedWrite() : next(nullptr) {}
+	QueuedWrite(const char* data, size_t len) : next(nullptr), data(data, len) {}
+};
+
+//allows writes to be queued for another thread to use later.
+//this is Dmitry Vyukov's intrusive multi-producer/single-consumer queue: any number of threads may `push`
+//at the same time without locking, but only one thread (the write thread) may `pop`.
+class WriteQueue {
+private:
+	//most recently pushed node. producers swap themselves in here
+	std::atomic<QueuedWrite*> head;
+	//oldest node not yet popped. only touched by the consumer
+	QueuedWrite* tail;
+	//placeholder node so the queue is never truly empty, which is what lets push and pop avoid touching the same node
+	QueuedWrite stub;
+public:
+	WriteQueue() {
+		this->head = &stub;
+		this->tail = &stub;
+	}
+	~WriteQueue() {
+		while (QueuedWrite* w = pop()) delete w;
+	}
+	void push(QueuedWrite* w) {
+		w->next.store(nullptr, std::memory_order_relaxed);
+		QueuedWrite* prev = this->head.exchange(w, std::memory_order_acq_rel);
+		//between the exchange and this store the queue is briefly "broken", and pop will just report it as empty
+		prev->next.store(w, std::memory_order_release);
+	}
+	//takes the oldest write off the queue, or returns nullptr if there isn't one (yet). the caller owns the result.
+	QueuedWrite* pop() {
+		QueuedWrite* tail = this->tail;
+		QueuedWrite* next = tail->next.load(std::memory_order_acquire);
+		if (tail == &stub) {
+			if (next == nullptr) return nullptr;
+			this->tail = next;
+			tail = next;
+			next = next->next.load(std::memory_order_acquire);
+		}
+		if (next != nullptr) {
+			this->tail = next;
+			return tail;
+		}
+		//`tail` is the last node. if a push is in progress we have to wait for it to finish linking up
+		if (tail != this->head.load(std::memory_order_acquire)) return nullptr;
+		//otherwise put the stub back behind it so `tail` can be handed out
+		push(&stub);
+		next = tail->next.load(std::memory_order_acquire);
+		if (next != nullptr) {
+			this->tail = next;
+			return tail;
+		}
+		return nullptr;
+	}
+};
+
+//lets the write thread sleep while its queue is empty without producers having to lock anything unless it's actually asleep.
+//the consumer calls `prepareWait`, checks for work once more, then either `cancelWait`s or `wait`s.
+class EventCount {
+private:
+	//bumped by every notify that might wake someone
+	std::atomic<unsigned> epoch;
+	//number of threads between `prepareWait` and the end of `wait`/`cancelWait`
+	std::atomic<int> waiters;
+	std::mutex mutex;
+	std::condition_variable cond;
+public:
+	EventCount() : epoch(0), waiters(0) {}
+	unsigned prepareWait() {
+		this->waiters.fetch_add(1, std::memory_order_seq_cst);
+		return this->epoch.load(std::memory_order_seq_cst);
+	}
+	void cancelWait() {
+		this->waiters.fetch_sub(1, std::memory_order_seq_cst);
+	}
+	void wait(unsigned key) {
+		std::unique_lock<std::mutex> lock(this->mutex);
+		this->cond.wait(lock, [this, key]() { return this->epoch.load(std::memory_order_seq_cst) != key; });
+		this->waiters.fetch_sub(1, std::memory_order_seq_cst);
+	}
+	//call after making work available. costs a single atomic load when nobody is waiting
+	void notify() {
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (this->waiters.load(std::memory_order_relaxed) == 0) return;
+		{
+			std::unique_lock<std::mutex> lock(this->mutex);
+			this->epoch.fetch_add(1, std::memory_order_seq_cst);
+		}
+		this->cond.notify_all();
+	}
+};
@@ -1,5 +1,7 @@
 #include <boost/asio.hpp>
+#include <algorithm>
 #include "util.h"
+#include "Tracer.h"
 
 //this file has to be separate because including boost messes with windows.h and we lose the UUID stuff
 //needed in some other util functions
@@ -9,19 +11,33 @@ extern boost::asio::io_context ioContext;
 
 int ioContextUsers = 0;
 bool ioContextRunning = false;
-std::thread* ioContextThread;
+std::vector<std::thread*> ioContextThreads;
 std::mutex ioContextMutex;
 boost::asio::io_service::work* work;
 
+//leave a core for Arma itself, and don't bother with more than 4 since handlers don't do much work
+int defaultIOContextThreads() {
+	int cores = (int)std::thread::hardware_concurrency() - 1;
+	return std::max(1, std::min(4, cores));
+}
+int ioContextThreadCount = defaultIOContextThreads();
+
+//must hold ioContextMutex
+void startIOContextThread() {
+	ioContextThreads.push_back(new std::thread([]() {
+		TRACE_THREAD_NAME("io_context");
+		ioContext.run();
+	}));
+}
+
 void needIOContext() {
 	std::unique_lock<std::mutex> lock(ioContextMutex);
 	ioContextUsers++;
 	if (!ioContextRunning) {
+		//run() returns immediately after a stop() until the context is restarted
+		ioContext.restart();
 		work = new boost::asio::io_service::work(ioContext);
-		ioContextThread = new std::thread([]() {
-			ioContext.run();
-			ioContextRunning = false;
-		});
+		for (int i = 0; i < ioContextThreadCount; i++) startIOContextThread();
 		ioContextRunning = true;
 	}
 }
@@ -32,6 +48,26 @@ void doneWithIOContext() {
 	if (ioContextUsers == 0) {
 		delete work;
 		ioContext.stop();
+		for (auto t : ioContextThreads) {
+			t->join();
+			delete t;
+		}
+		ioContextThreads.clear();
 		ioContextRunning = false;
 	}
-}
\ No newline at end of file
+}
+
+void setIOContextThreads(int count) {
+	std::unique_lock<std::mutex> lock(ioContextMutex);
+	ioContextThreadCount = count;
+	//extra threads can join a running context right away, but there's no way to ask just some of them to
+	//stop, so shrinking the pool only happens the next time the context starts
+	if (ioContextRunning) {
+		while ((int)ioContextThreads.size() < count) startIOContextThread();
+	}
+}
+
+int getIOContextThreads() {
+	std::unique_lock<std::mutex> lock(ioContextMutex);
+	return ioContextRunning ? (int)ioContextThreads.size() : ioContextThreadCount;
+}
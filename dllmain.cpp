@@ -1,5 +1,7 @@
 // dllmain.cpp : Defines the entry point for the DLL application.
+#ifdef _WIN32
 #pragma comment( lib, "rpcrt4.lib" )
+#endif
 #include "boost/asio.hpp"
 //TODO: add data bits
 //TODO: make changes to settings affect opened ports
@@ -10,11 +12,18 @@
 #include <mutex>
 #include <atomic>
 #include <map>
+#include <climits>
+#include <cstdio>
+#include <algorithm>
 #include "serial.h"
 #include "util.h"
 #include "framework.h"
 #include "tcpClient.h"
 #include "tcpServer.h"
+#include "CommandTable.h"
+#include "ArmaArray.h"
+#include "CallbackDispatcher.h"
+#include "Tracer.h"
 
 
 boost::asio::io_context ioContext;
@@ -23,90 +32,268 @@ boost::asio::io_context ioContext;
 ArmaCallback callback = nullptr;
 
 //maps port names to SerialPorts to allow multiple simultaneous connections
-std::map<std::string, ICommunicationMethod*> commMethods;
+std::map<std::string, ICommunicationMethod*, std::less<>> commMethods;
+//must be held to touch `commMethods`, since TCP servers add their connections from io_context threads.
+//instances are only ever removed from Arma's thread, so a pointer found under the lock stays valid there without it
+std::mutex commMethodsMutex;
 
 //called when the extension is loaded by ARMA
 void __stdcall RVExtensionVersion(char* output, int outputSize)
 {
-	strncpy_s(output, outputSize, "ArmaCOM v2.0-beta", (size_t)outputSize - 1);
+	snprintf(output, outputSize, "%s", "ArmaCOM v2.0-beta");
 }
 
 //called when the extension is loaded by ARMA
 void __stdcall RVExtensionRegisterCallback(ArmaCallback c) {
-	callback = c;
+	CallbackDispatcher::get().setCallback(c);
+}
+
+//how many arguments fit in RVExtensionArgs' stack buffer before it has to allocate one
+static const int maxStackArgs = 16;
+
+//the rest of a reply that didn't fit in Arma's output buffer, waiting to be fetched
+struct PendingReply {
+	std::string data;
+	//how much of `data` has been returned so far
+	size_t offset;
+};
+//at most this many replies are kept waiting. past that the oldest is dropped, in case a script never fetched the rest of one
+static const size_t maxPendingReplies = 16;
+//maps tokens to the replies they continue. tokens count up, so (short of them wrapping around) the oldest reply is first
+std::map<int, PendingReply> pendingReplies;
+std::mutex pendingRepliesMutex;
+int nextReplyToken = 1;
+
+//keeps the part of `ans` that didn't fit for `fetch`, and returns the token to fetch it with
+static int pageReply(ResponseWriter& ans) {
+	std::unique_lock<std::mutex> lock(pendingRepliesMutex);
+	if (pendingReplies.size() >= maxPendingReplies) pendingReplies.erase(pendingReplies.begin());
+	int token = nextReplyToken;
+	nextReplyToken = nextReplyToken == INT_MAX ? 1 : nextReplyToken + 1;
+	pendingReplies[token] = PendingReply{ ans.takeOverflow(), ans.getCapacity() };
+	return token;
 }
 
 //called when the extension is called with arguments
 int __stdcall RVExtensionArgs(char* output, int outputSize, const char* functionC, const char** argvC, int argc)
 {
 	
-	std::string function(functionC);
-	std::stringstream ans;
-	std::string* argv{ new std::string[argc]{} };
-	for (int i = 0; i < argc; i++) {
-		argv[i] = std::string(argvC[i]);
-		std::string& tmp = argv[i];
-		//copied from https://stackoverflow.com/questions/216823/whats-the-best-way-to-trim-stdstring
-		tmp.erase(tmp.begin(), std::find_if(tmp.begin(), tmp.end(), [](unsigned char ch) {
-			return ch != '"';
-		}));
-		tmp.erase(std::find_if(tmp.rbegin(), tmp.rend(), [](unsigned char ch) {
-			return ch != '"';
-		}).base(), tmp.end());
-	}
-
-	//i'm kind of playing with fire here using GOTOs (especially in threaded code)
-	//but this is side-project code that doesn't really matter so it's the nicest-looking
-	//way to handle this stuff without more complexity. much better than nesting several ifs deep.
-	if (equalsIgnoreCase(function, "serial")) {
-		SerialPort::runStaticCommand(function, argv, argc, ans);
-	}
-	else if (equalsIgnoreCase(function, "tcpclient")) {
-		TcpClient::runStaticCommand(function, argv, argc, ans);
+	std::string_view function(functionC);
+	TRACE_THREAD_NAME("Arma");
+	TRACE_SCOPE_DETAIL("RVExtensionArgs", function);
+	ResponseWriter ans(output, outputSize);
+	//arguments are views straight into Arma's buffers, which stay valid until we return, so nothing gets copied.
+	//commands rarely take more than a few arguments, so the views normally live on the stack too
+	std::string_view argvStack[maxStackArgs];
+	std::vector<std::string_view> argvHeap;
+	std::string_view* argv = argvStack;
+	if (argc > maxStackArgs) {
+		argvHeap.resize(argc);
+		argv = argvHeap.data();
 	}
-	else if (equalsIgnoreCase(function, "tcpserver")) {
-		TcpServer::runStaticCommand(function, argv, argc, ans);
-	}
-	else if (equalsIgnoreCase(function, "destroy")) {
-		//@GlobalCommand destroy
-		//@Args instance: UUID
-		//@Return Success or failure message
-		//@Description Destroys an instance of a communication method if it is not currently connected
-		if (argc == 0) {
-			sendFailureArr(ans, "You must specify additional arguments");
-			goto end;
-		}
-		std::string& function2 = *argv;
-		if (commMethods.count(function2) == 0) {
-			sendFailureArr(ans, "No such instance \"" + function2 + "\"");
-			goto end;
-		}
-		auto commMethod = commMethods[function2];
-		if (commMethod->isConnected()) {
-			sendFailureArr(ans, "You must disconnect before destroying");
-			goto end;
+	for (int i = 0; i < argc; i++) {
+		std::string_view arg(argvC[i]);
+		//strip the quotes Arma puts around strings
+		size_t start = arg.find_first_not_of('"');
+		if (start == std::string_view::npos) {
+			arg = std::string_view();
 		}
-		if (!commMethod->destroy()) {
-			sendFailureArr(ans, "Comm method could not be destroyed. Ensure no operations are pending and the method is not connected.");
-			goto end;
+		else {
+			arg.remove_prefix(start);
+			arg.remove_suffix(arg.length() - 1 - arg.find_last_not_of('"'));
 		}
-		commMethods.erase(function2);
-		delete commMethod;
-		sendSuccessArr(ans, "Instance destroyed");
+		argv[i] = arg;
 	}
-	else {
-		if (commMethods.count(function) != 0) {
-			auto commMethod = commMethods[function];
+
+	//anything that isn't a global command is the ID of an instance to run a command on
+	static const CommandTable<void> commands = {
+		{ "serial", [](void*, std::string_view* argv, int argc, ResponseWriter& ans) {
+			SerialPort::runStaticCommand("serial", argv, argc, ans);
+		} },
+		{ "tcpclient", [](void*, std::string_view* argv, int argc, ResponseWriter& ans) {
+			TcpClient::runStaticCommand("tcpclient", argv, argc, ans);
+		} },
+		{ "tcpserver", [](void*, std::string_view* argv, int argc, ResponseWriter& ans) {
+			TcpServer::runStaticCommand("tcpserver", argv, argc, ans);
+		} },
+		{ "destroy", [](void*, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@GlobalCommand destroy
+			//@Args instance: UUID
+			//@Return Success or failure message
+			//@Description Destroys an instance of a communication method if it is not currently connected
+			if (argc == 0) {
+				sendFailureArr(ans, "You must specify additional arguments");
+				return;
+			}
+			ICommunicationMethod* commMethod;
+			{
+				std::unique_lock<std::mutex> lock(commMethodsMutex);
+				auto it = commMethods.find(argv[0]);
+				if (it == commMethods.end()) {
+					sendFailureArr(ans, "No such instance \"", argv[0], "\"");
+					return;
+				}
+				commMethod = it->second;
+			}
+			if (commMethod->isConnected()) {
+				sendFailureArr(ans, "You must disconnect before destroying");
+				return;
+			}
+			if (!commMethod->destroy()) {
+				sendFailureArr(ans, "Comm method could not be destroyed. Ensure no operations are pending and the method is not connected.");
+				return;
+			}
+			{
+				std::unique_lock<std::mutex> lock(commMethodsMutex);
+				commMethods.erase(commMethod->getID());
+			}
+			delete commMethod;
+			sendSuccessArr(ans, "Instance destroyed");
+		} },
+		{ "setIOThreads", [](void*, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@GlobalCommand setIOThreads
+			//@Args count: int
+			//@Return Success or failure message
+			//@Description Sets how many threads handle asynchronous TCP and serial operations. Defaults to one less than the number of CPU cores, between 1 and 4.
+			//@Description Threads are added right away, but if TCP or serial instances exist the pool only shrinks once they have all been destroyed.
+			if (argc == 0) {
+				sendFailureArr(ans, "Additional argument required");
+				return;
+			}
+			try {
+				int val = svToInt(argv[0]);
+				if (val < 1) {
+					sendFailureArr(ans, "Thread count must be at least 1");
+					return;
+				}
+				setIOContextThreads(val);
+				sendSuccessArr(ans, "IO thread count set to ", val);
+			}
+			catch (std::exception e) {
+				sendFailureArr(ans, "Exception parsing input: ", e.what());
+			}
+		} },
+		{ "getIOThreads", [](void*, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@GlobalCommand getIOThreads
+			//@Args 
+			//@Return The number of threads handling asynchronous TCP and serial operations
+			//@Description Returns how many threads are handling asynchronous TCP and serial operations, or how many will once a TCP or serial instance is created.
+			ans << getIOContextThreads();
+		} },
+		{ "stats", [](void*, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@GlobalCommand stats
+			//@Args 
+			//@Return `[bytesIn, framesIn, bytesOut, writesQueued, writesCompleted, writeQueueDepth, callbackRetries, readErrors, writeErrors, callbacksDropped, callbacksWaiting]`
+			//@Description Adds up the I/O counters (see `getStats` on any instance) of every instance that hasn't been destroyed.
+			//@Description `callbackRetries` and `callbacksDropped` cover every callback the extension has sent, including ones from destroyed instances, and `callbacksWaiting` is how many are queued waiting for room in Arma's callback buffer.
+			IOStatsSnapshot total;
+			{
+				std::unique_lock<std::mutex> lock(commMethodsMutex);
+				for (auto& it : commMethods) it.second->addStats(total);
+			}
+			total.callbackRetries = CallbackDispatcher::get().retried();
+			total.callbacksDropped = CallbackDispatcher::get().dropped();
+			ans << "[";
+			total.writeFields(ans);
+			ans << ", " << CallbackDispatcher::get().queued() << "]";
+		} },
+		{ "dumpTrace", [](void*, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@GlobalCommand dumpTrace
+			//@Args path: string
+			//@Return Success or failure message
+			//@Description Writes the events recorded by the tracer to `path` as a Chrome trace (open it in chrome://tracing or https://ui.perfetto.dev), showing what each of the extension's threads was doing recently.
+			//@Description The tracer is only available in builds with `ARMACOM_TRACE` defined, since it costs a little on every call, read, callback and write. Each thread keeps its last 8192 events.
+#ifdef ARMACOM_TRACE
+			if (argc == 0 || argv[0].length() == 0) {
+				sendFailureArr(ans, "Additional argument required");
+				return;
+			}
+			long long written = Tracer::dump(std::string(argv[0]));
+			if (written < 0) {
+				sendFailureArr(ans, "Could not write to \"", argv[0], "\"");
+				return;
+			}
+			sendSuccessArr(ans, "Wrote ", written, " events to \"", argv[0], "\"");
+#else
+			sendFailureArr(ans, "Tracing is not available in this build. Build with ARMACOM_TRACE defined to use it");
+#endif
+		} },
+		{ "checkArray", [](void*, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@GlobalCommand checkArray
+			//@Args array: Array
+			//@Return `array` as the extension understood it, or a failure message saying where it could not be parsed
+			//@Description Parses an array the same way the extension parses arrays sent to it, and sends it back. Useful for checking what the extension will make of your data.
+			if (argc == 0) {
+				sendFailureArr(ans, "Additional argument required");
+				return;
+			}
+			//kept between calls so its memory gets reused
+			static thread_local ArmaArray parser;
+			ArmaParseError error;
+			ArmaValue* arr = parser.parse(argv[0], error);
+			if (arr == nullptr) {
+				sendFailureArr(ans, "Error parsing array at position ", error.pos, ": ", error.message);
+				return;
+			}
+			size_t len = ArmaArray::serializedLength(arr);
+			ArmaArray::serialize(arr, ans.append(len), len);
+		} },
+		{ "fetch", [](void*, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@GlobalCommand fetch
+			//@Args token: int
+			//@Return The next part of a reply that was too long to return all at once
+			//@Description When a reply doesn't fit in Arma's output buffer, the extension returns as much as fits and a non-zero return code (the second element of `callExtension`'s result).
+			//@Description Pass that code to `fetch` to get the next part, until `fetch`'s return code is 0. Join the parts to get the whole reply.
+			if (argc == 0) {
+				sendFailureArr(ans, "Additional argument required");
+				return;
+			}
+			int token;
+			try {
+				token = svToInt(argv[0]);
+			}
+			catch (std::exception e) {
+				sendFailureArr(ans, "Exception parsing input: ", e.what());
+				return;
+			}
+			std::unique_lock<std::mutex> lock(pendingRepliesMutex);
+			auto it = pendingReplies.find(token);
+			if (it == pendingReplies.end()) {
+				sendFailureArr(ans, "No reply waiting for token ", token);
+				return;
+			}
+			PendingReply& reply = it->second;
+			size_t len = (std::min)(reply.data.length() - reply.offset, ans.getCapacity());
+			ans.write(reply.data.data() + reply.offset, len);
+			reply.offset += len;
+			if (reply.offset == reply.data.length()) {
+				pendingReplies.erase(it);
+			}
+			else {
+				ans.setReturnCode(token);
+			}
+		} },
+	};
+	if (!commands.run(nullptr, function, argv, argc, ans)) {
+		ICommunicationMethod* commMethod = nullptr;
+		{
+			//not held while the command runs, since commands like `disconnect` wait on the io_context threads
+			std::unique_lock<std::mutex> lock(commMethodsMutex);
+			auto it = commMethods.find(function);
+			if (it != commMethods.end()) commMethod = it->second;
+		}
+		if (commMethod != nullptr) {
 			commMethod->runInstanceCommand(function, argv, argc, ans);
 		}
 		else {
-			sendFailureArr(ans, "Unrecognized function: " + function);
+			sendFailureArr(ans, "Unrecognized function: ", function);
 		}
 	}
 
-end:
-	strncpy_s(output, outputSize, ans.str().c_str(), (size_t)ans.str().length());
-	return 0;
+	//replies that don't fit are cut short, and the rest is kept for `fetch`
+	ans.finish();
+	if (ans.didOverflow()) return pageReply(ans);
+	return ans.getReturnCode();
 }
 
 //called when the extension is called with no arguments (only a function name)
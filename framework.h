@@ -1,15 +1,22 @@
 #pragma once
 
+#ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN             // Exclude rarely-used stuff from Windows headers
 // Windows Header Files
 #include <windows.h>
+#define ARMA_EXPORT __declspec(dllexport)
+#else
+//Arma on Linux looks the same functions up in a shared library, without a calling convention
+#define ARMA_EXPORT __attribute__((visibility("default")))
+#define __stdcall
+#endif
 #include "util.h"
 
 
 extern "C"
 {
-    __declspec(dllexport) void __stdcall RVExtension(char* output, int outputSize, const char* function);
-    __declspec(dllexport) int __stdcall RVExtensionArgs(char* output, int outputSize, const char* function, const char** argv, int argc);
-    __declspec(dllexport) void __stdcall RVExtensionVersion(char* output, int outputSize);
-    __declspec(dllexport) void __stdcall RVExtensionRegisterCallback(ArmaCallback callback);
+    ARMA_EXPORT void __stdcall RVExtension(char* output, int outputSize, const char* function);
+    ARMA_EXPORT int __stdcall RVExtensionArgs(char* output, int outputSize, const char* function, const char** argv, int argc);
+    ARMA_EXPORT void __stdcall RVExtensionVersion(char* output, int outputSize);
+    ARMA_EXPORT void __stdcall RVExtensionRegisterCallback(ArmaCallback callback);
 }
\ No newline at end of file
@@ -1,6 +1,17 @@
 #include "serial.h"
 #include "util.h"
+#include "CommandTable.h"
 #include <functional>
+#ifndef _WIN32
+#include <algorithm>
+#include <filesystem>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#endif
 
 //@CommMethod Serial
 //@Description This communication method is an interface for serial/COM ports. Serial ports are different from most other (read: modern) methods of communicating with computers.
@@ -19,34 +30,96 @@
 //@Description This tends to work well enough with how fast modern CPUs are, but a very important limitation is that the SQF VM **cannot make an extension yield its time**. When `callExtension` is run, Arma has to stop pretty much everything it's doing until the extension returns, which makes waiting around for a write to finish for 20+ms a very bad idea.
 //@Description If you're lucky enough for your game to be running at 60 FPS, that means a new frame comes through every 16.6ms - that's right, a single write to a serial port takes longer than running physics simulations and rendering an entire frame by almost 25%.
 //@Description So please, turn on threaded writes, and if that's not good enough, consider something other than the terribly dated technology that is serial communications.
+//@Description Ports don't get threads of their own: reads, and writes once threaded writes are on, are handled by the same few threads as TCP (see `setIOThreads`), so dozens of open ports don't cost any more threads than one.
 
 //since only 1 connection to a serial port can be active at once usually,
 //we cache them here to make life a little easier for devs
 static std::map<std::string, SerialPort*> serialPorts;
 
-extern std::map<std::string, ICommunicationMethod*> commMethods;
+extern std::map<std::string, ICommunicationMethod*, std::less<>> commMethods;
+extern std::mutex commMethodsMutex;
 extern ArmaCallback callback;
 
-SerialPort::SerialPort(std::string portName) {
+SerialPort::SerialPort(std::string portName) : strand(boost::asio::make_strand(ioContext)) {
+	needIOContext();
 	this->id = generateUUID();
+#ifdef _WIN32
 	this->portName = portPrefix + portName;
+#else
+	this->portName = portName[0] == '/' ? portName : portPrefix + portName;
+#endif
 	this->portNamePretty = portName;
-	std::function<bool(HANDLE*, char*, DWORD, DWORD*)> writeFunc = [](HANDLE* handle, char* data, DWORD dataSize, DWORD* written) {
-		return (bool)WriteFile(*handle, data, dataSize, written, nullptr);
+	this->port = new boost::asio::serial_port(ioContext);
+#ifdef _WIN32
+	//the port is opened for overlapped I/O so the io_context can read from it, which writes have to go along with
+	std::function<bool(boost::asio::serial_port*, char*, DWORD, DWORD*)> writeFunc = [this](boost::asio::serial_port* port, char* data, DWORD dataSize, DWORD* written) {
+		OVERLAPPED ov = { 0 };
+		//the low bit keeps the completion out of the io_context's completion port, since we wait for it here instead
+		ov.hEvent = (HANDLE)((ULONG_PTR)this->writeEvent | 1);
+		if (WriteFile(port->native_handle(), data, dataSize, written, &ov)) return true;
+		if (GetLastError() != ERROR_IO_PENDING) return false;
+		return (bool)GetOverlappedResult(port->native_handle(), &ov, written, TRUE);
 	};
-	std::function<bool(HANDLE*, char*)> readFunc = [](HANDLE* handle, char* readChar) {
-		DWORD charsRead;
-		auto ok = ReadFile(*handle, readChar, 1, &charsRead, nullptr);
-		return ok && charsRead == 1;
+#else
+	//the port is nonblocking, so a write that doesn't fit in the output buffer waits for room here.
+	//like Windows' write timeouts, it gives up if no room turns up for 10ms plus 10ms per byte left to write
+	std::function<bool(boost::asio::serial_port*, char*, DWORD, DWORD*)> writeFunc = [](boost::asio::serial_port* port, char* data, DWORD dataSize, DWORD* written) {
+		int fd = port->native_handle();
+		*written = 0;
+		while (*written < dataSize) {
+			ssize_t n = ::write(fd, data + *written, dataSize - *written);
+			if (n >= 0) {
+				*written += (DWORD)n;
+				continue;
+			}
+			if (errno == EINTR) continue;
+			if (errno != EAGAIN) return false;
+			pollfd room = { fd, POLLOUT, 0 };
+			int ready = poll(&room, 1, 10 + 10 * (int)(dataSize - *written));
+			if (ready == 0) {
+				errno = ETIMEDOUT;
+				return false;
+			}
+			if (ready < 0 && errno != EINTR) return false;
+		}
+		return true;
 	};
-	this->rwHandler = new ReadWriteHandler<HANDLE>(&(this->serialPort), this, writeFunc, readFunc, true, false);
+#endif
+	//reads and threaded writes are done asynchronously on the io_context, so there's no blocking read function
+	this->rwHandler = new ReadWriteHandler<boost::asio::serial_port>(this->port, this, writeFunc, nullptr, true, false);
+	auto ops = streamAsyncOps<boost::asio::serial_port>(this->strand);
+#ifndef _WIN32
+	//Windows' driver drops NUL bytes itself when fNull is set, but termios has nothing like it
+	auto readSome = ops.readSome;
+	typedef ReadWriteHandler<boost::asio::serial_port>::ReadResult ReadResult;
+	ops.readSome = [this, readSome](boost::asio::serial_port* port, char* buff, DWORD buffSize, std::function<void(ReadResult, DWORD)> done) {
+		readSome(port, buff, buffSize, [this, buff, done](ReadResult result, DWORD bytesRead) {
+			if (result == ReadResult::OK && this->fNull) bytesRead = (DWORD)(std::remove(buff, buff + bytesRead, '\0') - buff);
+			done(result, bytesRead);
+		});
+	};
+#endif
+	this->rwHandler->useAsyncOps(ops);
+	//cancelling leaves the port open, so disconnecting doesn't lose writes still being flushed
+	this->rwHandler->setReadInterrupt([this]() {
+		runOnStrand(this->strand, [this]() {
+			boost::system::error_code ignored;
+			this->port->cancel(ignored);
+		});
+	});
+}
+
+SerialPort::~SerialPort() {
+	delete this->rwHandler;
+	delete this->port;
 }
 
 
 //sets the parameters for the serial port according to instance variables and prints errors to `out`.
-//returns false on a failed Windows API call, and true otherwise.
+//returns false on a failed OS call (or, off Windows, parameters termios can't express), and true otherwise.
 
-bool SerialPort::setParams(std::stringstream& out) {
+#ifdef _WIN32
+bool SerialPort::setParams(ResponseWriter& out) {
 	DCB serialParams = { 0 };
 	serialParams.DCBlength = sizeof(serialParams);
 	if (!GetCommState(serialPort, &serialParams)) {
@@ -84,11 +157,129 @@ bool SerialPort::setParams(std::stringstream& out) {
 	}
 	return true;
 }
+#else
+//the termios speed for a baud rate, if termios has one
+static bool termiosSpeed(DWORD rate, speed_t& speed) {
+	switch (rate) {
+	case 110: speed = B110; return true;
+	case 300: speed = B300; return true;
+	case 600: speed = B600; return true;
+	case 1200: speed = B1200; return true;
+	case 2400: speed = B2400; return true;
+	case 4800: speed = B4800; return true;
+	case 9600: speed = B9600; return true;
+	case 19200: speed = B19200; return true;
+	case 38400: speed = B38400; return true;
+	case 57600: speed = B57600; return true;
+	case 115200: speed = B115200; return true;
+	default: return false;
+	}
+}
+
+//turns a modem control line (e.g. TIOCM_DTR) on or off. pseudo-terminals don't have them, which isn't an error
+static bool setModemLine(int fd, int line, bool on) {
+	if (ioctl(fd, on ? TIOCMBIS : TIOCMBIC, &line) == 0) return true;
+	return errno == ENOTTY || errno == EINVAL;
+}
+
+//maps the same parameters onto termios. the ones Windows uses to tune its driver's buffering (XonLim, XoffLim,
+//fTXContinueOnXoff, EofChar, EvtChar, fAbortOnError) have no equivalent and are ignored, while settings termios
+//can't honor at all are refused rather than silently behaving differently
+bool SerialPort::setParams(ResponseWriter& out) {
+	termios tio;
+	if (tcgetattr(serialPort, &tio) != 0) {
+		int err = errno;
+		out << "Error while getting terminal attributes: " << formatErr(err);
+		return false;
+	}
+	//no line editing, echoing, or translating: bytes go through exactly as they are
+	cfmakeraw(&tio);
+	tio.c_cflag |= CLOCAL | CREAD;
+	speed_t speed;
+	if (!termiosSpeed(baudRates[baudRate], speed)) {
+		out << "Baud rate " << baudRates[baudRate] << " isn't supported on this platform";
+		return false;
+	}
+	cfsetispeed(&tio, speed);
+	cfsetospeed(&tio, speed);
+	static const tcflag_t sizes[] = { 0, CS5, CS6, CS7, CS8 };
+	if (sizes[dataBits] == 0) {
+		out << dataBitNames[dataBits] << " aren't supported on this platform";
+		return false;
+	}
+	tio.c_cflag = (tio.c_cflag & ~CSIZE) | sizes[dataBits];
+	//like on Windows, 1.5 stop bits only exist with 5 data bits, where UARTs send 1.5 instead of 2
+	if (stopBits == 1 && dataBitValues[dataBits] != 5) {
+		out << "1.5 stop bits need 5 data bits";
+		return false;
+	}
+	if (stopBits == 0) tio.c_cflag &= ~CSTOPB;
+	else tio.c_cflag |= CSTOPB;
+	tio.c_cflag &= ~(PARENB | PARODD);
+#ifdef CMSPAR
+	tio.c_cflag &= ~CMSPAR;
+#endif
+	switch (parity) {
+	case 1: tio.c_cflag |= PARENB | PARODD; break;
+	case 2: tio.c_cflag |= PARENB; break;
+#ifdef CMSPAR
+	case 3: tio.c_cflag |= PARENB | PARODD | CMSPAR; break;
+	case 4: tio.c_cflag |= PARENB | CMSPAR; break;
+#else
+	case 3:
+	case 4:
+		out << parityNames[parity] << " isn't supported on this platform";
+		return false;
+#endif
+	}
+	//bytes with parity errors are read as 0, which is what fErrorChar does with an ErrorChar of 0
+	if (fParity) tio.c_iflag |= INPCK;
+	else tio.c_iflag &= ~INPCK;
+	if (fParity && fErrorChar && ErrorChar != 0) {
+		out << "Replacing bytes with parity errors with anything but 0 isn't supported on this platform";
+		return false;
+	}
+	if (fOutxDsrFlow || fDsrSensitivity || fDtrControl == 2) {
+		out << "DSR/DTR flow control isn't supported on this platform";
+		return false;
+	}
+	if (fRtsControl == 3) {
+		out << "RTS toggling isn't supported on this platform";
+		return false;
+	}
+	//termios only has both directions of RTS/CTS flow control at once
+	if (fOutxCtsFlow || fRtsControl == 2) tio.c_cflag |= CRTSCTS;
+	else tio.c_cflag &= ~CRTSCTS;
+	if (fOutX) tio.c_iflag |= IXON;
+	else tio.c_iflag &= ~IXON;
+	if (fInX) tio.c_iflag |= IXOFF;
+	else tio.c_iflag &= ~IXOFF;
+	tio.c_cc[VSTART] = XonChar;
+	tio.c_cc[VSTOP] = XoffChar;
+	//the port is nonblocking and reads wait in poll, so these only matter to anything that makes it blocking again
+	tio.c_cc[VMIN] = 1;
+	tio.c_cc[VTIME] = 0;
+	if (tcsetattr(serialPort, TCSANOW, &tio) != 0) {
+		int err = errno;
+		out << "Error while setting terminal attributes: " << formatErr(err);
+		return false;
+	}
+	bool linesOk = setModemLine(serialPort, TIOCM_DTR, fDtrControl == 1);
+	if (fRtsControl != 2) linesOk = setModemLine(serialPort, TIOCM_RTS, fRtsControl == 1) && linesOk;
+	if (!linesOk) {
+		int err = errno;
+		out << "Error while setting DTR/RTS: " << formatErr(err);
+		return false;
+	}
+	return true;
+}
+#endif
 
 //attempts to connect to the serial port specified by instance variables, sets its parameters using `setParams`, and starts applicable read/write threads
 //prints error messages or a success message to `out`.
 
-void SerialPort::connect(std::stringstream& out) {
+#ifdef _WIN32
+void SerialPort::connect(ResponseWriter& out) {
 	if (serialPort != nullptr || this->connected) {
 		out << "Already connected, please disconnect first";
 		return;
@@ -99,7 +290,7 @@ void SerialPort::connect(std::stringstream& out) {
 		0,
 		0,
 		OPEN_EXISTING,
-		FILE_ATTRIBUTE_NORMAL,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED,
 		0
 	);
 	if (serialPort == INVALID_HANDLE_VALUE) {
@@ -115,9 +306,12 @@ void SerialPort::connect(std::stringstream& out) {
 	}
 
 	COMMTIMEOUTS timeouts = { 0 };
-	timeouts.ReadIntervalTimeout = 10;
-	timeouts.ReadTotalTimeoutConstant = 10;
-	timeouts.ReadTotalTimeoutMultiplier = 10;
+	//with a ReadIntervalTimeout of 1 and no total timeout, a read waits for the first byte however long it takes and then
+	//finishes once the line goes quiet, so a read is only outstanding on the io_context, costing nothing, until data arrives.
+	//this is what boost::asio::serial_port sets up when it opens a port itself
+	timeouts.ReadIntervalTimeout = 1;
+	timeouts.ReadTotalTimeoutConstant = 0;
+	timeouts.ReadTotalTimeoutMultiplier = 0;
 	timeouts.WriteTotalTimeoutConstant = 10;
 	timeouts.WriteTotalTimeoutMultiplier = 10;
 	if (!SetCommTimeouts(serialPort, &timeouts)) {
@@ -125,42 +319,98 @@ void SerialPort::connect(std::stringstream& out) {
 		out << "Error while setting timeouts: " << formatErr(err);
 		return;
 	}
+	//manual reset, as overlapped I/O wants
+	writeEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+	if (writeEvent == nullptr) {
+		DWORD err = GetLastError();
+		out << "Error while creating events: " << formatErr(err);
+		return;
+	}
+	boost::system::error_code ec;
+	port->assign(serialPort, ec);
+	if (ec) {
+		out << "Error while adding the port to the io_context: " << ec.message();
+		CloseHandle(serialPort);
+		serialPort = nullptr;
+		return;
+	}
+
+	this->rwHandler->startThreads();
+
+	out << "Succesfully connected to serial port";
+}
+#else
+void SerialPort::connect(ResponseWriter& out) {
+	if (serialPort != noSerialHandle || this->connected) {
+		out << "Already connected, please disconnect first";
+		return;
+	}
+	serialPort = open(portName.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+	if (serialPort < 0) {
+		int err = errno;
+		out << "Error while opening serial port: " << formatErr(err);
+		out << portName.c_str();
+		serialPort = noSerialHandle;
+		return;
+	}
+	//only one instance per port, like Windows' exclusive access
+	ioctl(serialPort, TIOCEXCL);
+	if (!setParams(out)) {
+		close(serialPort);
+		serialPort = noSerialHandle;
+		return;
+	}
+	boost::system::error_code ec;
+	port->assign(serialPort, ec);
+	if (ec) {
+		out << "Error while adding the port to the io_context: " << ec.message();
+		close(serialPort);
+		serialPort = noSerialHandle;
+		return;
+	}
 
 	this->rwHandler->startThreads();
 
 	out << "Succesfully connected to serial port";
 }
+#endif
 
 //attempts to disconnect from the connected serial port, and then tells the read/write threads to shut down
 //prints error/success messages to `out`
 
-void SerialPort::disconnect(std::stringstream& out) {
+void SerialPort::disconnect(ResponseWriter& out) {
+	//flushes anything still queued, then cancels the outstanding read, and only then is the port closed
 	this->rwHandler->stopThreads();
-	if (!CloseHandle(serialPort)) {
-		DWORD err = GetLastError();
-		sendFailureArr(out, "Error while disconnecting" + formatErr(err));
+	boost::system::error_code ec;
+	runOnStrand(this->strand, [this, &ec]() { this->port->close(ec); });
+	if (ec) {
+		sendFailureArr(out, "Error while disconnecting", ec.message());
 	}
 	else {
 		sendSuccessArr(out, "Disconnected successfully");
 	}
-	serialPort = nullptr;
+	serialPort = noSerialHandle;
+#ifdef _WIN32
+	if (writeEvent != nullptr) CloseHandle(writeEvent);
+	writeEvent = nullptr;
+#endif
 }
 
 //attempts to start a write thread. may be called before the serial port is connected.
 //prints error/success messages to `out`.
 
-void SerialPort::enableWriteThread(std::stringstream& out) {
+void SerialPort::enableWriteThread(ResponseWriter& out) {
 	this->rwHandler->enableWriteThread(out);
 }
 
 //attempts to write `data` to the serial port, using the write thread if enabled.
-//prints error/success messages to `out`. can not detect whether a threaded write failed.
+//prints error/success messages to `out`. a threaded write reports how it went through the callback instead.
 
-void SerialPort::write(std::string data, std::stringstream& out) {
+void SerialPort::write(std::string_view data, ResponseWriter& out) {
 	this->rwHandler->write(data, out);
 }
 
-void SerialPort::setBaudRate(int newBaudRate, std::stringstream& out) {
+void SerialPort::setBaudRate(int newBaudRate, ResponseWriter& out) {
 	if (newBaudRate < 0 || newBaudRate >= numRates) {
 		sendFailureArr(out, "New baud rate out of range");
 	}
@@ -169,11 +419,11 @@ void SerialPort::setBaudRate(int newBaudRate, std::stringstream& out) {
 		if (isConnected()) {
 			setParams(out);
 		}
-		sendSuccessArr(out, "Set baud rate to index " + std::to_string(newBaudRate) + " (value: " + std::to_string(baudRates[newBaudRate]) + ")");
+		sendSuccessArr(out, "Set baud rate to index ", newBaudRate, " (value: ", baudRates[newBaudRate], ")");
 	}
 }
 
-void SerialPort::setParity(int newParity, std::stringstream& out) {
+void SerialPort::setParity(int newParity, ResponseWriter& out) {
 	if (newParity < 0 || newParity >= numParities) {
 		sendFailureArr(out, "New parity out of range");
 	}
@@ -182,11 +432,11 @@ void SerialPort::setParity(int newParity, std::stringstream& out) {
 		if (isConnected()) {
 			setParams(out);
 		}
-		sendSuccessArr(out, "Set parity to index " + std::to_string(newParity) + " (value: " + parityNames[newParity] + ")");
+		sendSuccessArr(out, "Set parity to index ", newParity, " (value: ", parityNames[newParity], ")");
 	}
 }
 
-void SerialPort::setStopBits(int newStopBits, std::stringstream& out) {
+void SerialPort::setStopBits(int newStopBits, ResponseWriter& out) {
 	if (newStopBits < 0 || newStopBits >= numStopBits) {
 		sendFailureArr(out, "New stop bits out of range");
 	}
@@ -195,11 +445,11 @@ void SerialPort::setStopBits(int newStopBits, std::stringstream& out) {
 		if (isConnected()) {
 			setParams(out);
 		}
-		sendSuccessArr(out, "Set stop bits to index " + std::to_string(newStopBits) + " (value: " + stopBitNames[newStopBits] + ")");
+		sendSuccessArr(out, "Set stop bits to index ", newStopBits, " (value: ", stopBitNames[newStopBits], ")");
 	}
 }
 
-void SerialPort::setDataBits(int newDataBits, std::stringstream& out) {
+void SerialPort::setDataBits(int newDataBits, ResponseWriter& out) {
 	if (newDataBits < 0 || newDataBits >= numDataBits) {
 		sendFailureArr(out, "New data bits out of range");
 	}
@@ -208,1000 +458,1198 @@ void SerialPort::setDataBits(int newDataBits, std::stringstream& out) {
 		if (isConnected()) {
 			setParams(out);
 		}
-		sendSuccessArr(out, "Set data bits to index " + std::to_string(newDataBits) + " (value: " + dataBitNames[newDataBits] + ")");
+		sendSuccessArr(out, "Set data bits to index ", newDataBits, " (value: ", dataBitNames[newDataBits], ")");
 	}
 }
 
-void SerialPort::setFParity(bool newFParity, std::stringstream& out) {
+void SerialPort::setFParity(bool newFParity, ResponseWriter& out) {
 	fParity = newFParity;
 	if (isConnected()) {
 		setParams(out);
 	}
-	sendSuccessArr(out, "Set fParity to " + std::to_string(newFParity));
+	sendSuccessArr(out, "Set fParity to ", newFParity);
 }
 
-void SerialPort::setFOutxCtsFlow(bool newFOutxCtsFlow, std::stringstream& out) {
+void SerialPort::setFOutxCtsFlow(bool newFOutxCtsFlow, ResponseWriter& out) {
 	fOutxCtsFlow = newFOutxCtsFlow;
 	if (isConnected()) {
 		setParams(out);
 	}
-	sendSuccessArr(out, "Set fOutxCtsFlow to " + std::to_string(newFOutxCtsFlow));
+	sendSuccessArr(out, "Set fOutxCtsFlow to ", newFOutxCtsFlow);
 }
 
-void SerialPort::setFOutxDsrFlow(bool newFOutxDsrFlow, std::stringstream& out) {
+void SerialPort::setFOutxDsrFlow(bool newFOutxDsrFlow, ResponseWriter& out) {
 	fOutxDsrFlow = newFOutxDsrFlow;
 	if (isConnected()) {
 		setParams(out);
 	}
-	sendSuccessArr(out, "Set fOutxDsrFlow to " + std::to_string(newFOutxDsrFlow));
+	sendSuccessArr(out, "Set fOutxDsrFlow to ", newFOutxDsrFlow);
 }
 
-void SerialPort::setFDtrControl(int newFDtrControl, std::stringstream& out) {
+void SerialPort::setFDtrControl(int newFDtrControl, ResponseWriter& out) {
 	fDtrControl = newFDtrControl;
 	if (isConnected()) {
 		setParams(out);
 	}
-	sendSuccessArr(out, "Set fDtrControl to " + std::to_string(newFDtrControl));
+	sendSuccessArr(out, "Set fDtrControl to ", newFDtrControl);
 }
 
-void SerialPort::setFDsrSensitivity(bool newFDsrSensitivity, std::stringstream& out) {
+void SerialPort::setFDsrSensitivity(bool newFDsrSensitivity, ResponseWriter& out) {
 	fDsrSensitivity = newFDsrSensitivity;
 	if (isConnected()) {
 		setParams(out);
 	}
-	sendSuccessArr(out, "Set fDsrSensitivity to " + std::to_string(newFDsrSensitivity));
+	sendSuccessArr(out, "Set fDsrSensitivity to ", newFDsrSensitivity);
 }
 
-void SerialPort::setFTXContinueOnXoff(bool newFTXContinueOnXoff, std::stringstream& out) {
+void SerialPort::setFTXContinueOnXoff(bool newFTXContinueOnXoff, ResponseWriter& out) {
 	fTXContinueOnXoff = newFTXContinueOnXoff;
 	if (isConnected()) {
 		setParams(out);
 	}
-	sendSuccessArr(out, "Set fTXContinueOnXoff to " + std::to_string(newFTXContinueOnXoff));
+	sendSuccessArr(out, "Set fTXContinueOnXoff to ", newFTXContinueOnXoff);
 }
 
-void SerialPort::setFOutX(bool newFOutX, std::stringstream& out) {
+void SerialPort::setFOutX(bool newFOutX, ResponseWriter& out) {
 	fOutX = newFOutX;
 	if (isConnected()) {
 		setParams(out);
 	}
-	sendSuccessArr(out, "Set fOutX to " + std::to_string(newFOutX));
+	sendSuccessArr(out, "Set fOutX to ", newFOutX);
 }
 
-void SerialPort::setFInX(bool newFInX, std::stringstream& out) {
+void SerialPort::setFInX(bool newFInX, ResponseWriter& out) {
 	fInX = newFInX;
 	if (isConnected()) {
 		setParams(out);
 	}
-	sendSuccessArr(out, "Set fInX to " + std::to_string(newFInX));
+	sendSuccessArr(out, "Set fInX to ", newFInX);
 }
 
-void SerialPort::setFErrorChar(bool newFErrorChar, std::stringstream& out) {
+void SerialPort::setFErrorChar(bool newFErrorChar, ResponseWriter& out) {
 	fErrorChar = newFErrorChar;
 	if (isConnected()) {
 		setParams(out);
 	}
-	sendSuccessArr(out, "Set fErrorChar to " + std::to_string(newFErrorChar));
+	sendSuccessArr(out, "Set fErrorChar to ", newFErrorChar);
 }
 
-void SerialPort::setFNull(bool newFNull, std::stringstream& out) {
+void SerialPort::setFNull(bool newFNull, ResponseWriter& out) {
 	fNull = newFNull;
 	if (isConnected()) {
 		setParams(out);
 	}
-	sendSuccessArr(out, "Set fNull to " + std::to_string(newFNull));
+	sendSuccessArr(out, "Set fNull to ", newFNull);
 }
 
-void SerialPort::setFRtsControl(int newFRtsControl, std::stringstream& out) {
+void SerialPort::setFRtsControl(int newFRtsControl, ResponseWriter& out) {
 	fRtsControl = newFRtsControl;
 	if (isConnected()) {
 		setParams(out);
 	}
-	sendSuccessArr(out, "Set fRtsControl to " + std::to_string(newFRtsControl));
+	sendSuccessArr(out, "Set fRtsControl to ", newFRtsControl);
 }
 
-void SerialPort::setFAbortOnError(bool newFAbortOnError, std::stringstream& out) {
+void SerialPort::setFAbortOnError(bool newFAbortOnError, ResponseWriter& out) {
 	fAbortOnError = newFAbortOnError;
 	if (isConnected()) {
 		setParams(out);
 	}
-	sendSuccessArr(out, "Set fAbortOnError to " + std::to_string(newFAbortOnError));
+	sendSuccessArr(out, "Set fAbortOnError to ", newFAbortOnError);
 }
 
-void SerialPort::setXonLim(WORD newXonLim, std::stringstream& out) {
+void SerialPort::setXonLim(WORD newXonLim, ResponseWriter& out) {
 	XonLim = newXonLim;
 	if (isConnected()) {
 		setParams(out);
 	}
-	sendSuccessArr(out, "Set XonLim to " + std::to_string(newXonLim));
+	sendSuccessArr(out, "Set XonLim to ", newXonLim);
 }
 
-void SerialPort::setXoffLim(WORD newXoffLim, std::stringstream& out) {
+void SerialPort::setXoffLim(WORD newXoffLim, ResponseWriter& out) {
 	XoffLim = newXoffLim;
 	if (isConnected()) {
 		setParams(out);
 	}
-	sendSuccessArr(out, "Set XoffLim to " + std::to_string(newXoffLim));
+	sendSuccessArr(out, "Set XoffLim to ", newXoffLim);
 }
 
-void SerialPort::setXonChar(char newXonChar, std::stringstream& out) {
+void SerialPort::setXonChar(char newXonChar, ResponseWriter& out) {
 	XonChar = newXonChar;
 	if (isConnected()) {
 		setParams(out);
 	}
-	sendSuccessArr(out, "Set XonChar to char code " + std::to_string((int)newXonChar));
+	sendSuccessArr(out, "Set XonChar to char code ", (int)newXonChar);
 }
 
-void SerialPort::setXoffChar(char newXoffChar, std::stringstream& out) {
+void SerialPort::setXoffChar(char newXoffChar, ResponseWriter& out) {
 	XoffChar = newXoffChar;
 	if (isConnected()) {
 		setParams(out);
 	}
-	sendSuccessArr(out, "Set XoffChar to char code " + std::to_string((int)newXoffChar));
+	sendSuccessArr(out, "Set XoffChar to char code ", (int)newXoffChar);
 }
 
-void SerialPort::setErrorChar(char newErrorChar, std::stringstream& out) {
+void SerialPort::setErrorChar(char newErrorChar, ResponseWriter& out) {
 	ErrorChar = newErrorChar;
 	if (isConnected()) {
 		setParams(out);
 	}
-	sendSuccessArr(out, "Set ErrorChar to char code " + std::to_string((int)newErrorChar));
+	sendSuccessArr(out, "Set ErrorChar to char code ", (int)newErrorChar);
 }
 
-void SerialPort::setEofChar(char newEofChar, std::stringstream& out) {
+void SerialPort::setEofChar(char newEofChar, ResponseWriter& out) {
 	EofChar = newEofChar;
 	if (isConnected()) {
 		setParams(out);
 	}
-	sendSuccessArr(out, "Set EofChar to char code " + std::to_string((int)newEofChar));
+	sendSuccessArr(out, "Set EofChar to char code ", (int)newEofChar);
 }
 
-void SerialPort::setEvtChar(char newEvtChar, std::stringstream& out) {
+void SerialPort::setEvtChar(char newEvtChar, ResponseWriter& out) {
 	EvtChar = newEvtChar;
 	if (isConnected()) {
 		setParams(out);
 	}
-	sendSuccessArr(out, "Set EvtChar to char code " + std::to_string((int)newEvtChar));
+	sendSuccessArr(out, "Set EvtChar to char code ", (int)newEvtChar);
 }
 
 bool SerialPort::destroy() {
 	if (this->connected) return false;
 	serialPorts.erase(this->portNamePretty);
+	doneWithIOContext();
 	return true;
 }
 
-void SerialPort::runInstanceCommand(std::string myId, std::string* argv, int argc, std::stringstream& ans) {
-	std::string& function = argv[0];
+void SerialPort::addStats(IOStatsSnapshot& total) {
+	total += this->rwHandler->getStats();
+}
+
+void SerialPort::runInstanceCommand(std::string_view myId, std::string_view* argv, int argc, ResponseWriter& ans) {
+	std::string_view function = argv[0];
 	argv++;
 	argc--;
-	if (equalsIgnoreCase(function, "getBaudRateIndex")) {
-		//@InstanceCommand serial.getBaudRateIndex
-		//@Args 
-		//@Return The index of the currently set baud rate
-		//@Description Gets the index of the currently set baud rate
-		ans << this->getBaudRate();
-	}
-	else if (equalsIgnoreCase(function, "getBaudRateValue")) {
-		//@InstanceCommand serial.getBaudRateValue
-		//@Args 
-		//@Return The currently set baud rate
-		//@Description Gets the currently set baud rate
-		ans << baudRates[this->getBaudRate()];
-	}
-	else if (equalsIgnoreCase(function, "getParityIndex")) {
-		//@InstanceCommand serial.getParityIndex
-		//@Args 
-		//@Return The index of the currently set parity bit(s)
-		//@Description Gets the index of the currently set parity bit(s)
-		ans << this->getParity();
-	}
-	else if (equalsIgnoreCase(function, "getParityValue")) {
-		//@InstanceCommand serial.getParityValue
-		//@Args 
-		//@Return The currently set parity bit(s)
-		//@Description Gets the currently set parity bit(s)
-		ans << parityNames[this->getParity()];
-	}
-	else if (equalsIgnoreCase(function, "getStopBitsIndex")) {
-		//@InstanceCommand serial.getStopBitsIndex
-		//@Args 
-		//@Return The index of the currently set stop bit(s)
-		//@Description Gets the index of the currently set stop bit(s)
-		ans << this->getStopBits();
-	}
-	else if (equalsIgnoreCase(function, "getStopBitsValue")) {
-		//@InstanceCommand serial.getStopBitsValue
-		//@Args 
-		//@Return The currently set stop bit(s)
-		//@Description Gets the currently set stop bit(s)
-		ans << stopBitNames[this->getStopBits()];
-	}
-	else if (equalsIgnoreCase(function, "getDataBitsIndex")) {
-		//@InstanceCommand serial.getDataBitsIndex
-		//@Args 
-		//@Return The index of the currently set data bits
-		//@Description Gets the index of the currently set data bits
-		ans << this->getDataBits();
-	}
-	else if (equalsIgnoreCase(function, "getDataBitsValue")) {
-		//@InstanceCommand serial.getDataBitsValue
-		//@Args 
-		//@Return The currently set data bits
-		//@Description Gets the currently set data bits
-		ans << dataBitNames[this->getDataBits()];
-	}
-	else if (equalsIgnoreCase(function, "getFParity")) {
-		//@InstanceCommand serial.getFParity
-		//@Args 
-		//@Return `true` or `false` based on the currently set `fParity`
-		//@Description If `true`, parity checking is performed. Default: `false`.
-		ans << this->getFParity();
-	}
-	else if (equalsIgnoreCase(function, "getFOutxCtsFlow")) {
-		//@InstanceCommand serial.getFOutxCtsFlow
-		//@Args 
-		//@Return `true` or `false` based on the currently set `fOutxCtsFlow`
-		//@Description If `true`, the Clear-To-Send signal is monitored, and when the CTS is turned off, output is suspended until the CTS is sent again. Default: `false`.
-		ans << this->getFOutxCtsFlow();
-	}
-	else if (equalsIgnoreCase(function, "getFOutxDsrFlow")) {
-		//@InstanceCommand serial.getFOutxDsrFlow
-		//@Args 
-		//@Return `true` or `false` based on the currently set `fOutxDsrFlow`
-		//@Description If `true`, the Data-Set-Ready signal is monitored, and when the DSR is turned off, output is suspended until the DSR is sent again. Default: `false`.
-		ans << this->getFOutxDsrFlow();
-	}
-	else if (equalsIgnoreCase(function, "getFDtrControl")) {
-		//@InstanceCommand serial.getFDtrControl
-		//@Args 
-		//@Return `0`, `1`, or `2` based on the currently set `fDtrControl`
-		//@Description If `0`, the Data-Terminal-Ready line is disabled. If `1`, the DTR line is enabled and left on. If `2`, it is an error to adjust the DTR line. Default: `1`.
-		ans << this->getFDtrControl();
-	}
-	else if (equalsIgnoreCase(function, "getFDsrSensitivity")) {
-		//@InstanceCommand serial.getFDsrSensitivity
-		//@Args 
-		//@Return `true` or `false` based on the currently set `fDsrSensitivity`
-		//@Description If `true`, the driver is sensitive to the state of the DSR signal - all recieved bytes will be ignored unless the DSR input line is high. Default: `false`.
-		ans << this->getFDsrSensitivity();
-	}
-	else if (equalsIgnoreCase(function, "getFTXContinueOnXoff")) {
-		//@InstanceCommand serial.getFTXContinueOnXoff
-		//@Args 
-		//@Return `true` or `false` based on the currently set `fTXContinueOnXoff`
-		//@Description If `true`, transmission continues after the input buffer has come within `XoffLim` bytes of being full and the driver has transmitted the `XoffChar` character to stop receiving bytes. If `false`, transmission does not continue until the input buffer is within `XonLim` bytes of being empty and the driver has transmitted the `XonChar` character to resume reception. Default: `false`.
-		ans << this->getFTXContinueOnXoff();
-	}
-	else if (equalsIgnoreCase(function, "getFOutX")) {
-		//@InstanceCommand serial.getFOutX
-		//@Args 
-		//@Return `true` or `false` based on the currently set `fOutX`
-		//@Description If `true`, transmission stops when the `XoffChar` character is received and starts again when the `XonChar` character is received. Default: `false`.
-		ans << this->getFOutX();
-	}
-	else if (equalsIgnoreCase(function, "getFInX")) {
-		//@InstanceCommand serial.getFInX
-		//@Args 
-		//@Return `true` or `false` based on the currently set `fInX`
-		//@Description If `true`, the `XoffChar` character is sent when the input buffer comes within `XoffLim` bytes of being full, and the `XonChar` character is sent when the input buffer comes within `XonLim` bytes of being empty. Defualt: `false`.
-		ans << this->getFInX();
-	}
-	else if (equalsIgnoreCase(function, "getFErrorChar")) {
-		//@InstanceCommand serial.getFErrorChar
-		//@Args 
-		//@Return `true` or `false` based on the currently set `fErrorChar`
-		//@Description If `true` and `fParity` is true, bytes received with parity errors are replaced with `ErrorChar`. Defualt: `false`.
-		ans << this->getFErrorChar();
-	}
-	else if (equalsIgnoreCase(function, "getFNull")) {
-		//@InstanceCommand serial.getFNull
-		//@Args 
-		//@Return `true` or `false` based on the currently set `fNull`
-		//@Description If `true`, null bytes are discarded when received. Defualt: `false`.
-		ans << this->getFNull();
-	}
-	else if (equalsIgnoreCase(function, "getFRtsControl")) {
-		//@InstanceCommand serial.getFRtsControl
-		//@Args 
-		//@Return `0`, `1`, `2`, or `3` based on the currently set `fRtsControl`
-		//@Description If `0`, the Request-To-Send line is disabled. If `1`, the RTS line is opened and left on. If `2`, RTS handshaking is enabled - the drived raises the RTS line when the input buffer is less than one half full and lowers the RTS line when the buffer is more than three quarters full, and it is an error to adjust the RTS line. If `3`, the RTS line will be high if bytes are available for transmission, and after all buffered bytes have been sent, the RTS line will be low. Default: `1`.
-		ans << this->getFRtsControl();
-	}
-	else if (equalsIgnoreCase(function, "getFAbortOnError")) {
-		//@InstanceCommand serial.getFAbortOnError
-		//@Args 
-		//@Return `true` or `false` based on the currently set `fAbortOnError`
-		//@Description If `true`, the driver terminates all read and write operations with an error status if an error occurs. The driver will not accept any further communications until the extension clears the error (currently not implemented). Default: `false`.
-		ans << this->getFAbortOnError();
-	}
-	else if (equalsIgnoreCase(function, "getXonLim")) {
-		//@InstanceCommand serial.getXonLim
-		//@Args 
-		//@Return The current XonLim
-		//@Description See `fInX`, `fRtsControl`, and `fDtrControl`. Default: `2048`.
-		ans << this->getXonLim();
-	}
-	else if (equalsIgnoreCase(function, "getXoffLim")) {
-		//@InstanceCommand serial.getXoffLim
-		//@Args 
-		//@Return The current XoffChar
-		//@Description See `fInX`, `fRtsControl`, and `fDtrControl`. Default: `512`.
-		ans << this->getXoffLim();
-	}
-	else if (equalsIgnoreCase(function, "getXonChar")) {
-		//@InstanceCommand serial.getXonChar
-		//@Args 
-		//@Return The current ASCII charcode of XonChar
-		//@Description Default: `17` (device control 1).
-		ans << this->getXonChar();
-	}
-	else if (equalsIgnoreCase(function, "getXoffChar")) {
-		//@InstanceCommand serial.getXoffChar
-		//@Args 
-		//@Return The current ASCII charcode of XoffChar
-		//@Description Default: `19` (device control 3).
-		ans << this->getXoffChar();
-	}
-	else if (equalsIgnoreCase(function, "getErrorChar")) {
-		//@InstanceCommand serial.getErrorChar
-		//@Args 
-		//@Return The current ASCII charcode of errorChar
-		//@Description Default: `0`. 
-		ans << this->getErrorChar();
-	}
-	else if (equalsIgnoreCase(function, "getEofChar")) {
-		//@InstanceCommand serial.getEofChar
-		//@Args 
-		//@Return The current ASCII charcode of eofChar
-		//@Description The character used to signal the end of data. Default: `0`.
-		ans << this->getEofChar();
-	}
-	else if (equalsIgnoreCase(function, "getEvtChar")) {
-		//@InstanceCommand serial.getEvtChar
-		//@Args 
-		//@Return The current ASCII charcode of evtChar
-		//@Description The character used to signal an event. Default: `0`.
-		ans << this->getEvtChar();
-	}
-	else if (equalsIgnoreCase(function, "isUsingWriteThread")) {
-		//@InstanceCommand serial.isUsingWriteThread
-		//@Args 
-		//@Return `true` or `false` based on whether this serial port is using a thread for writes
-		//@Description May dramatically improve performance. See the main header of this communication method for more information.
-		ans << this->isUsingWriteThread();
-	}
-	else if (equalsIgnoreCase(function, "setBaudRate")) {
-		//@InstanceCommand serial.setBaudRate
-		//@Args baudRateIndex: int
-		//@Return A failure or success message
-		//@Description Sets the baud rate. `baudRateIndex` is the index of the desired baud rate (from `listBaudRates`).
-		if (argc == 0) {
-			sendFailureArr(ans, "Additional argument required");
-			return;
-		}
-		try {
-			int val = std::stoi(argv[0]);
-			this->setBaudRate(val, ans);
-		}
-		catch (std::exception e) {
-			sendFailureArr(ans, "Exception parsing input: " + std::string(e.what()));
-		}
-	}
-	else if (equalsIgnoreCase(function, "setParity")) {
-		//@InstanceCommand serial.setParity
-		//@Args parityIndex: int
-		//@Return A failure or success message
-		//@Description Sets the parity. `parityIndex` is the index of the desired parity (from `listParities`).
-		if (argc == 0) {
-			sendFailureArr(ans, "Additional argument required");
-			return;
-		}
-		try {
-			int val = std::stoi(argv[0]);
-			this->setParity(val, ans);
-		}
-		catch (std::exception e) {
-			sendFailureArr(ans, "Exception parsing input: " + std::string(e.what()));
-		}
-	}
-	else if (equalsIgnoreCase(function, "setStopBits")) {
-		//@InstanceCommand serial.setStopBits
-		//@Args stopBitsIndex: int
-		//@Return A failure or success message
-		//@Description Sets the stop bit(s). `stopBitsIndex` is the index of the desired stop bit(s) (from `listStopBits`).
-		if (argc == 0) {
-			sendFailureArr(ans, "Additional argument required");
-			return;
-		}
-		try {
-			int val = std::stoi(argv[0]);
-			this->setStopBits(val, ans);
-		}
-		catch (std::exception e) {
-			sendFailureArr(ans, "Exception parsing input: " + std::string(e.what()));
-		}
-	}
-	else if (equalsIgnoreCase(function, "setDataBits")) {
-		//@InstanceCommand serial.setDataBits
-		//@Args dataBitsIndex: int
-		//@Return A failure or success message
-		//@Description Sets the data bits. `dataBitsIndex` is the index of the desired baud rate (from `listDataBits`).
-		if (argc == 0) {
-			sendFailureArr(ans, "Additional argument required");
-			return;
-		}
-		try {
-			int val = std::stoi(argv[0]);
-			this->setDataBits(val, ans);
-		}
-		catch (std::exception e) {
-			sendFailureArr(ans, "Exception parsing input: " + std::string(e.what()));
-		}
-	}
-	else if (equalsIgnoreCase(function, "setFParity")) {
-		//@InstanceCommand serial.setFParity
-		//@Args fParity: bool
-		//@Return A failure or success message
-		//@Description Sets `fParity`. If `true`, parity checking is performed. Default: `false`.
-		if (argc == 0) {
-			sendFailureArr(ans, "Additional argument required");
-			return;
-		}
-		bool val;
-		if (argv[0] == "true" || argv[0] == "1") val = true;
-		else if (argv[0] == "false" || argv[0] == "0") val = false;
-		else {
-			ans << "Expected true, false, 1, or 0";
-			return;
-		}
-		this->setFParity(val, ans);
-	}
-	else if (equalsIgnoreCase(function, "setFOutxCtsFlow")) {
-		//@InstanceCommand serial.setFOutxCtsFlow
-		//@Args fOutxCtsFlow: bool
-		//@Return A failure or success message
-		//@Description Sets `fOutxCtsFlow`. If `true`, the Clear-To-Send signal is monitored, and when the CTS is turned off, output is suspended until the CTS is sent again. Default: `false`.
-		if (argc == 0) {
-			sendFailureArr(ans, "Additional argument required");
-			return;
-		}
-		bool val;
-		if (argv[0] == "true" || argv[0] == "1") val = true;
-		else if (argv[0] == "false" || argv[0] == "0") val = false;
-		else {
-			sendFailureArr(ans, "Expected true, false, 1, or 0");
-			return;
-		}
-		this->setFOutxCtsFlow(val, ans);
-	}
-	else if (equalsIgnoreCase(function, "setFOutxDsrFlow")) {
-		//@InstanceCommand serial.setFOutxDsrFlow
-		//@Args fOutxDsrFlow: bool
-		//@Return A failure or success message
-		//@Description Sets fOutxDsrFlow. If `true`, the Data-Set-Ready signal is monitored, and when the DSR is turned off, output is suspended until the DSR is sent again. Default: `false`.
-		if (argc == 0) {
-			sendFailureArr(ans, "Additional argument required");
-			return;
-		}
-		bool val;
-		if (argv[0] == "true" || argv[0] == "1") val = true;
-		else if (argv[0] == "false" || argv[0] == "0") val = false;
-		else {
-			sendFailureArr(ans, "Expected true, false, 1, or 0");
-			return;
-		}
-		this->setFOutxDsrFlow(val, ans);
-	}
-	else if (equalsIgnoreCase(function, "setFDtrControl")) {
-		//@InstanceCommand serial.setFDtrControl
-		//@Args fDtsControl: 0 | 1 | 2
-		//@Return A failure or success message
-		//@Description Sets fDtrControl. If `0`, the Data-Terminal-Ready line is disabled. If `1`, the DTR line is enabled and left on. If `2`, it is an error to adjust the DTR line. Default: `1`.
-		if (argc == 0) {
-			sendFailureArr(ans, "Additional argument required");
-			return;
-		}
-		int val;
-		if (argv[0] == "0") val = 0;
-		else if (argv[0] == "1") val = 1;
-		else if (argv[0] == "2") val = 2;
-		else {
-			sendFailureArr(ans, "Expected true, false, 1, or 0");
-			return;
-		}
-		this->setFDtrControl(val, ans);
-	}
-	else if (equalsIgnoreCase(function, "setFDsrSensitivity")) {
-		//@InstanceCommand serial.setFDsrSensitivity
-		//@Args fDsrSensitivity: bool
-		//@Return A failure or success message
-		//@Description Sets fDsrSensitivity. If `true`, the driver is sensitive to the state of the DSR signal - all recieved bytes will be ignored unless the DSR input line is high. Default: `false`.
-		if (argc == 0) {
-			sendFailureArr(ans, "Additional argument required");
-			return;
-		}
-		bool val;
-		if (argv[0] == "true" || argv[0] == "1") val = true;
-		else if (argv[0] == "false" || argv[0] == "0") val = false;
-		else {
-			sendFailureArr(ans, "Expected true, false, 1, or 0");
-			return;
-		}
-		this->setFDsrSensitivity(val, ans);
-	}
-	else if (equalsIgnoreCase(function, "setFTXContinueOnXoff")) {
-		//@InstanceCommand serial.setFTXContinueOnXoff
-		//@Args fTXContinueOnXoff: bool
-		//@Return A failure or success message
-		//@Description Sets fTXContinueOnXoff. If `true`, transmission continues after the input buffer has come within `XoffLim` bytes of being full and the driver has transmitted the `XoffChar` character to stop receiving bytes. If `false`, transmission does not continue until the input buffer is within `XonLim` bytes of being empty and the driver has transmitted the `XonChar` character to resume reception. Default: `false`.
-		if (argc == 0) {
-			sendFailureArr(ans, "Additional argument required");
-			return;
-		}
-		bool val;
-		if (argv[0] == "true" || argv[0] == "1") val = true;
-		else if (argv[0] == "false" || argv[0] == "0") val = false;
-		else {
-			sendFailureArr(ans, "Expected true, false, 1, or 0");
-			return;
-		}
-		this->setFTXContinueOnXoff(val, ans);
-	}
-	else if (equalsIgnoreCase(function, "setFOutX")) {
-		//@InstanceCommand serial.setFOutX
-		//@Args fOutX: bool
-		//@Return A failure or success message
-		//@Description Sets fOutX. If `true`, transmission stops when the `XoffChar` character is received and starts again when the `XonChar` character is received. Default: `false`.
-		if (argc == 0) {
-			sendFailureArr(ans, "Additional argument required");
-			return;
-		}
-		bool val;
-		if (argv[0] == "true" || argv[0] == "1") val = true;
-		else if (argv[0] == "false" || argv[0] == "0") val = false;
-		else {
-			sendFailureArr(ans, "Expected true, false, 1, or 0");
-			return;
-		}
-		this->setFOutX(val, ans);
-	}
-	else if (equalsIgnoreCase(function, "setFInX")) {
-		//@InstanceCommand serial.setFInX
-		//@Args fInX: bool
-		//@Return A failure or success message
-		//@Description Sets fInX. If `true`, the `XoffChar` character is sent when the input buffer comes within `XoffLim` bytes of being full, and the `XonChar` character is sent when the input buffer comes within `XonLim` bytes of being empty. Defualt: `false`.
-		if (argc == 0) {
-			sendFailureArr(ans, "Additional argument required");
-			return;
-		}
-		bool val;
-		if (argv[0] == "true" || argv[0] == "1") val = true;
-		else if (argv[0] == "false" || argv[0] == "0") val = false;
-		else {
-			sendFailureArr(ans, "Expected true, false, 1, or 0");
-			return;
-		}
-		this->setFInX(val, ans);
-	}
-	else if (equalsIgnoreCase(function, "setFErrorChar")) {
-		//@InstanceCommand serial.setFErrorChar
-		//@Args fErrorChar: bool
-		//@Return A failure or success message
-		//@Description Sets fErrorChar. If `true` and `fParity` is true, bytes received with parity errors are replaced with `ErrorChar`. Defualt: `false`.
-		if (argc == 0) {
-			sendFailureArr(ans, "Additional argument required");
-			return;
-		}
-		bool val;
-		if (argv[0] == "true" || argv[0] == "1") val = true;
-		else if (argv[0] == "false" || argv[0] == "0") val = false;
-		else {
-			sendFailureArr(ans, "Expected true, false, 1, or 0");
-			return;
-		}
-		this->setFErrorChar(val, ans);
-	}
-	else if (equalsIgnoreCase(function, "setFNull")) {
-		//@InstanceCommand serial.setFNull
-		//@Args fNull: bool
-		//@Return A failure or success message
-		//@Description Sets fNull. If `true`, null bytes are discarded when received. Defualt: `false.
-		if (argc == 0) {
-			sendFailureArr(ans, "Additional argument required");
-			return;
-		}
-		bool val;
-		if (argv[0] == "true" || argv[0] == "1") val = true;
-		else if (argv[0] == "false" || argv[0] == "0") val = false;
-		else {
-			sendFailureArr(ans, "Expected true, false, 1, or 0");
-			return;
-		}
-		this->setFNull(val, ans);
-	}
-	else if (equalsIgnoreCase(function, "setFRtsControl")) {
-		//@InstanceCommand serial.setFRtsControl
-		//@Args fRtsControl: 0 | 1 | 2 | 3
-		//@Return A failure or success message
-		//@Description Sets fRtsControl. If `0`, the Request-To-Send line is disabled. If `1`, the RTS line is opened and left on. If `2`, RTS handshaking is enabled - the drived raises the RTS line when the input buffer is less than one half full and lowers the RTS line when the buffer is more than three quarters full, and it is an error to adjust the RTS line. If `3`, the RTS line will be high if bytes are available for transmission, and after all buffered bytes have been sent, the RTS line will be low. Default: `1`.
-		if (argc == 0) {
-			sendFailureArr(ans, "Additional argument required");
-			return;
-		}
-		int val;
-		if (argv[0] == "0") val = 0;
-		else if (argv[0] == "1") val = 1;
-		else if (argv[0] == "2") val = 2;
-		else if (argv[0] == "3") val = 3;
-		else {
-			sendFailureArr(ans, "Expected 0, 1, 2, or 3");
-			return;
-		}
-		this->setFRtsControl(val, ans);
-	}
-	else if (equalsIgnoreCase(function, "setFAbortOnError")) {
-		//@InstanceCommand serial.setFAbortOnError
-		//@Args fAbortOnError: bool
-		//@Return A failure or success message
-		//@Description Sets fAbortOnError. If `true`, the driver terminates all read and write operations with an error status if an error occurs. The driver will not accept any further communications until the extension clears the error (currently not implemented). Default: `false`.
-		if (argc == 0) {
-			sendFailureArr(ans, "Additional argument required");
-			return;
-		}
-		bool val;
-		if (argv[0] == "true" || argv[0] == "1") val = true;
-		else if (argv[0] == "false" || argv[0] == "0") val = false;
-		else {
-			sendFailureArr(ans, "Expected true, false, 1, or 0");
-			return;
-		}
-		this->setFAbortOnError(val, ans);
-	}
-	else if (equalsIgnoreCase(function, "setXonLim")) {
-		//@InstanceCommand serial.setXonLim
-		//@Args XonLim: int
-		//@Return A failure or success message
-		//@Description Sets XonLim. See `fInX`, `fRtsControl`, and `fDtrControl`. Default: `2048`.
-		if (argc == 0) {
-			sendFailureArr(ans, "Additional argument required");
-			return;
-		}
-		try {
-			int val = std::stoi(argv[0]);
-			this->setXonLim(val, ans);
-		}
-		catch (std::exception e) {
-			sendFailureArr(ans, "Exception parsing input: " + std::string(e.what()));
-		}
-	}
-	else if (equalsIgnoreCase(function, "setXoffLim")) {
-		//@InstanceCommand serial.setXoffLim
-		//@Args XoffLim: int
-		//@Return A failure or success message
-		//@Description Sets XoffLim. See `fInX`, `fRtsControl`, and `fDtrControl`. Default: `512`.
-		if (argc == 0) {
-			sendFailureArr(ans, "Additional argument required");
-			return;
-		}
-		try {
-			int val = std::stoi(argv[0]);
-			this->setXoffLim(val, ans);
-		}
-		catch (std::exception e) {
-			sendFailureArr(ans, "Exception parsing input: " + std::string(e.what()));
-		}
-	}
-	else if (equalsIgnoreCase(function, "setXonChar")) {
-		//@InstanceCommand serial.setXonChar
-		//@Args XonChar: int
-		//@Return A failure or success message
-		//@Description Sets XonChar. XonChar is an integer ASCII code, e.g. `65` for "A". Default: `17` (device control 1).
-		if (argc == 0) {
-			sendFailureArr(ans, "Additional argument required");
-			return;
-		}
-		try {
-			int val = std::stoi(argv[0]);
-			this->setXonChar(val, ans);
-		}
-		catch (std::exception e) {
-			sendFailureArr(ans, "Exception parsing input: " + std::string(e.what()));
-		}
-	}
-	else if (equalsIgnoreCase(function, "setXoffChar")) {
-		//@InstanceCommand serial.setXoffChar
-		//@Args XoffChar: int
-		//@Return A failure or success message
-		//@Description Sets XoffChar. XoffChar is an integer ASCII code, e.g. `65` for "A". Default: `19` (device control 3).
-		if (argc == 0) {
-			sendFailureArr(ans, "Additional argument required");
-			return;
-		}
-		try {
-			int val = std::stoi(argv[0]);
-			this->setXoffChar(val, ans);
-		}
-		catch (std::exception e) {
-			sendFailureArr(ans, "Exception parsing input: " + std::string(e.what()));
-		}
-	}
-	else if (equalsIgnoreCase(function, "setErrorChar")) {
-		//@InstanceCommand serial.setErrorChar
-		//@Args ErrorChar: int
-		//@Return A failure or success message
-		//@Description Sets ErrorChar. ErrorChar is an integer ASCII code, e.g. `65` for "A". Default: `0`.
-		if (argc == 0) {
-			sendFailureArr(ans, "Additional argument required");
-			return;
-		}
-		try {
-			int val = std::stoi(argv[0]);
-			this->setErrorChar(val, ans);
-		}
-		catch (std::exception e) {
-			sendFailureArr(ans, "Exception parsing input: " + std::string(e.what()));
-		}
-	}
-	else if (equalsIgnoreCase(function, "setEofChar")) {
-		//@InstanceCommand serial.setEofChar
-		//@Args EofChar: int
-		//@Return A failure or success message
-		//@Description Sets EofChar. EofChar is an integer ASCII code, e.g. `65` for "A". The character used to signal the end of data. Default: `0`.
-		if (argc == 0) {
-			sendFailureArr(ans, "Additional argument required");
-			return;
-		}
-		try {
-			int val = std::stoi(argv[0]);
-			this->setEofChar(val, ans);
-		}
-		catch (std::exception e) {
-			sendFailureArr(ans, "Exception parsing input: " + std::string(e.what()));
-		}
-	}
-	else if (equalsIgnoreCase(function, "setEvtChar")) {
-		//@InstanceCommand serial.setEvtChar
-		//@Args EvtChar: int
-		//@Return A failure or success message
-		//@Description Sets EvtChar. EvtChar is an integer ASCII code, e.g. `65` for "A". The character used to signal an event. Default: `0`.
-		if (argc == 0) {
-			sendFailureArr(ans, "Additional argument required");
-			return;
-		}
-		try {
-			int val = std::stoi(argv[0]);
-			this->setEvtChar(val, ans);
-		}
-		catch (std::exception e) {
-			sendFailureArr(ans, "Exception parsing input: " + std::string(e.what()));
-		}
-	}
-	else if (equalsIgnoreCase(function, "enableThreadedWrites")) {
-		//@InstanceCommand serial.enableThreadedWrites
-		//@Args 
-		//@Return Success or failure message
-		//@Description Attempts to begin using a separate thread for writing. May dramatically reduce the time `write` calls take to return to SQF. See the README for more information.
-		this->enableWriteThread(ans);
-	}
-	else if (equalsIgnoreCase(function, "callbackOnChar")) {
-		//@InstanceCommand serial.callbackOnChar
-		//@Args charToLookFor: char
-		//@Return 
-		//@Description Makes the extension send data read from this port back to Arma when `charToLookFor`, specified as a `char`, is read.
-		//@Description When the character is read, all data up to and **excluding** that character is sent back to Arma via the callback.
-		if (argc == 0 || argv[0].length() == 0) {
-			sendFailureArr(ans, "Additional argument required");
-			return;
-		}
-		this->rwHandler->callbackOnChar(argv[0][0]);
-	}
-	else if (equalsIgnoreCase(function, "callbackOnCharCode")) {
-		//@InstanceCommand serial.callbackOnCharCode
-		//@Args charCodeToLookFor: int
-		//@Return 
-		//@Description Makes the extension send data read from this port back to Arma when the character described by `charCodeToLookFor`, specified as an ASCII char code e.g. `65` for "A", is read.
-		//@Description When the character is read, all data read since the last callback, up to and **excluding** that character, is sent back to Arma via the callback.
-		if (argc == 0 || argv[0].length() == 0) {
-			sendFailureArr(ans, "Additional argument required");
-			return;
-		}
-		try {
-			int val = std::stoi(argv[0]);
-			this->rwHandler->callbackOnChar((char)val);
-		}
-		catch (std::exception e) {
-			sendFailureArr(ans, "Exception parsing input: " + std::string(e.what()));
-		}
-	}
-	else if (equalsIgnoreCase(function, "callbackOnLength")) {
-		//@InstanceCommand serial.callbackOnLength
-		//@Args lengthToStopAt: int
-		//@Return 
-		//@Description Makes the extension send data read from this port back to Arma when the total amount of data read reaches `lengthToStopAt` characters long.
-		//@Description When the target amount of data is read, all data read since the last callback is sent back to Arma via the callback.
-		if (argc == 0 || argv[0].length() == 0) {
-			sendFailureArr(ans, "Additional argument required");
-			return;
-		}
-		try {
-			int val = std::stoi(argv[0]);
-			if (val < 1) {
-				sendFailureArr(ans, "Length must be at least 1");
+	static const CommandTable<SerialPort> commands = {
+		{ "getBaudRateIndex", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.getBaudRateIndex
+			//@Args 
+			//@Return The index of the currently set baud rate
+			//@Description Gets the index of the currently set baud rate
+			ans << self->getBaudRate();
+		} },
+		{ "getBaudRateValue", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.getBaudRateValue
+			//@Args 
+			//@Return The currently set baud rate
+			//@Description Gets the currently set baud rate
+			ans << baudRates[self->getBaudRate()];
+		} },
+		{ "getParityIndex", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.getParityIndex
+			//@Args 
+			//@Return The index of the currently set parity bit(s)
+			//@Description Gets the index of the currently set parity bit(s)
+			ans << self->getParity();
+		} },
+		{ "getParityValue", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.getParityValue
+			//@Args 
+			//@Return The currently set parity bit(s)
+			//@Description Gets the currently set parity bit(s)
+			ans << parityNames[self->getParity()];
+		} },
+		{ "getStopBitsIndex", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.getStopBitsIndex
+			//@Args 
+			//@Return The index of the currently set stop bit(s)
+			//@Description Gets the index of the currently set stop bit(s)
+			ans << self->getStopBits();
+		} },
+		{ "getStopBitsValue", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.getStopBitsValue
+			//@Args 
+			//@Return The currently set stop bit(s)
+			//@Description Gets the currently set stop bit(s)
+			ans << stopBitNames[self->getStopBits()];
+		} },
+		{ "getDataBitsIndex", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.getDataBitsIndex
+			//@Args 
+			//@Return The index of the currently set data bits
+			//@Description Gets the index of the currently set data bits
+			ans << self->getDataBits();
+		} },
+		{ "getDataBitsValue", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.getDataBitsValue
+			//@Args 
+			//@Return The currently set data bits
+			//@Description Gets the currently set data bits
+			ans << dataBitNames[self->getDataBits()];
+		} },
+		{ "getFParity", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.getFParity
+			//@Args 
+			//@Return `true` or `false` based on the currently set `fParity`
+			//@Description If `true`, parity checking is performed. Default: `false`.
+			ans << self->getFParity();
+		} },
+		{ "getFOutxCtsFlow", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.getFOutxCtsFlow
+			//@Args 
+			//@Return `true` or `false` based on the currently set `fOutxCtsFlow`
+			//@Description If `true`, the Clear-To-Send signal is monitored, and when the CTS is turned off, output is suspended until the CTS is sent again. Default: `false`.
+			ans << self->getFOutxCtsFlow();
+		} },
+		{ "getFOutxDsrFlow", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.getFOutxDsrFlow
+			//@Args 
+			//@Return `true` or `false` based on the currently set `fOutxDsrFlow`
+			//@Description If `true`, the Data-Set-Ready signal is monitored, and when the DSR is turned off, output is suspended until the DSR is sent again. Default: `false`.
+			ans << self->getFOutxDsrFlow();
+		} },
+		{ "getFDtrControl", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.getFDtrControl
+			//@Args 
+			//@Return `0`, `1`, or `2` based on the currently set `fDtrControl`
+			//@Description If `0`, the Data-Terminal-Ready line is disabled. If `1`, the DTR line is enabled and left on. If `2`, it is an error to adjust the DTR line. Default: `1`.
+			ans << self->getFDtrControl();
+		} },
+		{ "getFDsrSensitivity", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.getFDsrSensitivity
+			//@Args 
+			//@Return `true` or `false` based on the currently set `fDsrSensitivity`
+			//@Description If `true`, the driver is sensitive to the state of the DSR signal - all recieved bytes will be ignored unless the DSR input line is high. Default: `false`.
+			ans << self->getFDsrSensitivity();
+		} },
+		{ "getFTXContinueOnXoff", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.getFTXContinueOnXoff
+			//@Args 
+			//@Return `true` or `false` based on the currently set `fTXContinueOnXoff`
+			//@Description If `true`, transmission continues after the input buffer has come within `XoffLim` bytes of being full and the driver has transmitted the `XoffChar` character to stop receiving bytes. If `false`, transmission does not continue until the input buffer is within `XonLim` bytes of being empty and the driver has transmitted the `XonChar` character to resume reception. Default: `false`.
+			ans << self->getFTXContinueOnXoff();
+		} },
+		{ "getFOutX", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.getFOutX
+			//@Args 
+			//@Return `true` or `false` based on the currently set `fOutX`
+			//@Description If `true`, transmission stops when the `XoffChar` character is received and starts again when the `XonChar` character is received. Default: `false`.
+			ans << self->getFOutX();
+		} },
+		{ "getFInX", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.getFInX
+			//@Args 
+			//@Return `true` or `false` based on the currently set `fInX`
+			//@Description If `true`, the `XoffChar` character is sent when the input buffer comes within `XoffLim` bytes of being full, and the `XonChar` character is sent when the input buffer comes within `XonLim` bytes of being empty. Defualt: `false`.
+			ans << self->getFInX();
+		} },
+		{ "getFErrorChar", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.getFErrorChar
+			//@Args 
+			//@Return `true` or `false` based on the currently set `fErrorChar`
+			//@Description If `true` and `fParity` is true, bytes received with parity errors are replaced with `ErrorChar`. Defualt: `false`.
+			ans << self->getFErrorChar();
+		} },
+		{ "getFNull", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.getFNull
+			//@Args 
+			//@Return `true` or `false` based on the currently set `fNull`
+			//@Description If `true`, null bytes are discarded when received. Defualt: `false`.
+			ans << self->getFNull();
+		} },
+		{ "getFRtsControl", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.getFRtsControl
+			//@Args 
+			//@Return `0`, `1`, `2`, or `3` based on the currently set `fRtsControl`
+			//@Description If `0`, the Request-To-Send line is disabled. If `1`, the RTS line is opened and left on. If `2`, RTS handshaking is enabled - the drived raises the RTS line when the input buffer is less than one half full and lowers the RTS line when the buffer is more than three quarters full, and it is an error to adjust the RTS line. If `3`, the RTS line will be high if bytes are available for transmission, and after all buffered bytes have been sent, the RTS line will be low. Default: `1`.
+			ans << self->getFRtsControl();
+		} },
+		{ "getFAbortOnError", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.getFAbortOnError
+			//@Args 
+			//@Return `true` or `false` based on the currently set `fAbortOnError`
+			//@Description If `true`, the driver terminates all read and write operations with an error status if an error occurs. The driver will not accept any further communications until the extension clears the error (currently not implemented). Default: `false`.
+			ans << self->getFAbortOnError();
+		} },
+		{ "getXonLim", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.getXonLim
+			//@Args 
+			//@Return The current XonLim
+			//@Description See `fInX`, `fRtsControl`, and `fDtrControl`. Default: `2048`.
+			ans << self->getXonLim();
+		} },
+		{ "getXoffLim", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.getXoffLim
+			//@Args 
+			//@Return The current XoffChar
+			//@Description See `fInX`, `fRtsControl`, and `fDtrControl`. Default: `512`.
+			ans << self->getXoffLim();
+		} },
+		{ "getXonChar", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.getXonChar
+			//@Args 
+			//@Return The current ASCII charcode of XonChar
+			//@Description Default: `17` (device control 1).
+			ans << self->getXonChar();
+		} },
+		{ "getXoffChar", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.getXoffChar
+			//@Args 
+			//@Return The current ASCII charcode of XoffChar
+			//@Description Default: `19` (device control 3).
+			ans << self->getXoffChar();
+		} },
+		{ "getErrorChar", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.getErrorChar
+			//@Args 
+			//@Return The current ASCII charcode of errorChar
+			//@Description Default: `0`. 
+			ans << self->getErrorChar();
+		} },
+		{ "getEofChar", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.getEofChar
+			//@Args 
+			//@Return The current ASCII charcode of eofChar
+			//@Description The character used to signal the end of data. Default: `0`.
+			ans << self->getEofChar();
+		} },
+		{ "getEvtChar", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.getEvtChar
+			//@Args 
+			//@Return The current ASCII charcode of evtChar
+			//@Description The character used to signal an event. Default: `0`.
+			ans << self->getEvtChar();
+		} },
+		{ "isUsingWriteThread", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.isUsingWriteThread
+			//@Args 
+			//@Return `true` or `false` based on whether this serial port is using a thread for writes
+			//@Description May dramatically improve performance. See the main header of this communication method for more information.
+			ans << self->isUsingWriteThread();
+		} },
+		{ "setBaudRate", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.setBaudRate
+			//@Args baudRateIndex: int
+			//@Return A failure or success message
+			//@Description Sets the baud rate. `baudRateIndex` is the index of the desired baud rate (from `listBaudRates`).
+			if (argc == 0) {
+				sendFailureArr(ans, "Additional argument required");
 				return;
 			}
-			this->rwHandler->callbackOnLength(val);
-		}
-		catch (std::exception e) {
-			sendFailureArr(ans, "Exception parsing input: " + std::string(e.what()));
-		}
-	}
-	else if (equalsIgnoreCase(function, "isConnected")) {
-		//@InstanceCommand serial.isConnected
-		//@Args 
-		//@Return `true` or `false` based on whether this instance is currently connected to the port it describes
-		//@Description
-		ans << this->isConnected();
-	}
-	else if (equalsIgnoreCase(function, "connect")) {
-		//@InstanceCommand serial.connect
-		//@Args 
-		//@Return A success or failure message
-		//@Description Attempts to connect to the port described by this instance.
-		this->connect(ans);
-	}
-	else if (equalsIgnoreCase(function, "disconnect")) {
-		//@InstanceCommand serial.disconnect
-		//@Args 
-		//@Return A success or failure message
-		//@Description Attempts to disconnect from the port described by this instance.
-		//@Description If threaded writes are enabled, the extension will attempt to flush the remaining data **synchronously** before disconnecting.
-		this->disconnect(ans);
-	}
-	else if (equalsIgnoreCase(function, "write")) {
-		if (argc == 0) {
-			sendFailureArr(ans, "Additional argument required");
-			return;
-		}
-		//@InstanceCommand serial.write
-		//@Args data: string
-		//@Return A success or failure message
-		//@Description Attempts to either write the data to the serial port if threaded writes are disabled, or queue the data to be written if threaded writes are enabled.
-		//@Description If threaded writes are enabled, this command's return value does not say whether the data has successfully been *written*, only that it has been *queued*.
-		this->write(argv[0], ans);
-	}
-	else {
-	sendFailureArr(ans, "Unrecognized serial port instance command \"" + function + "\"");
+			try {
+				int val = svToInt(argv[0]);
+				self->setBaudRate(val, ans);
+			}
+			catch (std::exception e) {
+				sendFailureArr(ans, "Exception parsing input: ", e.what());
+			}
+		} },
+		{ "setParity", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.setParity
+			//@Args parityIndex: int
+			//@Return A failure or success message
+			//@Description Sets the parity. `parityIndex` is the index of the desired parity (from `listParities`).
+			if (argc == 0) {
+				sendFailureArr(ans, "Additional argument required");
+				return;
+			}
+			try {
+				int val = svToInt(argv[0]);
+				self->setParity(val, ans);
+			}
+			catch (std::exception e) {
+				sendFailureArr(ans, "Exception parsing input: ", e.what());
+			}
+		} },
+		{ "setStopBits", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.setStopBits
+			//@Args stopBitsIndex: int
+			//@Return A failure or success message
+			//@Description Sets the stop bit(s). `stopBitsIndex` is the index of the desired stop bit(s) (from `listStopBits`).
+			if (argc == 0) {
+				sendFailureArr(ans, "Additional argument required");
+				return;
+			}
+			try {
+				int val = svToInt(argv[0]);
+				self->setStopBits(val, ans);
+			}
+			catch (std::exception e) {
+				sendFailureArr(ans, "Exception parsing input: ", e.what());
+			}
+		} },
+		{ "setDataBits", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.setDataBits
+			//@Args dataBitsIndex: int
+			//@Return A failure or success message
+			//@Description Sets the data bits. `dataBitsIndex` is the index of the desired baud rate (from `listDataBits`).
+			if (argc == 0) {
+				sendFailureArr(ans, "Additional argument required");
+				return;
+			}
+			try {
+				int val = svToInt(argv[0]);
+				self->setDataBits(val, ans);
+			}
+			catch (std::exception e) {
+				sendFailureArr(ans, "Exception parsing input: ", e.what());
+			}
+		} },
+		{ "setFParity", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.setFParity
+			//@Args fParity: bool
+			//@Return A failure or success message
+			//@Description Sets `fParity`. If `true`, parity checking is performed. Default: `false`.
+			if (argc == 0) {
+				sendFailureArr(ans, "Additional argument required");
+				return;
+			}
+			bool val;
+			if (argv[0] == "true" || argv[0] == "1") val = true;
+			else if (argv[0] == "false" || argv[0] == "0") val = false;
+			else {
+				ans << "Expected true, false, 1, or 0";
+				return;
+			}
+			self->setFParity(val, ans);
+		} },
+		{ "setFOutxCtsFlow", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.setFOutxCtsFlow
+			//@Args fOutxCtsFlow: bool
+			//@Return A failure or success message
+			//@Description Sets `fOutxCtsFlow`. If `true`, the Clear-To-Send signal is monitored, and when the CTS is turned off, output is suspended until the CTS is sent again. Default: `false`.
+			if (argc == 0) {
+				sendFailureArr(ans, "Additional argument required");
+				return;
+			}
+			bool val;
+			if (argv[0] == "true" || argv[0] == "1") val = true;
+			else if (argv[0] == "false" || argv[0] == "0") val = false;
+			else {
+				sendFailureArr(ans, "Expected true, false, 1, or 0");
+				return;
+			}
+			self->setFOutxCtsFlow(val, ans);
+		} },
+		{ "setFOutxDsrFlow", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.setFOutxDsrFlow
+			//@Args fOutxDsrFlow: bool
+			//@Return A failure or success message
+			//@Description Sets fOutxDsrFlow. If `true`, the Data-Set-Ready signal is monitored, and when the DSR is turned off, output is suspended until the DSR is sent again. Default: `false`.
+			if (argc == 0) {
+				sendFailureArr(ans, "Additional argument required");
+				return;
+			}
+			bool val;
+			if (argv[0] == "true" || argv[0] == "1") val = true;
+			else if (argv[0] == "false" || argv[0] == "0") val = false;
+			else {
+				sendFailureArr(ans, "Expected true, false, 1, or 0");
+				return;
+			}
+			self->setFOutxDsrFlow(val, ans);
+		} },
+		{ "setFDtrControl", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.setFDtrControl
+			//@Args fDtsControl: 0 | 1 | 2
+			//@Return A failure or success message
+			//@Description Sets fDtrControl. If `0`, the Data-Terminal-Ready line is disabled. If `1`, the DTR line is enabled and left on. If `2`, it is an error to adjust the DTR line. Default: `1`.
+			if (argc == 0) {
+				sendFailureArr(ans, "Additional argument required");
+				return;
+			}
+			int val;
+			if (argv[0] == "0") val = 0;
+			else if (argv[0] == "1") val = 1;
+			else if (argv[0] == "2") val = 2;
+			else {
+				sendFailureArr(ans, "Expected true, false, 1, or 0");
+				return;
+			}
+			self->setFDtrControl(val, ans);
+		} },
+		{ "setFDsrSensitivity", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.setFDsrSensitivity
+			//@Args fDsrSensitivity: bool
+			//@Return A failure or success message
+			//@Description Sets fDsrSensitivity. If `true`, the driver is sensitive to the state of the DSR signal - all recieved bytes will be ignored unless the DSR input line is high. Default: `false`.
+			if (argc == 0) {
+				sendFailureArr(ans, "Additional argument required");
+				return;
+			}
+			bool val;
+			if (argv[0] == "true" || argv[0] == "1") val = true;
+			else if (argv[0] == "false" || argv[0] == "0") val = false;
+			else {
+				sendFailureArr(ans, "Expected true, false, 1, or 0");
+				return;
+			}
+			self->setFDsrSensitivity(val, ans);
+		} },
+		{ "setFTXContinueOnXoff", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.setFTXContinueOnXoff
+			//@Args fTXContinueOnXoff: bool
+			//@Return A failure or success message
+			//@Description Sets fTXContinueOnXoff. If `true`, transmission continues after the input buffer has come within `XoffLim` bytes of being full and the driver has transmitted the `XoffChar` character to stop receiving bytes. If `false`, transmission does not continue until the input buffer is within `XonLim` bytes of being empty and the driver has transmitted the `XonChar` character to resume reception. Default: `false`.
+			if (argc == 0) {
+				sendFailureArr(ans, "Additional argument required");
+				return;
+			}
+			bool val;
+			if (argv[0] == "true" || argv[0] == "1") val = true;
+			else if (argv[0] == "false" || argv[0] == "0") val = false;
+			else {
+				sendFailureArr(ans, "Expected true, false, 1, or 0");
+				return;
+			}
+			self->setFTXContinueOnXoff(val, ans);
+		} },
+		{ "setFOutX", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.setFOutX
+			//@Args fOutX: bool
+			//@Return A failure or success message
+			//@Description Sets fOutX. If `true`, transmission stops when the `XoffChar` character is received and starts again when the `XonChar` character is received. Default: `false`.
+			if (argc == 0) {
+				sendFailureArr(ans, "Additional argument required");
+				return;
+			}
+			bool val;
+			if (argv[0] == "true" || argv[0] == "1") val = true;
+			else if (argv[0] == "false" || argv[0] == "0") val = false;
+			else {
+				sendFailureArr(ans, "Expected true, false, 1, or 0");
+				return;
+			}
+			self->setFOutX(val, ans);
+		} },
+		{ "setFInX", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.setFInX
+			//@Args fInX: bool
+			//@Return A failure or success message
+			//@Description Sets fInX. If `true`, the `XoffChar` character is sent when the input buffer comes within `XoffLim` bytes of being full, and the `XonChar` character is sent when the input buffer comes within `XonLim` bytes of being empty. Defualt: `false`.
+			if (argc == 0) {
+				sendFailureArr(ans, "Additional argument required");
+				return;
+			}
+			bool val;
+			if (argv[0] == "true" || argv[0] == "1") val = true;
+			else if (argv[0] == "false" || argv[0] == "0") val = false;
+			else {
+				sendFailureArr(ans, "Expected true, false, 1, or 0");
+				return;
+			}
+			self->setFInX(val, ans);
+		} },
+		{ "setFErrorChar", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.setFErrorChar
+			//@Args fErrorChar: bool
+			//@Return A failure or success message
+			//@Description Sets fErrorChar. If `true` and `fParity` is true, bytes received with parity errors are replaced with `ErrorChar`. Defualt: `false`.
+			if (argc == 0) {
+				sendFailureArr(ans, "Additional argument required");
+				return;
+			}
+			bool val;
+			if (argv[0] == "true" || argv[0] == "1") val = true;
+			else if (argv[0] == "false" || argv[0] == "0") val = false;
+			else {
+				sendFailureArr(ans, "Expected true, false, 1, or 0");
+				return;
+			}
+			self->setFErrorChar(val, ans);
+		} },
+		{ "setFNull", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.setFNull
+			//@Args fNull: bool
+			//@Return A failure or success message
+			//@Description Sets fNull. If `true`, null bytes are discarded when received. Defualt: `false.
+			if (argc == 0) {
+				sendFailureArr(ans, "Additional argument required");
+				return;
+			}
+			bool val;
+			if (argv[0] == "true" || argv[0] == "1") val = true;
+			else if (argv[0] == "false" || argv[0] == "0") val = false;
+			else {
+				sendFailureArr(ans, "Expected true, false, 1, or 0");
+				return;
+			}
+			self->setFNull(val, ans);
+		} },
+		{ "setFRtsControl", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.setFRtsControl
+			//@Args fRtsControl: 0 | 1 | 2 | 3
+			//@Return A failure or success message
+			//@Description Sets fRtsControl. If `0`, the Request-To-Send line is disabled. If `1`, the RTS line is opened and left on. If `2`, RTS handshaking is enabled - the drived raises the RTS line when the input buffer is less than one half full and lowers the RTS line when the buffer is more than three quarters full, and it is an error to adjust the RTS line. If `3`, the RTS line will be high if bytes are available for transmission, and after all buffered bytes have been sent, the RTS line will be low. Default: `1`.
+			if (argc == 0) {
+				sendFailureArr(ans, "Additional argument required");
+				return;
+			}
+			int val;
+			if (argv[0] == "0") val = 0;
+			else if (argv[0] == "1") val = 1;
+			else if (argv[0] == "2") val = 2;
+			else if (argv[0] == "3") val = 3;
+			else {
+				sendFailureArr(ans, "Expected 0, 1, 2, or 3");
+				return;
+			}
+			self->setFRtsControl(val, ans);
+		} },
+		{ "setFAbortOnError", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.setFAbortOnError
+			//@Args fAbortOnError: bool
+			//@Return A failure or success message
+			//@Description Sets fAbortOnError. If `true`, the driver terminates all read and write operations with an error status if an error occurs. The driver will not accept any further communications until the extension clears the error (currently not implemented). Default: `false`.
+			if (argc == 0) {
+				sendFailureArr(ans, "Additional argument required");
+				return;
+			}
+			bool val;
+			if (argv[0] == "true" || argv[0] == "1") val = true;
+			else if (argv[0] == "false" || argv[0] == "0") val = false;
+			else {
+				sendFailureArr(ans, "Expected true, false, 1, or 0");
+				return;
+			}
+			self->setFAbortOnError(val, ans);
+		} },
+		{ "setXonLim", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.setXonLim
+			//@Args XonLim: int
+			//@Return A failure or success message
+			//@Description Sets XonLim. See `fInX`, `fRtsControl`, and `fDtrControl`. Default: `2048`.
+			if (argc == 0) {
+				sendFailureArr(ans, "Additional argument required");
+				return;
+			}
+			try {
+				int val = svToInt(argv[0]);
+				self->setXonLim(val, ans);
+			}
+			catch (std::exception e) {
+				sendFailureArr(ans, "Exception parsing input: ", e.what());
+			}
+		} },
+		{ "setXoffLim", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.setXoffLim
+			//@Args XoffLim: int
+			//@Return A failure or success message
+			//@Description Sets XoffLim. See `fInX`, `fRtsControl`, and `fDtrControl`. Default: `512`.
+			if (argc == 0) {
+				sendFailureArr(ans, "Additional argument required");
+				return;
+			}
+			try {
+				int val = svToInt(argv[0]);
+				self->setXoffLim(val, ans);
+			}
+			catch (std::exception e) {
+				sendFailureArr(ans, "Exception parsing input: ", e.what());
+			}
+		} },
+		{ "setXonChar", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.setXonChar
+			//@Args XonChar: int
+			//@Return A failure or success message
+			//@Description Sets XonChar. XonChar is an integer ASCII code, e.g. `65` for "A". Default: `17` (device control 1).
+			if (argc == 0) {
+				sendFailureArr(ans, "Additional argument required");
+				return;
+			}
+			try {
+				int val = svToInt(argv[0]);
+				self->setXonChar(val, ans);
+			}
+			catch (std::exception e) {
+				sendFailureArr(ans, "Exception parsing input: ", e.what());
+			}
+		} },
+		{ "setXoffChar", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.setXoffChar
+			//@Args XoffChar: int
+			//@Return A failure or success message
+			//@Description Sets XoffChar. XoffChar is an integer ASCII code, e.g. `65` for "A". Default: `19` (device control 3).
+			if (argc == 0) {
+				sendFailureArr(ans, "Additional argument required");
+				return;
+			}
+			try {
+				int val = svToInt(argv[0]);
+				self->setXoffChar(val, ans);
+			}
+			catch (std::exception e) {
+				sendFailureArr(ans, "Exception parsing input: ", e.what());
+			}
+		} },
+		{ "setErrorChar", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.setErrorChar
+			//@Args ErrorChar: int
+			//@Return A failure or success message
+			//@Description Sets ErrorChar. ErrorChar is an integer ASCII code, e.g. `65` for "A". Default: `0`.
+			if (argc == 0) {
+				sendFailureArr(ans, "Additional argument required");
+				return;
+			}
+			try {
+				int val = svToInt(argv[0]);
+				self->setErrorChar(val, ans);
+			}
+			catch (std::exception e) {
+				sendFailureArr(ans, "Exception parsing input: ", e.what());
+			}
+		} },
+		{ "setEofChar", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.setEofChar
+			//@Args EofChar: int
+			//@Return A failure or success message
+			//@Description Sets EofChar. EofChar is an integer ASCII code, e.g. `65` for "A". The character used to signal the end of data. Default: `0`.
+			if (argc == 0) {
+				sendFailureArr(ans, "Additional argument required");
+				return;
+			}
+			try {
+				int val = svToInt(argv[0]);
+				self->setEofChar(val, ans);
+			}
+			catch (std::exception e) {
+				sendFailureArr(ans, "Exception parsing input: ", e.what());
+			}
+		} },
+		{ "setEvtChar", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.setEvtChar
+			//@Args EvtChar: int
+			//@Return A failure or success message
+			//@Description Sets EvtChar. EvtChar is an integer ASCII code, e.g. `65` for "A". The character used to signal an event. Default: `0`.
+			if (argc == 0) {
+				sendFailureArr(ans, "Additional argument required");
+				return;
+			}
+			try {
+				int val = svToInt(argv[0]);
+				self->setEvtChar(val, ans);
+			}
+			catch (std::exception e) {
+				sendFailureArr(ans, "Exception parsing input: ", e.what());
+			}
+		} },
+		{ "enableThreadedWrites", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.enableThreadedWrites
+			//@Args 
+			//@Return Success or failure message
+			//@Description Makes `write` queue messages and return right away instead of waiting for them to be sent, which may dramatically reduce the time `write` calls take to return to SQF.
+			//@Description Everything queued since the last send goes out together, and each send calls the callback with the message being the instance UUID and the data being an array with a success or failure message.
+			self->enableWriteThread(ans);
+		} },
+		{ "callbackOnChar", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.callbackOnChar
+			//@Args charToLookFor: char
+			//@Return 
+			//@Description Makes the extension send data read from this port back to Arma when `charToLookFor`, specified as a `char`, is read.
+			//@Description When the character is read, all data up to and **excluding** that character is sent back to Arma via the callback.
+			if (argc == 0 || argv[0].length() == 0) {
+				sendFailureArr(ans, "Additional argument required");
+				return;
+			}
+			self->rwHandler->callbackOnChar(argv[0][0]);
+		} },
+		{ "callbackOnCharCode", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.callbackOnCharCode
+			//@Args charCodeToLookFor: int
+			//@Return 
+			//@Description Makes the extension send data read from this port back to Arma when the character described by `charCodeToLookFor`, specified as an ASCII char code e.g. `65` for "A", is read.
+			//@Description When the character is read, all data read since the last callback, up to and **excluding** that character, is sent back to Arma via the callback.
+			if (argc == 0 || argv[0].length() == 0) {
+				sendFailureArr(ans, "Additional argument required");
+				return;
+			}
+			try {
+				int val = svToInt(argv[0]);
+				self->rwHandler->callbackOnChar((char)val);
+			}
+			catch (std::exception e) {
+				sendFailureArr(ans, "Exception parsing input: ", e.what());
+			}
+		} },
+		{ "callbackOnString", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.callbackOnString
+			//@Args delimiter: string
+			//@Return 
+			//@Description Makes the extension send data read from this port back to Arma whenever it reads `delimiter`, which can be up to 15 characters long (e.g. `toString [13, 10]` for "\r\n", or "</msg>").
+			//@Description When `delimiter` is read, all data read since the last callback is sent back to Arma via the callback, excluding `delimiter` itself.
+			if (argc == 0 || argv[0].length() == 0) {
+				sendFailureArr(ans, "Additional argument required");
+				return;
+			}
+			if (argv[0].length() > StringDelimiter::maxLength) {
+				sendFailureArr(ans, "Delimiter can be at most ", StringDelimiter::maxLength, " characters long");
+				return;
+			}
+			self->rwHandler->callbackOnString(argv[0]);
+		} },
+		{ "callbackOnLength", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.callbackOnLength
+			//@Args lengthToStopAt: int
+			//@Return 
+			//@Description Makes the extension send data read from this port back to Arma when the total amount of data read reaches `lengthToStopAt` characters long.
+			//@Description When the target amount of data is read, all data read since the last callback is sent back to Arma via the callback.
+			if (argc == 0 || argv[0].length() == 0) {
+				sendFailureArr(ans, "Additional argument required");
+				return;
+			}
+			try {
+				int val = svToInt(argv[0]);
+				if (val < 1) {
+					sendFailureArr(ans, "Length must be at least 1");
+					return;
+				}
+				self->rwHandler->callbackOnLength(val);
+			}
+			catch (std::exception e) {
+				sendFailureArr(ans, "Exception parsing input: ", e.what());
+			}
+		} },
+		{ "callbackOnLengthPrefix", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.callbackOnLengthPrefix
+			//@Args lengthSize: int, bigEndian: bool, lengthOffset: int, includeHeader: bool, maxFrameSize: int
+			//@Return 
+			//@Description Makes the extension send data back to Arma one frame at a time, where each frame starts with a header giving its length. This suits binary protocols, where any delimiter could also appear inside a frame.
+			//@Description The header is `lengthOffset` (optional, default `0`) bytes of anything followed by a `lengthSize`-byte (1, 2, or 4) length field, which is big endian unless `bigEndian` (optional, default `true`) is `false`. The length field gives the number of bytes after the header.
+			//@Description Frames are sent without their header unless `includeHeader` (optional, default `false`) is `true`. A frame longer than `maxFrameSize` (optional, default `65536`) is dropped as it arrives rather than buffered, and a failure message is sent via the callback (with the instance's UUID as the function) instead.
+			LengthPrefixOptions options;
+			if (!parseLengthPrefixArgs(argv, argc, options, ans)) return;
+			self->rwHandler->callbackOnLengthPrefix(options);
+		} },
+		{ "enableBatching", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.enableBatching
+			//@Args maxBytes: int, maxLatencyMs: int
+			//@Return A success or failure message
+			//@Description Makes the extension pack every frame read since the last delivery into a single callback instead of sending one callback per frame, so the number of callbacks follows how often Arma empties its callback buffer rather than how fast data arrives.
+			//@Description Batches are sent with the function "data_read_batch" and data in the form `[UUID: string, [frame1: string, frame2: string, ...]]`.
+			//@Description `maxBytes` (optional, default `8192`) limits the length of a batch's data; once it would be exceeded, a new batch is started.
+			//@Description `maxLatencyMs` (optional, default `0`) is how long a batch may be held back after its first frame so more frames can join it. With `0`, batches only grow while Arma's callback buffer is full.
+			int maxBytes = 8192;
+			int maxLatencyMs = 0;
+			try {
+				if (argc > 0) maxBytes = svToInt(argv[0]);
+				if (argc > 1) maxLatencyMs = svToInt(argv[1]);
+			}
+			catch (std::exception e) {
+				sendFailureArr(ans, "Exception parsing input: ", e.what());
+				return;
+			}
+			if (maxBytes < 64) {
+				sendFailureArr(ans, "maxBytes must be at least 64");
+				return;
+			}
+			if (maxLatencyMs < 0) {
+				sendFailureArr(ans, "maxLatencyMs must not be negative");
+				return;
+			}
+			self->rwHandler->enableBatching((size_t)maxBytes, maxLatencyMs, ans);
+		} },
+		{ "disableBatching", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.disableBatching
+			//@Args 
+			//@Return A success or failure message
+			//@Description Goes back to sending one "data_read" callback per frame. Frames already in a batch are still sent as a batch.
+			self->rwHandler->disableBatching(ans);
+		} },
+		{ "enablePolling", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.enablePolling
+			//@Args maxFrames: int
+			//@Return A success or failure message
+			//@Description Makes the extension hold on to frames it reads until they are collected with `readAvailable`, instead of sending a "data_read" callback for each one. Polling once per frame avoids Arma's limit of 100 waiting callbacks.
+			//@Description Once `maxFrames` (optional, default `1024`) frames are waiting, the extension stops reading until some are collected, leaving further data with the operating system, unless `setOverflowPolicy` says otherwise.
+			int maxFrames = 1024;
+			try {
+				if (argc > 0) maxFrames = svToInt(argv[0]);
+			}
+			catch (std::exception e) {
+				sendFailureArr(ans, "Exception parsing input: ", e.what());
+				return;
+			}
+			if (maxFrames < 1) {
+				sendFailureArr(ans, "maxFrames must be at least 1");
+				return;
+			}
+			self->rwHandler->enablePolling((size_t)maxFrames, ans);
+		} },
+		{ "disablePolling", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.disablePolling
+			//@Args 
+			//@Return A success or failure message
+			//@Description Goes back to sending frames via the callback. Frames that were already waiting can still be collected with `readAvailable`.
+			self->rwHandler->disablePolling(ans);
+		} },
+		{ "readAvailable", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.readAvailable
+			//@Args 
+			//@Return `[[frame1: string, frame2: string, ...], remaining: int]`
+			//@Description Collects as many waiting frames (see `enablePolling`) as fit in Arma's output buffer, oldest first. `remaining` is how many are still waiting after this call.
+			self->rwHandler->readAvailable(ans);
+		} },
+		{ "setOverflowPolicy", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.setOverflowPolicy
+			//@Args policy: string, maxFrames: int
+			//@Return A success or failure message
+			//@Description Decides what happens to frames read while `maxFrames` (optional, default `1024`) are already waiting to be delivered, either for `readAvailable` or for room in Arma's callback buffer (which holds 100).
+			//@Description `policy` is one of "block" (the default: stop reading until there's room, leaving data with the operating system), "dropOldest", "dropNewest", or "conflateLatest" (replace the newest waiting frame, so the latest data always gets through). Dropped frames are counted by `getOverflowStats`.
+			OverflowPolicy policy;
+			size_t maxFrames;
+			if (!parseOverflowPolicyArgs(argv, argc, policy, maxFrames, ans)) return;
+			self->rwHandler->setOverflowPolicy(policy, maxFrames, ans);
+		} },
+		{ "getOverflowStats", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.getOverflowStats
+			//@Args 
+			//@Return `[droppedFrames, droppedBytes, waitingFrames]`
+			//@Description Counts the frames (and their bytes) thrown away by the overflow policy since the connection was made, and how many are waiting to be delivered right now.
+			self->rwHandler->overflowStats(ans);
+		} },
+		{ "getAllocationStats", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.getAllocationStats
+			//@Args 
+			//@Return `[allocations, reuses, allocationsPerSecond]`
+			//@Description Returns how many read and write buffers this instance has had to allocate, how many were reused instead, and how many allocations per second there have been since the last call to this command.
+			//@Description Once reads and writes have been going for a while, `allocationsPerSecond` should stay at 0.
+			self->rwHandler->allocationStats(ans);
+		} },
+		{ "getStats", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.getStats
+			//@Args 
+			//@Return `[bytesIn, framesIn, bytesOut, writesQueued, writesCompleted, writeQueueDepth, callbackRetries, readErrors, writeErrors, callbacksDropped]`
+			//@Description Returns counters for everything this instance has done since it was created. `framesIn` counts frames before any overflow policy drops them, and `writeQueueDepth` is how many writes are queued but not finished.
+			//@Description `callbackRetries` counts how often Arma's callback buffer was full when this instance's callbacks were offered to it, and `callbacksDropped` how many of its callbacks were thrown away because too many were already waiting. The counters are always kept, and cheap enough that there's no need to turn them off.
+			self->rwHandler->getStats().write(ans);
+		} },
+		{ "getLatency", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.getLatency
+			//@Args 
+			//@Return `[[callbacks, p50, p99, p999, max], [writes, p50, p99, p999, max]]`
+			//@Description Returns how long this instance's data took to reach SQF and its writes took to go out, in microseconds. The first array measures from data being read to Arma accepting the callback it went out in, and the second from a write being queued (or called, if writes aren't threaded) to it finishing.
+			//@Description Percentiles come from a histogram with about 6% precision, while `max` is exact. Call `resetLatency` to start measuring afresh, e.g. right before a busy part of a mission.
+			self->rwHandler->latencyStats(ans);
+		} },
+		{ "resetLatency", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.resetLatency
+			//@Args 
+			//@Return A success message
+			//@Description Clears the latencies recorded so far (see `getLatency`).
+			self->rwHandler->resetLatency(ans);
+		} },
+		{ "isConnected", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.isConnected
+			//@Args 
+			//@Return `true` or `false` based on whether this instance is currently connected to the port it describes
+			//@Description
+			ans << self->isConnected();
+		} },
+		{ "connect", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.connect
+			//@Args 
+			//@Return A success or failure message
+			//@Description Attempts to connect to the port described by this instance.
+			self->connect(ans);
+		} },
+		{ "disconnect", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand serial.disconnect
+			//@Args 
+			//@Return A success or failure message
+			//@Description Attempts to disconnect from the port described by this instance.
+			//@Description If threaded writes are enabled, the extension will attempt to flush the remaining data **synchronously** before disconnecting.
+			self->disconnect(ans);
+		} },
+		{ "write", [](SerialPort* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			if (argc == 0) {
+				sendFailureArr(ans, "Additional argument required");
+				return;
+			}
+			//@InstanceCommand serial.write
+			//@Args data: string
+			//@Return A success or failure message
+			//@Description Attempts to either write the data to the serial port if threaded writes are disabled, or queue the data to be written if threaded writes are enabled.
+			//@Description If threaded writes are enabled, this command's return value does not say whether the data has successfully been *written*, only that it has been *queued*.
+			self->write(argv[0], ans);
+		} },
+	};
+	if (!commands.run(this, function, argv, argc, ans)) {
+		sendFailureArr(ans, "Unrecognized serial port instance command \"", function, "\"");
 	}
 }
 
-void SerialPort::runStaticCommand(std::string function, std::string* argv, int argc, std::stringstream& ans)
+void SerialPort::runStaticCommand(std::string_view function, std::string_view* argv, int argc, ResponseWriter& ans)
 {
-	//used for QueryDosDevice
-	char pathBuffer[800];
 	if (argc == 0) {
 		sendFailureArr(ans, "You must specify additional arguments");
 		return;
 	}
-	std::string& function2 = *argv;
-	if (equalsIgnoreCase(function2, "create")) {
-		//@StaticCommand serial.create
-		//@Args portName: string
-		//@Return A success or failure message
-		//@Description Creates an instance of this communication method and returns a UUID representing it.
-		//@Description This command does not attempt to connect to the given port; the `connect` command must be called separately.
-		//@Description Note that `portName` should be the name of the port (e.g. `COM1`), not its file (e.g. `\\.\\\\COM1`).
-		SerialPort* port;
-		if (argc == 1) { sendFailureArr(ans, "You must specify a port for this command"); return; }
-		if (QueryDosDeviceA(argv[1].c_str(), pathBuffer, 800) == 0) {
-			sendFailureArr(ans, "The specified port (\"" + argv[1] + "\") is invalid");
-			return;
-		}
-		auto find = serialPorts.find(argv[1]);
-		if (find == serialPorts.end()) {
-			port = new SerialPort(argv[1]);
-			serialPorts[argv[1]] = port;
-			commMethods[port->getID()] = port;
-		}
-		else {
-			port = (*find).second;
-		}
-		ans << port->getID();
-	}
-	else if (equalsIgnoreCase(function2, "listPorts")) {
-		//@StaticCommand serial.listPorts
-		//@Args 
-		//@Return A list of currently available COM (serial) ports in the format [[portName: string, portDriver: string], ...]
-		//@Description Queries the currently available DOS COM ports using the Windows function `QueryDosDevice` from COM0 to COM254 inclusive.
-		//@Description This method is marginally more computationally expensive than checking the registry, but the registry may be out of date, so this command is guaranteed to return the most up-to-date data.
-		//@Description Remember to use `parseSimpleArray` since extensions can only communicate using strings.
-		bool found = false;
-		ans << "[";
-		//loop over possible com ports, because the alternative is reading registry keys
-		for (int i = 0; i < 255; i++) {
-			std::string portName = "COM" + std::to_string(i);
-			DWORD comTest = QueryDosDeviceA(portName.c_str(), pathBuffer, 800);
-			if (comTest != 0) {
+	std::string_view function2 = *argv;
+	static const CommandTable<void> commands = {
+		{ "create", [](void*, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@StaticCommand serial.create
+			//@Args portName: string
+			//@Return A success or failure message
+			//@Description Creates an instance of this communication method and returns a UUID representing it.
+			//@Description This command does not attempt to connect to the given port; the `connect` command must be called separately.
+			//@Description Note that `portName` should be the name of the port (e.g. `COM1`), not its file (e.g. `\\.\\\\COM1`).
+			//@Description On Linux, `portName` is either a path (e.g. `/dev/ttyUSB0` or `/dev/serial/by-id/...`) or a name in `/dev` (e.g. `ttyUSB0`).
+			SerialPort* port;
+			if (argc == 1) { sendFailureArr(ans, "You must specify a port for this command"); return; }
+			//QueryDosDevice needs a null-terminated string
+			std::string portName(argv[1]);
+#ifdef _WIN32
+			//used for QueryDosDevice
+			char pathBuffer[800];
+			if (QueryDosDeviceA(portName.c_str(), pathBuffer, 800) == 0) {
+				sendFailureArr(ans, "The specified port (\"", portName, "\") is invalid");
+				return;
+			}
+#else
+			struct stat info;
+			std::string path = portName.length() > 0 && portName[0] == '/' ? portName : portPrefix + portName;
+			if (stat(path.c_str(), &info) != 0 || !S_ISCHR(info.st_mode)) {
+				sendFailureArr(ans, "The specified port (\"", portName, "\") is invalid");
+				return;
+			}
+#endif
+			auto find = serialPorts.find(portName);
+			if (find == serialPorts.end()) {
+				port = new SerialPort(portName);
+				serialPorts[portName] = port;
+				std::unique_lock<std::mutex> lock(commMethodsMutex);
+				commMethods[port->getID()] = port;
+			}
+			else {
+				port = (*find).second;
+			}
+			ans << port->getID();
+		} },
+		{ "listPorts", [](void*, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@StaticCommand serial.listPorts
+			//@Args 
+			//@Return A list of currently available COM (serial) ports in the format [[portName: string, portDriver: string], ...]
+			//@Description Queries the currently available DOS COM ports using the Windows function `QueryDosDevice` from COM0 to COM254 inclusive.
+			//@Description This method is marginally more computationally expensive than checking the registry, but the registry may be out of date, so this command is guaranteed to return the most up-to-date data.
+			//@Description On Linux, `portName` is the port's path and `portDriver` is its name in `/dev/serial/by-id` (which usually says what's plugged in) if it has one, or the name of its driver otherwise. Every tty with a device behind it is listed, apart from the placeholder `ttyS` ports that exist whether or not there's hardware for them.
+			//@Description Remember to use `parseSimpleArray` since extensions can only communicate using strings.
+			bool found = false;
+			ans << "[";
+#ifdef _WIN32
+			//used for QueryDosDevice
+			char pathBuffer[800];
+			//loop over possible com ports, because the alternative is reading registry keys
+			for (int i = 0; i < 255; i++) {
+				std::string portName = "COM" + std::to_string(i);
+				DWORD comTest = QueryDosDeviceA(portName.c_str(), pathBuffer, 800);
+				if (comTest != 0) {
+					if (found) ans << ", ";
+					else found = true;
+					//note: there shouldn't be, but if there are quotes in pathBuffer or portName, this will break on the SQF side
+					ans << "[\"" << portName << "\", \"" << pathBuffer << "\"]";
+				}
+			}
+#else
+			namespace fs = std::filesystem;
+			std::error_code ec;
+			//maps paths to descriptions
+			std::map<std::string, std::string> ports;
+			for (auto& entry : fs::directory_iterator("/dev/serial/by-id", ec)) {
+				fs::path target = fs::canonical(entry.path(), ec);
+				if (!ec) ports[target.string()] = entry.path().filename().string();
+			}
+			for (auto& entry : fs::directory_iterator("/sys/class/tty", ec)) {
+				std::string name = entry.path().filename().string();
+				//virtual consoles and pseudo-terminals have no device
+				fs::path driver = fs::canonical(entry.path() / "device" / "driver", ec);
+				if (ec) continue;
+				//the 8250 driver makes ttyS0 to ttyS31 as platform devices whether or not there's a UART behind them
+				if (name.rfind("ttyS", 0) == 0 && fs::canonical(entry.path() / "device" / "subsystem", ec).filename() == "platform") continue;
+				std::string path = "/dev/" + name;
+				if (ports.find(path) == ports.end()) ports[path] = driver.filename().string();
+			}
+			for (auto& port : ports) {
 				if (found) ans << ", ";
 				else found = true;
-				//note: there shouldn't be, but if there are quotes in pathBuffer or portName, this will break on the SQF side
-				ans << "[\"" << portName << "\", \"" << pathBuffer << "\"]";
+				ans << "[\"" << port.first << "\", \"" << port.second << "\"]";
 			}
-		}
-		ans << "]";
-	}
-	else if (equalsIgnoreCase(function2, "listBaudRates")) {
-		//@StaticCommand serial.listBaudRates
-		//@Args 
-		//@Return A list of currently available baud rates in the format [[index:int , baudRate: int], ...]
-		//@Description This command simply enumerates the baud rates known to the extension; listed baud rates may not be compatible with the specific serial device.
-		//@Description Remember to use `parseSimpleArray` since extensions can only communicate using strings.
-		ans << "[";
-		for (int i = 0; i < numRates; i++) {
-			if (i != 0) ans << ", ";
-			ans << "[" << i << ", " << baudNames[i] << "]";
-		}
-		ans << "]";
-	}
-	else if (equalsIgnoreCase(function2, "listStopBits")) {
-		//@StaticCommand serial.listStopBits
-		//@Args 
-		//@Return A list of currently available stop bits in the format [[index: int, stopBits: string], ...]
-		//@Description This command simply enumerates the stop bits known to the extension; listed stop bits may not be compatible with the specific serial device.
-		//@Description Remember to use `parseSimpleArray` since extensions can only communicate using strings.
-		ans << "[";
-		for (int i = 0; i < numStopBits; i++) {
-			if (i != 0) ans << ", ";
-			ans << "[" << i << ", \"" << stopBitNames[i] << "\"]";
-		}
-		ans << "]";
-	}
-	else if (equalsIgnoreCase(function2, "listParities")) {
-		//@StaticCommand serial.listParities
-		//@Args 
-		//@Return A list of currently available parities in the format [[index: int, parity: string], ...]
-		//@Description This command simply enumerates the parities known to the extension; listed parities may not be compatible with the specific serial device.
-		//@Description Remember to use `parseSimpleArray` since extensions can only communicate using strings.
-		ans << "[";
-		for (int i = 0; i < numParities; i++) {
-			if (i != 0) ans << ", ";
-			ans << "[" << i << ", \"" << parityNames[i] << "\"]";
-		}
-		ans << "]";
-	}
-	else if (equalsIgnoreCase(function2, "listDataBits")) {
-		//@StaticCommand serial.listDataBits
-		//@Args 
-		//@Return A list of currently available data bits in the format [[index: int, dataBits: string], ...]
-		//@Description This command simply enumerates the data bits known to the extension; listed data bits may not be compatible with the specific serial device.
-		//@Description Remember to use `parseSimpleArray` since extensions can only communicate using strings.
-		ans << "[";
-		for (int i = 0; i < numDataBits; i++) {
-			if (i != 0) ans << ", ";
-			ans << "[" << i << ", \"" << dataBitNames[i] << "\"]";
-		}
-		ans << "]";
-	}
-	else if (equalsIgnoreCase(function2, "listInstances")) {
-		//@StaticCommand serial.listInstances
-		//@Args 
-		//@Return A list of instances of this communication method in the format [[UUID: string, portName: string], ...]
-		//@Description Lists extant instances of the serial communication method and their UUIDs so users have a hope of recovering their instance if they lose the UUID.
-		//@Description Remember to use `parseSimpleArray` since extensions can only communicate using strings.
-		ans << "[";
-		auto it = commMethods.begin();
-		auto end = commMethods.end();
-		bool any = false;
-		for (; it != end; it++) {
-			auto id = (*it).first;
-			auto val = (*it).second;
-			if (SerialPort* port = dynamic_cast<SerialPort*>(val)) {
-				if (any) ans << ", ";
-				ans << "[\"" << id << "\", \"" << port->getPortNamePretty() << "\"]";
+#endif
+			ans << "]";
+		} },
+		{ "listBaudRates", [](void*, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@StaticCommand serial.listBaudRates
+			//@Args 
+			//@Return A list of currently available baud rates in the format [[index:int , baudRate: int], ...]
+			//@Description This command simply enumerates the baud rates known to the extension; listed baud rates may not be compatible with the specific serial device.
+			//@Description Remember to use `parseSimpleArray` since extensions can only communicate using strings.
+			ans << "[";
+			for (int i = 0; i < numRates; i++) {
+				if (i != 0) ans << ", ";
+				ans << "[" << i << ", " << baudNames[i] << "]";
 			}
-		}
-		ans << "]";
-	}
-	else {
+			ans << "]";
+		} },
+		{ "listStopBits", [](void*, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@StaticCommand serial.listStopBits
+			//@Args 
+			//@Return A list of currently available stop bits in the format [[index: int, stopBits: string], ...]
+			//@Description This command simply enumerates the stop bits known to the extension; listed stop bits may not be compatible with the specific serial device.
+			//@Description Remember to use `parseSimpleArray` since extensions can only communicate using strings.
+			ans << "[";
+			for (int i = 0; i < numStopBits; i++) {
+				if (i != 0) ans << ", ";
+				ans << "[" << i << ", \"" << stopBitNames[i] << "\"]";
+			}
+			ans << "]";
+		} },
+		{ "listParities", [](void*, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@StaticCommand serial.listParities
+			//@Args 
+			//@Return A list of currently available parities in the format [[index: int, parity: string], ...]
+			//@Description This command simply enumerates the parities known to the extension; listed parities may not be compatible with the specific serial device.
+			//@Description Remember to use `parseSimpleArray` since extensions can only communicate using strings.
+			ans << "[";
+			for (int i = 0; i < numParities; i++) {
+				if (i != 0) ans << ", ";
+				ans << "[" << i << ", \"" << parityNames[i] << "\"]";
+			}
+			ans << "]";
+		} },
+		{ "listDataBits", [](void*, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@StaticCommand serial.listDataBits
+			//@Args 
+			//@Return A list of currently available data bits in the format [[index: int, dataBits: string], ...]
+			//@Description This command simply enumerates the data bits known to the extension; listed data bits may not be compatible with the specific serial device.
+			//@Description Remember to use `parseSimpleArray` since extensions can only communicate using strings.
+			ans << "[";
+			for (int i = 0; i < numDataBits; i++) {
+				if (i != 0) ans << ", ";
+				ans << "[" << i << ", \"" << dataBitNames[i] << "\"]";
+			}
+			ans << "]";
+		} },
+		{ "listInstances", [](void*, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@StaticCommand serial.listInstances
+			//@Args 
+			//@Return A list of instances of this communication method in the format [[UUID: string, portName: string], ...]
+			//@Description Lists extant instances of the serial communication method and their UUIDs so users have a hope of recovering their instance if they lose the UUID.
+			//@Description Remember to use `parseSimpleArray` since extensions can only communicate using strings.
+			ans << "[";
+			std::unique_lock<std::mutex> lock(commMethodsMutex);
+			auto it = commMethods.begin();
+			auto end = commMethods.end();
+			bool any = false;
+			for (; it != end; it++) {
+				auto id = (*it).first;
+				auto val = (*it).second;
+				if (SerialPort* port = dynamic_cast<SerialPort*>(val)) {
+					if (any) ans << ", ";
+					ans << "[\"" << id << "\", \"" << port->getPortNamePretty() << "\"]";
+				}
+			}
+			ans << "]";
+		} },
+	};
+	if (!commands.run(nullptr, function2, argv, argc, ans)) {
 		sendFailureArr(ans, "Unrecognized function");
 	}
 }
@@ -1,4 +1,6 @@
 #pragma once
+//boost has to come before windows.h
+#include <boost/asio.hpp>
 #include <iostream>
 #include <cstring>
 #include <sstream>
@@ -6,17 +8,31 @@
 #include <mutex>
 #include <atomic>
 #include <map>
+#ifdef _WIN32
 #include <windows.h>
+#endif
 #include "ReadWriteHandler.h"
+#include "IOContextHelper.h"
 #include "util.h"
 
+#ifdef _WIN32
+typedef HANDLE SerialHandle;
+//the handle of a port that isn't open
+static const SerialHandle noSerialHandle = nullptr;
 static const std::string portPrefix = "\\\\.\\";
+#else
+//a file descriptor, opened nonblocking
+typedef int SerialHandle;
+static const SerialHandle noSerialHandle = -1;
+//port names that aren't paths (e.g. "ttyUSB0") are looked for here
+static const std::string portPrefix = "/dev/";
+#endif
 
 class SerialPort : public ICommunicationMethod {
 private:
 	//the port name as it's passed to the constructor
 	std::string portNamePretty;
-	//the port name as Windows sees it (prefixed by backslashes etc)
+	//the port name as the OS sees it (prefixed by backslashes on Windows, or a path like /dev/ttyUSB0 elsewhere)
 	std::string portName;
 
 	std::string id;
@@ -29,8 +45,16 @@ private:
 	//whether we want to use the write thread
 	bool usingWriteThread = false;
 
-	//the file handle to the serial port
-	HANDLE serialPort = nullptr;
+	//the file handle to the serial port. once connected, `port` owns it
+	SerialHandle serialPort = noSerialHandle;
+	//reads (and threaded writes) go through this on the shared io_context, so open ports don't need threads of their own
+	boost::asio::serial_port* port;
+	//keeps this port's io_context handlers from running concurrently
+	IOStrand strand;
+#ifdef _WIN32
+	//for unthreaded writes, which are overlapped since the port is opened for the io_context's overlapped reads
+	HANDLE writeEvent = nullptr;
+#endif
 
 	//DCB params
 	int baudRate = 6;
@@ -57,38 +81,40 @@ private:
 	char EofChar = 0;
 	char EvtChar = 0;
 
-	ReadWriteHandler<HANDLE>* rwHandler;
+	ReadWriteHandler<boost::asio::serial_port>* rwHandler;
 
 public:
 	SerialPort(std::string portName);
+	~SerialPort();
 
 	bool isConnected() {
-		return serialPort != nullptr;
+		return serialPort != noSerialHandle;
 	}
 
 	//sets the parameters for the serial port according to instance variables and prints errors to `out`.
-	//returns false on a failed Windows API call, and true otherwise.
-	bool setParams(std::stringstream& out);
+	//returns false on a failed OS call (or, off Windows, parameters termios can't express), and true otherwise.
+	bool setParams(ResponseWriter& out);
 
 	//attempts to connect to the serial port specified by instance variables, sets its parameters using `setParams`, and starts applicable read/write threads
 	//prints error messages or a success message to `out`.
-	void connect(std::stringstream& out);
+	void connect(ResponseWriter& out);
 
 	//attempts to disconnect from the connected serial port, and then tells the read/write threads to shut down
 	//prints error/success messages to `out`
-	void disconnect(std::stringstream& out);
+	void disconnect(ResponseWriter& out);
 
 	//attempts to start a write thread. may be called before the serial port is connected.
 	//prints error/success messages to `out`.
-	void enableWriteThread(std::stringstream& out);
+	void enableWriteThread(ResponseWriter& out);
 
 	//attempts to write `data` to the serial port, using the write thread if enabled.
-	//prints error/success messages to `out`. can not detect whether a threaded write failed.
-	void write(std::string data, std::stringstream& out);
+	//prints error/success messages to `out`. a threaded write reports how it went through the callback instead.
+	void write(std::string_view data, ResponseWriter& out);
 
-	void runInstanceCommand(std::string function, std::string* argv, int argc, std::stringstream& ans);
+	void runInstanceCommand(std::string_view function, std::string_view* argv, int argc, ResponseWriter& ans);
 	bool destroy();
-	static void runStaticCommand(std::string function, std::string* argv, int argc, std::stringstream& ans);
+	void addStats(IOStatsSnapshot& total);
+	static void runStaticCommand(std::string_view function, std::string_view* argv, int argc, ResponseWriter& ans);
 	std::string getID();
 
 	std::string& getPortName() {
@@ -169,29 +195,29 @@ public:
 	int getEvtChar() {
 		return (int)EvtChar;
 	}
-	void setBaudRate(int newBaudRate, std::stringstream& out);
-	void setParity(int newParity, std::stringstream& out);
-	void setStopBits(int newStopBits, std::stringstream& out);
-	void setDataBits(int newDataBits, std::stringstream& out);
-	void setFParity(bool newFParity, std::stringstream& out);
-	void setFOutxCtsFlow(bool newFOutxCtsFlow, std::stringstream& out);
-	void setFOutxDsrFlow(bool newFOutxDsrFlow, std::stringstream& out);
-	void setFDtrControl(int newFDtrControl, std::stringstream& out);
-	void setFDsrSensitivity(bool newFDsrSensitivity, std::stringstream& out);
-	void setFTXContinueOnXoff(bool newFTXContinueOnXoff, std::stringstream& out);
-	void setFOutX(bool newFOutX, std::stringstream& out);
-	void setFInX(bool newFInX, std::stringstream& out);
-	void setFErrorChar(bool newFErrorChar, std::stringstream& out);
-	void setFNull(bool newFNull, std::stringstream& out);
-	void setFRtsControl(int newFRtsControl, std::stringstream& out);
-	void setFAbortOnError(bool newFAbortOnError, std::stringstream& out);
-	void setXonLim(WORD newXonLim, std::stringstream& out);
-	void setXoffLim(WORD newXoffLim, std::stringstream& out);
-	void setXonChar(char newXonChar, std::stringstream& out);
-	void setXoffChar(char newXoffChar, std::stringstream& out);
-	void setErrorChar(char newErrorChar, std::stringstream& out);
-	void setEofChar(char newEofChar, std::stringstream& out);
-	void setEvtChar(char newEvtChar, std::stringstream& out);
+	void setBaudRate(int newBaudRate, ResponseWriter& out);
+	void setParity(int newParity, ResponseWriter& out);
+	void setStopBits(int newStopBits, ResponseWriter& out);
+	void setDataBits(int newDataBits, ResponseWriter& out);
+	void setFParity(bool newFParity, ResponseWriter& out);
+	void setFOutxCtsFlow(bool newFOutxCtsFlow, ResponseWriter& out);
+	void setFOutxDsrFlow(bool newFOutxDsrFlow, ResponseWriter& out);
+	void setFDtrControl(int newFDtrControl, ResponseWriter& out);
+	void setFDsrSensitivity(bool newFDsrSensitivity, ResponseWriter& out);
+	void setFTXContinueOnXoff(bool newFTXContinueOnXoff, ResponseWriter& out);
+	void setFOutX(bool newFOutX, ResponseWriter& out);
+	void setFInX(bool newFInX, ResponseWriter& out);
+	void setFErrorChar(bool newFErrorChar, ResponseWriter& out);
+	void setFNull(bool newFNull, ResponseWriter& out);
+	void setFRtsControl(int newFRtsControl, ResponseWriter& out);
+	void setFAbortOnError(bool newFAbortOnError, ResponseWriter& out);
+	void setXonLim(WORD newXonLim, ResponseWriter& out);
+	void setXoffLim(WORD newXoffLim, ResponseWriter& out);
+	void setXonChar(char newXonChar, ResponseWriter& out);
+	void setXoffChar(char newXoffChar, ResponseWriter& out);
+	void setErrorChar(char newErrorChar, ResponseWriter& out);
+	void setEofChar(char newEofChar, ResponseWriter& out);
+	void setEvtChar(char newEvtChar, ResponseWriter& out);
 };
 
 //arrays used when users select parameters for the serial port
@@ -213,21 +239,22 @@ static const char* const baudNames[] = {
 	"128000",
 	"256000"
 };
+//the same values as Windows' CBR_ constants
 static const DWORD baudRates[] = {
-	CBR_110,
-	CBR_300,
-	CBR_600,
-	CBR_1200,
-	CBR_2400,
-	CBR_4800,
-	CBR_9600,
-	CBR_14400,
-	CBR_19200,
-	CBR_38400,
-	CBR_57600,
-	CBR_115200,
-	CBR_128000,
-	CBR_256000
+	110,
+	300,
+	600,
+	1200,
+	2400,
+	4800,
+	9600,
+	14400,
+	19200,
+	38400,
+	57600,
+	115200,
+	128000,
+	256000
 };
 //parity bits
 static const int numParities = 5;
@@ -238,6 +265,7 @@ static const char* const parityNames[] = {
 	"Mark parity",
 	"Space parity"
 };
+#ifdef _WIN32
 static const BYTE parities[] = {
 	NOPARITY,
 	ODDPARITY,
@@ -245,6 +273,7 @@ static const BYTE parities[] = {
 	MARKPARITY,
 	SPACEPARITY
 };
+#endif
 //stop bits
 static const int numStopBits = 3;
 static const char* const stopBitNames[] = {
@@ -252,11 +281,13 @@ static const char* const stopBitNames[] = {
 	"1.5 stop bits",
 	"2 stop bits"
 };
+#ifdef _WIN32
 static int stopBitValues[] = {
 	ONESTOPBIT,
 	ONE5STOPBITS,
 	TWOSTOPBITS
 };
+#endif
 //data bits/byte size
 static const int numDataBits = 5;
 static const char* const dataBitNames[] = {
@@ -1,5 +1,6 @@
 #include "util.h"
 #include "tcpClient.h"
+#include "CommandTable.h"
 #include <boost/asio.hpp>
 #include <map>
 
@@ -7,26 +8,22 @@
 //@Description This communication method is an interface for a TCP client. It is capable of asynchronous operations and should be able to connect given any valid IP endpoint locator, including domains (e.g. "google.com", "github.com/googleben") and IP addresses (e.g. "127.0.0.1", "1.1.1.1").
 //@Description Synchronous versions of operations are included, but I strongly recommend using the asynchronous versions unless you really need the output without getting it from a callback.
 
-extern std::map<std::string, ICommunicationMethod*> commMethods;
+extern std::map<std::string, ICommunicationMethod*, std::less<>> commMethods;
+extern std::mutex commMethodsMutex;
 extern ArmaCallback callback;
 extern boost::asio::io_context ioContext;
 std::map<std::string, TcpClient*> tcpClients;
 
 
-TcpClient::TcpClient(std::string endpoint, std::string port) {
+TcpClient::TcpClient(std::string endpoint, std::string port) : strand(boost::asio::make_strand(ioContext)) {
 	needIOContext();
 	this->id = generateUUID();
 	this->endpoint = endpoint;
 	this->port = port;
 	this->socket = new boost::asio::ip::tcp::socket(ioContext);
-	auto writeFunc = [](auto handle, auto str, auto len, auto written) {return false;};
-	auto readFunc = [](boost::asio::ip::tcp::socket* handle, char* toWrite) {
-		auto buff = boost::asio::buffer(toWrite, 1);
-		boost::system::error_code ec;
-		
-		return !ec && handle->read_some(buff, ec) == 1;
-	};
-	this->readHandler = new ReadWriteHandler<boost::asio::ip::tcp::socket>(this->socket, this, writeFunc, readFunc, true, false);
+	//reads and threaded writes are done asynchronously on the io_context, so there's no blocking read or write function
+	this->readHandler = new ReadWriteHandler<boost::asio::ip::tcp::socket>(this->socket, this, nullptr, nullptr, true, false);
+	this->readHandler->useAsyncOps(tcpAsyncOps(this->strand));
 }
 
 TcpClient::~TcpClient()
@@ -42,7 +39,11 @@ bool TcpClient::destroy() {
 	return true;
 }
 
-void TcpClient::runStaticCommand(std::string function, std::string* argv, int argc, std::stringstream& ans)
+void TcpClient::addStats(IOStatsSnapshot& total) {
+	total += this->readHandler->getStats();
+}
+
+void TcpClient::runStaticCommand(std::string_view function, std::string_view* argv, int argc, ResponseWriter& ans)
 {
 	if (argc == 0) {
 		sendFailureArr(ans, "Additional argument required");
@@ -51,192 +52,374 @@ void TcpClient::runStaticCommand(std::string function, std::string* argv, int ar
 	function = *argv;
 	argv++;
 	argc--;
-	if (equalsIgnoreCase(function, "create")) {
-		//@StaticCommand TCPClient.create
-		//@Args endpoint: string, port: string
-		//@Return A success or failure message
-		//@Description Creates an instance of this communication method and returns a UUID representing it.
-		//@Description This command does not attempt to connect to the given endpoint; the `connect` command must be called separately.
-		//@Description `endpoint` should be a valid, resolvable IP endpoint, consisting of first either a domain or an IP.
-		//@Description Examples of valid endpoints: `127.0.0.1`, `example.com`
-		if (argc < 2) { sendFailureArr(ans, "You must specify an endpoint and port for this command"); return; }
-		TcpClient* client = new TcpClient(argv[0], argv[1]);
-		tcpClients[argv[1]] = client;
-		commMethods[client->getID()] = client;
-		ans << client->getID();
-	}
-	else if (equalsIgnoreCase(function, "listInstances")) {
-		//@StaticCommand TCPClient.listInstances
-		//@Args 
-		//@Return A list of instances of this communication method in the format [[UUID: string, endpoint: string], ...]
-		//@Description Lists extant instances of the tcpClient communication method and their UUIDs so users have a hope of recovering their instance if they lose the UUID.
-		//@Description Remember to use `parseSimpleArray` since extensions can only communicate using strings.
-		ans << "[";
-		auto it = commMethods.begin();
-		auto end = commMethods.end();
-		bool any = false;
-		for (; it != end; it++) {
-			auto id = (*it).first;
-			auto val = (*it).second;
-			if (TcpClient* client = dynamic_cast<TcpClient*>(val)) {
-				if (any) ans << ", ";
-				ans << "[\"" << id << "\", \"" << client->endpoint << "\"]";
-			}
-		}
-		ans << "]";
-	}
+	static const CommandTable<void> commands = {
+		{ "create", [](void*, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@StaticCommand TCPClient.create
+			//@Args endpoint: string, port: string
+			//@Return A success or failure message
+			//@Description Creates an instance of this communication method and returns a UUID representing it.
+			//@Description This command does not attempt to connect to the given endpoint; the `connect` command must be called separately.
+			//@Description `endpoint` should be a valid, resolvable IP endpoint, consisting of first either a domain or an IP.
+			//@Description Examples of valid endpoints: `127.0.0.1`, `example.com`
+			if (argc < 2) { sendFailureArr(ans, "You must specify an endpoint and port for this command"); return; }
+			TcpClient* client = new TcpClient(std::string(argv[0]), std::string(argv[1]));
+			tcpClients[std::string(argv[1])] = client;
+			{
+				std::unique_lock<std::mutex> lock(commMethodsMutex);
+				commMethods[client->getID()] = client;
+			}
+			ans << client->getID();
+		} },
+		{ "listInstances", [](void*, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@StaticCommand TCPClient.listInstances
+			//@Args 
+			//@Return A list of instances of this communication method in the format [[UUID: string, endpoint: string], ...]
+			//@Description Lists extant instances of the tcpClient communication method and their UUIDs so users have a hope of recovering their instance if they lose the UUID.
+			//@Description Remember to use `parseSimpleArray` since extensions can only communicate using strings.
+			ans << "[";
+			std::unique_lock<std::mutex> lock(commMethodsMutex);
+			auto it = commMethods.begin();
+			auto end = commMethods.end();
+			bool any = false;
+			for (; it != end; it++) {
+				auto id = (*it).first;
+				auto val = (*it).second;
+				if (TcpClient* client = dynamic_cast<TcpClient*>(val)) {
+					if (any) ans << ", ";
+					ans << "[\"" << id << "\", \"" << client->endpoint << "\"]";
+				}
+			}
+			ans << "]";
+		} },
+	};
+	commands.run(nullptr, function, argv, argc, ans);
 }
 
-void TcpClient::runInstanceCommand(std::string function, std::string* argv, int argc, std::stringstream& ans)
+void TcpClient::runInstanceCommand(std::string_view function, std::string_view* argv, int argc, ResponseWriter& ans)
 {
 	function = argv[0];
 	argv++;
 	argc--;
-	if (equalsIgnoreCase(function, "connect")) {
-		//@InstanceCommand TCPClient.connect
-		//@Args 
-		//@Return A success or failure message
-		//@Description Attempts to connect to the endpoint described by this instance.
-		//@Description Warning: This command will not return until either a connection is made or the socket times out. This will probably take a long time (at least 2 seconds) to happen, and the SQF VM will be stalled until that happens.
-		boost::system::error_code ec;
-		boost::asio::ip::tcp::resolver resolver(ioContext);
-		boost::asio::ip::tcp::resolver::query q(this->endpoint, this->port);
-		auto endpoints = resolver.resolve(q, ec);
+	static const CommandTable<TcpClient> commands = {
+		{ "connect", [](TcpClient* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPClient.connect
+			//@Args 
+			//@Return A success or failure message
+			//@Description Attempts to connect to the endpoint described by this instance.
+			//@Description Warning: This command will not return until either a connection is made or the socket times out. This will probably take a long time (at least 2 seconds) to happen, and the SQF VM will be stalled until that happens.
+			boost::system::error_code ec;
+			boost::asio::ip::tcp::resolver resolver(ioContext);
+			boost::asio::ip::tcp::resolver::query q(self->endpoint, self->port);
+			auto endpoints = resolver.resolve(q, ec);
 		
 		
-		boost::asio::connect(*this->socket, endpoints, ec);
+			boost::asio::connect(*self->socket, endpoints, ec);
 		
-		if (ec || !this->socket->is_open()) {
-			sendFailureArr(ans, "Failed to connect to endpoint: " + ec.message());
-		}
-		else {
-			this->socket->set_option(boost::asio::detail::socket_option::integer<SOL_SOCKET, SO_RCVTIMEO>{200});
-			this->readHandler->startThreads();
-			sendSuccessArr(ans, "Successfully connected to endpoint");
-		}
-	} else if (equalsIgnoreCase(function, "connectAsync")) {
-		//@InstanceCommand TCPClient.connectAsync
-		//@Args 
-		//@Return 
-		//@Description Attempts to connect to the endpoint described by this instance asynchronously. 
-		//@Description On success or failure, the extension will call the callback with the message being the instance UUID and the data being an array with a success or failure message.
-		boost::system::error_code ec;
-		boost::asio::ip::tcp::resolver resolver(ioContext);
-		boost::asio::ip::tcp::resolver::query q(this->endpoint, this->port);
-		auto endpoints = resolver.resolve(q, ec);
-		if (ec) {
-			sendFailureArr(ans, "Failed to connect to endpoint: " + ec.message());
-			return;
-		}
-		boost::asio::async_connect(*this->socket, endpoints, [this](boost::system::error_code ec, auto endp) {
-			if (ec || !this->socket->is_open()) {
-				callbackFailureArr(this->id, "Failed to connect to endpoint: " + ec.message());
+			if (ec || !self->socket->is_open()) {
+				sendFailureArr(ans, "Failed to connect to endpoint: ", ec.message());
 			}
 			else {
-				this->socket->set_option(boost::asio::detail::socket_option::integer<SOL_SOCKET, SO_RCVTIMEO>{200});
-				this->readHandler->startThreads();
-				callbackSuccessArr(this->id, "Successfully connected to endpoint");
+				self->readHandler->startThreads();
+				sendSuccessArr(ans, "Successfully connected to endpoint");
 			}
-		});
-	}
-	else if (equalsIgnoreCase(function, "write")) {
-		//@InstanceCommand TCPClient.write
-		//@Args message: string
-		//@Return Success or failure message
-		//@Description Attempts to send `message`
-		if (argc == 0) {
-			sendFailureArr(ans, "Additional argument required");
-			return;
-		}
-		if (!this->socket->is_open()) {
-			sendFailureArr(ans, "Socket not connected");
-			return;
-		}
-		boost::system::error_code ec;
-		auto buff = boost::asio::buffer(argv[0]);
-		auto written = this->socket->send(buff, 0, ec);
-		if (ec) {
-			sendFailureArr(ans, "Failed to send message: " + ec.message());
-		}
-		else {
-			sendSuccessArr(ans, "Successfully wrote message, bytes written: " + std::to_string(written));
-		}
-	}
-	else if (equalsIgnoreCase(function, "disconnect")) {
-		//@InstanceCommand TCPClient.disconnect
-		//@Args 
-		//@Return A success or failure message
-		//@Description Attempts to disconnect from the TCP server described by this instance.
-		//@Description Any queued asynchronous operations will be canceled.
-		this->readHandler->stopThreads();
-		boost::system::error_code ec;
-		this->socket->close(ec);
-		if (ec) {
-			sendFailureArr(ans, "Failed to disconnect: " + ec.message());
-		}
-		else {
-			sendSuccessArr(ans, "Disconnected successfully.");
-		}
-	}
-	else if (equalsIgnoreCase(function, "callbackOnChar")) {
-		//@InstanceCommand TCPClient.callbackOnChar
-		//@Args charToLookFor: char
-		//@Return 
-		//@Description Makes the extension send data read from this port back to Arma when `charToLookFor`, specified as a `char`, is read.
-		//@Description When the character is read, all data up to and **excluding** that character is sent back to Arma via the callback.
-		if (argc == 0 || argv[0].length() == 0) {
-			sendFailureArr(ans, "Additional argument required");
-			return;
-		}
-		this->readHandler->callbackOnChar(argv[0][0]);
-	}
-	else if (equalsIgnoreCase(function, "callbackOnCharCode")) {
-		//@InstanceCommand TCPClient.callbackOnCharCode
-		//@Args charCodeToLookFor: int
-		//@Return 
-		//@Description Makes the extension send data read from this port back to Arma when the character described by `charCodeToLookFor`, specified as an ASCII char code e.g. `65` for "A", is read.
-		//@Description When the character is read, all data read since the last callback, up to and **excluding** that character, is sent back to Arma via the callback.
-		if (argc == 0 || argv[0].length() == 0) {
-			sendFailureArr(ans, "Additional argument required");
-			return;
-		}
-		try {
-			int val = std::stoi(argv[0]);
-			this->readHandler->callbackOnChar((char)val);
-		}
-		catch (std::exception e) {
-			sendFailureArr(ans, "Exception parsing input: " + std::string(e.what()));
-		}
-	}
-	else if (equalsIgnoreCase(function, "callbackOnLength")) {
-		//@InstanceCommand TCPClient.callbackOnLength
-		//@Args lengthToStopAt: int
-		//@Return 
-		//@Description Makes the extension send data read from this port back to Arma when the total amount of data read reaches `lengthToStopAt` characters long.
-		//@Description When the target amount of data is read, all data read since the last callback is sent back to Arma via the callback.
-		if (argc == 0 || argv[0].length() == 0) {
-			sendFailureArr(ans, "Additional argument required");
-			return;
-		}
-		try {
-			int val = std::stoi(argv[0]);
-			if (val < 1) {
-				sendFailureArr(ans, "Length must be at least 1");
+		} },
+		{ "connectAsync", [](TcpClient* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPClient.connectAsync
+			//@Args 
+			//@Return 
+			//@Description Attempts to connect to the endpoint described by this instance asynchronously. 
+			//@Description On success or failure, the extension will call the callback with the message being the instance UUID and the data being an array with a success or failure message.
+			boost::system::error_code ec;
+			boost::asio::ip::tcp::resolver resolver(ioContext);
+			boost::asio::ip::tcp::resolver::query q(self->endpoint, self->port);
+			auto endpoints = resolver.resolve(q, ec);
+			if (ec) {
+				sendFailureArr(ans, "Failed to connect to endpoint: ", ec.message());
 				return;
 			}
-			this->readHandler->callbackOnLength(val);
-		}
-		catch (std::exception e) {
-			sendFailureArr(ans, "Exception parsing input: " + std::string(e.what()));
-		}
-	}
-	else if (equalsIgnoreCase(function, "isConnected")) {
-		//@InstanceCommand TCPClient.isConnected
-		//@Args 
-		//@Return `true` or `false` based on whether this instance is currently connected to the port it describes
-		//@Description
-		ans << this->isConnected();
-	}
+			boost::asio::async_connect(*self->socket, endpoints, boost::asio::bind_executor(self->strand, [self](boost::system::error_code ec, auto endp) {
+				if (ec || !self->socket->is_open()) {
+					callbackFailureArr(self->id, "Failed to connect to endpoint: " + ec.message());
+				}
+				else {
+					self->readHandler->startThreads();
+					callbackSuccessArr(self->id, "Successfully connected to endpoint");
+				}
+			}));
+		} },
+		{ "write", [](TcpClient* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPClient.write
+			//@Args message: string
+			//@Return Success or failure message
+			//@Description Attempts to send `message`
+			//@Description If threaded writes are enabled (see `enableThreadedWrites`), `message` is queued and the result of sending it is reported via the callback.
+			if (argc == 0) {
+				sendFailureArr(ans, "Additional argument required");
+				return;
+			}
+			if (!self->socket->is_open()) {
+				sendFailureArr(ans, "Socket not connected");
+				return;
+			}
+			if (self->readHandler->isUsingWriteThread()) {
+				self->readHandler->write(argv[0], ans);
+				return;
+			}
+			boost::system::error_code ec;
+			auto buff = boost::asio::buffer(argv[0]);
+			auto startedAt = std::chrono::steady_clock::now();
+			auto written = self->socket->send(buff, 0, ec);
+			self->readHandler->recordWrite(startedAt, !ec, written);
+			if (ec) {
+				sendFailureArr(ans, "Failed to send message: ", ec.message());
+			}
+			else {
+				sendSuccessArr(ans, "Successfully wrote message, bytes written: ", written);
+			}
+		} },
+		{ "disconnect", [](TcpClient* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPClient.disconnect
+			//@Args 
+			//@Return A success or failure message
+			//@Description Attempts to disconnect from the TCP server described by this instance.
+			//@Description Any queued asynchronous operations will be canceled.
+			//closing the socket cancels the outstanding read, which has to finish before the read handler can stop.
+			//it's closed on the strand so it can't happen in the middle of one of the socket's handlers
+			boost::system::error_code ec;
+			runOnStrand(self->strand, [self, &ec]() { self->socket->close(ec); });
+			self->readHandler->stopThreads();
+			if (ec) {
+				sendFailureArr(ans, "Failed to disconnect: ", ec.message());
+			}
+			else {
+				sendSuccessArr(ans, "Disconnected successfully.");
+			}
+		} },
+		{ "enableThreadedWrites", [](TcpClient* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPClient.enableThreadedWrites
+			//@Args 
+			//@Return Success or failure message
+			//@Description Makes `write` queue messages and return right away instead of waiting for them to be sent.
+			//@Description Everything queued since the last send goes out together, and each send calls the callback with the message being the instance UUID and the data being an array with a success or failure message.
+			self->readHandler->enableWriteThread(ans);
+		} },
+		{ "disableThreadedWrites", [](TcpClient* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPClient.disableThreadedWrites
+			//@Args 
+			//@Return Success or failure message
+			//@Description Makes `write` send messages before returning again. Returns once every message already queued has been sent.
+			if (!self->readHandler->isUsingWriteThread()) {
+				sendFailureArr(ans, "Not using threaded writes");
+				return;
+			}
+			self->readHandler->disableWriteThread(ans);
+		} },
+		{ "callbackOnChar", [](TcpClient* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPClient.callbackOnChar
+			//@Args charToLookFor: char
+			//@Return 
+			//@Description Makes the extension send data read from this port back to Arma when `charToLookFor`, specified as a `char`, is read.
+			//@Description When the character is read, all data up to and **excluding** that character is sent back to Arma via the callback.
+			if (argc == 0 || argv[0].length() == 0) {
+				sendFailureArr(ans, "Additional argument required");
+				return;
+			}
+			self->readHandler->callbackOnChar(argv[0][0]);
+		} },
+		{ "callbackOnCharCode", [](TcpClient* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPClient.callbackOnCharCode
+			//@Args charCodeToLookFor: int
+			//@Return 
+			//@Description Makes the extension send data read from this port back to Arma when the character described by `charCodeToLookFor`, specified as an ASCII char code e.g. `65` for "A", is read.
+			//@Description When the character is read, all data read since the last callback, up to and **excluding** that character, is sent back to Arma via the callback.
+			if (argc == 0 || argv[0].length() == 0) {
+				sendFailureArr(ans, "Additional argument required");
+				return;
+			}
+			try {
+				int val = svToInt(argv[0]);
+				self->readHandler->callbackOnChar((char)val);
+			}
+			catch (std::exception e) {
+				sendFailureArr(ans, "Exception parsing input: ", e.what());
+			}
+		} },
+		{ "callbackOnString", [](TcpClient* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPClient.callbackOnString
+			//@Args delimiter: string
+			//@Return 
+			//@Description Makes the extension send data read from this port back to Arma whenever it reads `delimiter`, which can be up to 15 characters long (e.g. `toString [13, 10]` for "\r\n", or "</msg>").
+			//@Description When `delimiter` is read, all data read since the last callback is sent back to Arma via the callback, excluding `delimiter` itself.
+			if (argc == 0 || argv[0].length() == 0) {
+				sendFailureArr(ans, "Additional argument required");
+				return;
+			}
+			if (argv[0].length() > StringDelimiter::maxLength) {
+				sendFailureArr(ans, "Delimiter can be at most ", StringDelimiter::maxLength, " characters long");
+				return;
+			}
+			self->readHandler->callbackOnString(argv[0]);
+		} },
+		{ "callbackOnLength", [](TcpClient* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPClient.callbackOnLength
+			//@Args lengthToStopAt: int
+			//@Return 
+			//@Description Makes the extension send data read from this port back to Arma when the total amount of data read reaches `lengthToStopAt` characters long.
+			//@Description When the target amount of data is read, all data read since the last callback is sent back to Arma via the callback.
+			if (argc == 0 || argv[0].length() == 0) {
+				sendFailureArr(ans, "Additional argument required");
+				return;
+			}
+			try {
+				int val = svToInt(argv[0]);
+				if (val < 1) {
+					sendFailureArr(ans, "Length must be at least 1");
+					return;
+				}
+				self->readHandler->callbackOnLength(val);
+			}
+			catch (std::exception e) {
+				sendFailureArr(ans, "Exception parsing input: ", e.what());
+			}
+		} },
+		{ "callbackOnLengthPrefix", [](TcpClient* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPClient.callbackOnLengthPrefix
+			//@Args lengthSize: int, bigEndian: bool, lengthOffset: int, includeHeader: bool, maxFrameSize: int
+			//@Return 
+			//@Description Makes the extension send data back to Arma one frame at a time, where each frame starts with a header giving its length. This suits binary protocols, where any delimiter could also appear inside a frame.
+			//@Description The header is `lengthOffset` (optional, default `0`) bytes of anything followed by a `lengthSize`-byte (1, 2, or 4) length field, which is big endian unless `bigEndian` (optional, default `true`) is `false`. The length field gives the number of bytes after the header.
+			//@Description Frames are sent without their header unless `includeHeader` (optional, default `false`) is `true`. A frame longer than `maxFrameSize` (optional, default `65536`) is dropped as it arrives rather than buffered, and a failure message is sent via the callback (with the instance's UUID as the function) instead.
+			LengthPrefixOptions options;
+			if (!parseLengthPrefixArgs(argv, argc, options, ans)) return;
+			self->readHandler->callbackOnLengthPrefix(options);
+		} },
+		{ "enableBatching", [](TcpClient* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPClient.enableBatching
+			//@Args maxBytes: int, maxLatencyMs: int
+			//@Return A success or failure message
+			//@Description Makes the extension pack every frame read since the last delivery into a single callback instead of sending one callback per frame, so the number of callbacks follows how often Arma empties its callback buffer rather than how fast data arrives.
+			//@Description Batches are sent with the function "data_read_batch" and data in the form `[UUID: string, [frame1: string, frame2: string, ...]]`.
+			//@Description `maxBytes` (optional, default `8192`) limits the length of a batch's data; once it would be exceeded, a new batch is started.
+			//@Description `maxLatencyMs` (optional, default `0`) is how long a batch may be held back after its first frame so more frames can join it. With `0`, batches only grow while Arma's callback buffer is full.
+			int maxBytes = 8192;
+			int maxLatencyMs = 0;
+			try {
+				if (argc > 0) maxBytes = svToInt(argv[0]);
+				if (argc > 1) maxLatencyMs = svToInt(argv[1]);
+			}
+			catch (std::exception e) {
+				sendFailureArr(ans, "Exception parsing input: ", e.what());
+				return;
+			}
+			if (maxBytes < 64) {
+				sendFailureArr(ans, "maxBytes must be at least 64");
+				return;
+			}
+			if (maxLatencyMs < 0) {
+				sendFailureArr(ans, "maxLatencyMs must not be negative");
+				return;
+			}
+			self->readHandler->enableBatching((size_t)maxBytes, maxLatencyMs, ans);
+		} },
+		{ "disableBatching", [](TcpClient* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPClient.disableBatching
+			//@Args 
+			//@Return A success or failure message
+			//@Description Goes back to sending one "data_read" callback per frame. Frames already in a batch are still sent as a batch.
+			self->readHandler->disableBatching(ans);
+		} },
+		{ "enablePolling", [](TcpClient* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPClient.enablePolling
+			//@Args maxFrames: int
+			//@Return A success or failure message
+			//@Description Makes the extension hold on to frames it reads until they are collected with `readAvailable`, instead of sending a "data_read" callback for each one. Polling once per frame avoids Arma's limit of 100 waiting callbacks.
+			//@Description Once `maxFrames` (optional, default `1024`) frames are waiting, the extension stops reading until some are collected, leaving further data with the operating system, unless `setOverflowPolicy` says otherwise.
+			int maxFrames = 1024;
+			try {
+				if (argc > 0) maxFrames = svToInt(argv[0]);
+			}
+			catch (std::exception e) {
+				sendFailureArr(ans, "Exception parsing input: ", e.what());
+				return;
+			}
+			if (maxFrames < 1) {
+				sendFailureArr(ans, "maxFrames must be at least 1");
+				return;
+			}
+			self->readHandler->enablePolling((size_t)maxFrames, ans);
+		} },
+		{ "disablePolling", [](TcpClient* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPClient.disablePolling
+			//@Args 
+			//@Return A success or failure message
+			//@Description Goes back to sending frames via the callback. Frames that were already waiting can still be collected with `readAvailable`.
+			self->readHandler->disablePolling(ans);
+		} },
+		{ "readAvailable", [](TcpClient* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPClient.readAvailable
+			//@Args 
+			//@Return `[[frame1: string, frame2: string, ...], remaining: int]`
+			//@Description Collects as many waiting frames (see `enablePolling`) as fit in Arma's output buffer, oldest first. `remaining` is how many are still waiting after this call.
+			self->readHandler->readAvailable(ans);
+		} },
+		{ "setOverflowPolicy", [](TcpClient* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPClient.setOverflowPolicy
+			//@Args policy: string, maxFrames: int
+			//@Return A success or failure message
+			//@Description Decides what happens to frames read while `maxFrames` (optional, default `1024`) are already waiting to be delivered, either for `readAvailable` or for room in Arma's callback buffer (which holds 100).
+			//@Description `policy` is one of "block" (the default: stop reading until there's room, leaving data with the operating system), "dropOldest", "dropNewest", or "conflateLatest" (replace the newest waiting frame, so the latest data always gets through). Dropped frames are counted by `getOverflowStats`.
+			OverflowPolicy policy;
+			size_t maxFrames;
+			if (!parseOverflowPolicyArgs(argv, argc, policy, maxFrames, ans)) return;
+			self->readHandler->setOverflowPolicy(policy, maxFrames, ans);
+		} },
+		{ "getOverflowStats", [](TcpClient* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPClient.getOverflowStats
+			//@Args 
+			//@Return `[droppedFrames, droppedBytes, waitingFrames]`
+			//@Description Counts the frames (and their bytes) thrown away by the overflow policy since the connection was made, and how many are waiting to be delivered right now.
+			self->readHandler->overflowStats(ans);
+		} },
+		{ "getAllocationStats", [](TcpClient* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPClient.getAllocationStats
+			//@Args 
+			//@Return `[allocations, reuses, allocationsPerSecond]`
+			//@Description Returns how many read and write buffers this instance has had to allocate, how many were reused instead, and how many allocations per second there have been since the last call to this command.
+			//@Description Once reads and writes have been going for a while, `allocationsPerSecond` should stay at 0.
+			self->readHandler->allocationStats(ans);
+		} },
+		{ "getStats", [](TcpClient* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPClient.getStats
+			//@Args 
+			//@Return `[bytesIn, framesIn, bytesOut, writesQueued, writesCompleted, writeQueueDepth, callbackRetries, readErrors, writeErrors, callbacksDropped]`
+			//@Description Returns counters for everything this instance has done since it was created. `framesIn` counts frames before any overflow policy drops them, and `writeQueueDepth` is how many writes are queued but not finished.
+			//@Description `callbackRetries` counts how often Arma's callback buffer was full when this instance's callbacks were offered to it, and `callbacksDropped` how many of its callbacks were thrown away because too many were already waiting. The counters are always kept, and cheap enough that there's no need to turn them off.
+			self->readHandler->getStats().write(ans);
+		} },
+		{ "getLatency", [](TcpClient* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPClient.getLatency
+			//@Args 
+			//@Return `[[callbacks, p50, p99, p999, max], [writes, p50, p99, p999, max]]`
+			//@Description Returns how long this instance's data took to reach SQF and its writes took to go out, in microseconds. The first array measures from data being read to Arma accepting the callback it went out in, and the second from a write being queued (or called, if writes aren't threaded) to it finishing.
+			//@Description Percentiles come from a histogram with about 6% precision, while `max` is exact. Call `resetLatency` to start measuring afresh, e.g. right before a busy part of a mission.
+			self->readHandler->latencyStats(ans);
+		} },
+		{ "resetLatency", [](TcpClient* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPClient.resetLatency
+			//@Args 
+			//@Return A success message
+			//@Description Clears the latencies recorded so far (see `getLatency`).
+			self->readHandler->resetLatency(ans);
+		} },
+		{ "isConnected", [](TcpClient* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPClient.isConnected
+			//@Args 
+			//@Return `true` or `false` based on whether this instance is currently connected to the port it describes
+			//@Description
+			ans << self->isConnected();
+		} },
+	};
+	commands.run(this, function, argv, argc, ans);
 }
 
 std::string TcpClient::getID()
@@ -2,12 +2,15 @@
 #include <boost/asio.hpp>
 #include "util.h"
 #include "ReadWriteHandler.h"
+#include "IOContextHelper.h"
 
 class TcpClient :
     public ICommunicationMethod
 {
 private:
     ReadWriteHandler<boost::asio::ip::tcp::socket>* readHandler;
+    //keeps this instance's io_context handlers from running concurrently
+    IOStrand strand;
 public:
     std::string id;
     
@@ -17,10 +20,11 @@ public:
 
     TcpClient(std::string endpointIp, std::string port);
     ~TcpClient();
-    static void runStaticCommand(std::string function, std::string* argv, int argc, std::stringstream& ans);
-    void runInstanceCommand(std::string function, std::string* argv, int argc, std::stringstream& ans);
+    static void runStaticCommand(std::string_view function, std::string_view* argv, int argc, ResponseWriter& ans);
+    void runInstanceCommand(std::string_view function, std::string_view* argv, int argc, ResponseWriter& ans);
     std::string getID();
     bool isConnected();
     bool destroy();
+    void addStats(IOStatsSnapshot& total);
 };
 
@@ -1,11 +1,14 @@
 #include "tcpServer.h"
+#include "CommandTable.h"
+#include "CallbackDispatcher.h"
 
 //@CommMethod TCPServer
 //@Description This communication method is an interface for a TCP server. It can asynchronously listen for incoming connections on a provided port and return TCPServerConnections representing active connections.
 
 //@CommMethod TCPServerConnection
 //@Description This communication method is used for TCP connections to a TCPServer communication method. This comm method cannot be directly created; it is only created when a remote client connects to a TCPServer.
-extern std::map<std::string, ICommunicationMethod*> commMethods;
+extern std::map<std::string, ICommunicationMethod*, std::less<>> commMethods;
+extern std::mutex commMethodsMutex;
 extern ArmaCallback callback;
 extern boost::asio::io_context ioContext;
 
@@ -13,7 +16,7 @@ using boost::asio::ip::tcp;
 
 std::map<int, TcpServer*> tcpServers;
 
-TcpServer::TcpServer(int port)
+TcpServer::TcpServer(int port) : strand(boost::asio::make_strand(ioContext))
 {
 	needIOContext();
 	this->id = generateUUID();
@@ -26,7 +29,7 @@ TcpServer::~TcpServer()
 	delete this->acceptor;
 }
 
-void TcpServer::runStaticCommand(std::string function, std::string* argv, int argc, std::stringstream& ans)
+void TcpServer::runStaticCommand(std::string_view function, std::string_view* argv, int argc, ResponseWriter& ans)
 {
 	if (argc == 0) {
 		sendFailureArr(ans, "Additional argument required");
@@ -35,55 +38,62 @@ void TcpServer::runStaticCommand(std::string function, std::string* argv, int ar
 	function = *argv;
 	argv++;
 	argc--;
-	if (equalsIgnoreCase(function, "create")) {
-		//@StaticCommand TCPServer.create
-		//@Args port: int
-		//@Return A success or failure message
-		//@Description Creates an instance of this communication method and returns a UUID representing it.
-		//@Description This command does not attempt to listen for connections; you must initiate that separately.
-		if (argc < 1) { sendFailureArr(ans, "You must specify a port for this command"); return; }
-		int port;
-		try {
-			port = std::stoi(argv[0]);
-		}
-		catch (std::exception e) {
-			sendFailureArr(ans, "Exception parsing input: " + std::string(e.what()));
-			return;
-		}
-		if (tcpServers.find(port) != tcpServers.end()) {
-			sendFailureArr(ans, "A TCP Server already exists for the given port");
-			return;
-		}
-		TcpServer* server = new TcpServer(port);
-		tcpServers[port] = server;
-		commMethods[server->getID()] = server;
-		ans << server->getID();
-	}
-	else if (equalsIgnoreCase(function, "listInstances")) {
-		//@StaticCommand TCPServer.listInstances
-		//@Args 
-		//@Return A list of instances of this communication method in the format [[UUID: string, port: string], ...]
-		//@Description Lists extant instances of the TCPServer communication method and their UUIDs so users have a hope of recovering their instance if they lose the UUID.
-		//@Description Remember to use `parseSimpleArray` since extensions can only communicate using strings.
-		ans << "[";
-		auto it = commMethods.begin();
-		auto end = commMethods.end();
-		bool any = false;
-		for (; it != end; it++) {
-			auto id = (*it).first;
-			auto val = (*it).second;
-			if (TcpServer* server = dynamic_cast<TcpServer*>(val)) {
-				if (any) ans << ", ";
-				ans << "[\"" << id << "\", \"" << server->port << "\"]";
+	static const CommandTable<void> commands = {
+		{ "create", [](void*, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@StaticCommand TCPServer.create
+			//@Args port: int
+			//@Return A success or failure message
+			//@Description Creates an instance of this communication method and returns a UUID representing it.
+			//@Description This command does not attempt to listen for connections; you must initiate that separately.
+			if (argc < 1) { sendFailureArr(ans, "You must specify a port for this command"); return; }
+			int port;
+			try {
+				port = svToInt(argv[0]);
 			}
-		}
-		ans << "]";
-	}
+			catch (std::exception e) {
+				sendFailureArr(ans, "Exception parsing input: ", e.what());
+				return;
+			}
+			if (tcpServers.find(port) != tcpServers.end()) {
+				sendFailureArr(ans, "A TCP Server already exists for the given port");
+				return;
+			}
+			TcpServer* server = new TcpServer(port);
+			tcpServers[port] = server;
+			{
+				std::unique_lock<std::mutex> lock(commMethodsMutex);
+				commMethods[server->getID()] = server;
+			}
+			ans << server->getID();
+		} },
+		{ "listInstances", [](void*, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@StaticCommand TCPServer.listInstances
+			//@Args 
+			//@Return A list of instances of this communication method in the format [[UUID: string, port: string], ...]
+			//@Description Lists extant instances of the TCPServer communication method and their UUIDs so users have a hope of recovering their instance if they lose the UUID.
+			//@Description Remember to use `parseSimpleArray` since extensions can only communicate using strings.
+			ans << "[";
+			std::unique_lock<std::mutex> lock(commMethodsMutex);
+			auto it = commMethods.begin();
+			auto end = commMethods.end();
+			bool any = false;
+			for (; it != end; it++) {
+				auto id = (*it).first;
+				auto val = (*it).second;
+				if (TcpServer* server = dynamic_cast<TcpServer*>(val)) {
+					if (any) ans << ", ";
+					ans << "[\"" << id << "\", \"" << server->port << "\"]";
+				}
+			}
+			ans << "]";
+		} },
+	};
+	commands.run(nullptr, function, argv, argc, ans);
 }
 
 void TcpServer::listen() {
 	if (!this->shouldListen) return;
-	this->acceptor->async_accept([this](auto ec, boost::asio::ip::tcp::socket newConn) {
+	this->acceptor->async_accept(boost::asio::bind_executor(this->strand, [this](auto ec, boost::asio::ip::tcp::socket newConn) {
 		if (ec) {
 			if (this->shouldListen) callbackFailureArr(this->id, "Failed to listen for connections: " + ec.message());
 		}
@@ -92,80 +102,93 @@ void TcpServer::listen() {
 			this->connectionsMutex.lock();
 			this->connections.push_back(client);
 			this->connectionsMutex.unlock();
-			auto data = ("[\""+this->id+"\", \"" + client->getID() + "\"]");
-			while (callback("ArmaCOM", "new_tcp_connection", data.c_str()) == -1) Sleep(1);
+			//post never blocks, so a full callback buffer in Arma can't stall the io_context here
+			CallbackDispatcher::get().post("new_tcp_connection", "[\"" + this->id + "\", \"" + client->getID() + "\"]");
 			this->listen();
 		}
-	});
+	}));
 }
 
-void TcpServer::runInstanceCommand(std::string function, std::string* argv, int argc, std::stringstream& ans)
+void TcpServer::runInstanceCommand(std::string_view function, std::string_view* argv, int argc, ResponseWriter& ans)
 {
 	function = argv[0];
 	argv++;
 	argc--;
-	if (equalsIgnoreCase(function, "listen")) {
-		//@InstanceCommand TCPServer.listen
-		//@Args 
-		//@Return A success or failure message
-		//@Description Attempts to start listening for new TCP connections on this server's port.
-		//@Description The listening process is asynchronous, and connections will be reported via callback, with the function being "new_tcp_connection", and the args taking this form: `[serverID: string, newConnectionID: string]`
-		//@Description If the attempt fails at a later stage during the async pipeline, the failure will be reported along with an error message, with the function being "FAILURE" and the args taking this form: `[serverID: string, message: string]`
-		//@Description As mentioned earlier, connections are of the communication method TCPServerConnection.
-		boost::system::error_code ec;
-		this->acceptor->listen(10, ec);
-		if (ec) {
-			sendFailureArr(ans, "Failed to listen: " + ec.message());
-			return;
-		}
-		this->shouldListen = true;
-		this->listen();
-		sendSuccessArr(ans, "Started listening");
-	}
-	else if (equalsIgnoreCase(function, "stopListening")) {
-		//@InstanceCommand TCPServer.stopListening
-		//@Args 
-		//@Return A success or failure message
-		//@Description Stops listening for new connections.
-		this->shouldListen = false;
-		boost::system::error_code ec;
-		this->acceptor->cancel(ec);
-		if (!ec) this->acceptor->close(ec);
-		if (ec) {
-			sendFailureArr(ans, "Failed to cancel accept: " + ec.message());
-		}
-		else {
-			sendSuccessArr(ans, "Successfully cancelled accept operation");
-		}
-	}
-	else if (equalsIgnoreCase(function, "disconnectAll")) {
-		//@InstanceCommand TCPServer.disconnectAll
-		//@Args 
-		//@Return A success or failure message
-		//@Description Attempts to disconnect and destroy all existing connections to this server.
-		//@Description All clients must be disconnected before destroying a server, so call this function before attempting to destroy a TCPServer if you're not sure if there's still connections.
-
-		//copy the list of connections so we don't have any issues like deadlocks
-		this->connectionsMutex.lock();
-		std::vector<TcpServerConnection*> tmp(this->connections);
-		this->connectionsMutex.unlock();
-		size_t len = tmp.size();
-		//I think it's technically possible to have a use-after-free of some kind here, but
-		//unless I'm sorely mistaken, it should only be possible in some kind of crazy edge case
-		//that isn't worth worrying about unless people start using the extension in weird ways.
-		for (auto it = tmp.begin(); it < tmp.end(); it++) {
-			auto c = *it;
-			auto id = c->getID();
-			auto ec = c->disconnect();
+	static const CommandTable<TcpServer> commands = {
+		{ "listen", [](TcpServer* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPServer.listen
+			//@Args 
+			//@Return A success or failure message
+			//@Description Attempts to start listening for new TCP connections on this server's port.
+			//@Description The listening process is asynchronous, and connections will be reported via callback, with the function being "new_tcp_connection", and the args taking this form: `[serverID: string, newConnectionID: string]`
+			//@Description If the attempt fails at a later stage during the async pipeline, the failure will be reported along with an error message, with the function being "FAILURE" and the args taking this form: `[serverID: string, message: string]`
+			//@Description As mentioned earlier, connections are of the communication method TCPServerConnection.
+			boost::system::error_code ec;
+			self->acceptor->listen(10, ec);
 			if (ec) {
-				sendFailureArr(ans, "Failed to disconnect a client: " + ec.message());
+				sendFailureArr(ans, "Failed to listen: ", ec.message());
+				return;
 			}
-			commMethods.erase(id);
-			c->destroy();
-			delete c;
-		}
-		sendSuccessArr(ans, "Disconnected and destroyed all " + std::to_string(len) + " connections.");
-	}
+			self->shouldListen = true;
+			self->listen();
+			sendSuccessArr(ans, "Started listening");
+		} },
+		{ "stopListening", [](TcpServer* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPServer.stopListening
+			//@Args 
+			//@Return A success or failure message
+			//@Description Stops listening for new connections.
+			self->shouldListen = false;
+			boost::system::error_code ec;
+			self->acceptor->cancel(ec);
+			if (!ec) self->acceptor->close(ec);
+			if (ec) {
+				sendFailureArr(ans, "Failed to cancel accept: ", ec.message());
+			}
+			else {
+				sendSuccessArr(ans, "Successfully cancelled accept operation");
+			}
+		} },
+		{ "disconnectAll", [](TcpServer* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPServer.disconnectAll
+			//@Args 
+			//@Return A success or failure message
+			//@Description Attempts to disconnect and destroy all existing connections to this server.
+			//@Description All clients must be disconnected before destroying a server, so call this function before attempting to destroy a TCPServer if you're not sure if there's still connections.
+
+			//copy the list of connections so we don't have any issues like deadlocks
+			self->connectionsMutex.lock();
+			std::vector<TcpServerConnection*> tmp(self->connections);
+			self->connectionsMutex.unlock();
+			size_t len = tmp.size();
+			//I think it's technically possible to have a use-after-free of some kind here, but
+			//unless I'm sorely mistaken, it should only be possible in some kind of crazy edge case
+			//that isn't worth worrying about unless people start using the extension in weird ways.
+			for (auto it = tmp.begin(); it < tmp.end(); it++) {
+				auto c = *it;
+				auto id = c->getID();
+				auto ec = c->disconnect();
+				if (ec) {
+					sendFailureArr(ans, "Failed to disconnect a client: ", ec.message());
+				}
+				{
+					std::unique_lock<std::mutex> lock(commMethodsMutex);
+					commMethods.erase(id);
+				}
+				c->destroy();
+				delete c;
+			}
+			sendSuccessArr(ans, "Disconnected and destroyed all ", len, " connections.");
+		} },
+		{ "getStats", [](TcpServer* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPServer.getStats
+			//@Args 
+			//@Return `[bytesIn, framesIn, bytesOut, writesQueued, writesCompleted, writeQueueDepth, callbackRetries, readErrors, writeErrors, callbacksDropped]`
+			//@Description Adds up the I/O counters (see `TCPServerConnection.getStats`) of every connection to this server that hasn't been destroyed.
+			self->connectionStats().write(ans);
+		} },
+	};
+	commands.run(this, function, argv, argc, ans);
 }
 
 std::string TcpServer::getID()
@@ -185,6 +208,19 @@ bool TcpServer::destroy()
 	return true;
 }
 
+void TcpServer::addStats(IOStatsSnapshot& total)
+{
+	//every connection is an instance of its own, and is counted as one
+}
+
+IOStatsSnapshot TcpServer::connectionStats()
+{
+	IOStatsSnapshot ans;
+	std::unique_lock<std::mutex> lock(this->connectionsMutex);
+	for (auto c : this->connections) c->addStats(ans);
+	return ans;
+}
+
 void TcpServer::removeConnection(TcpServerConnection* conn)
 {
 	this->connectionsMutex.lock();
@@ -207,28 +243,28 @@ void TcpServer::removeConnection(TcpServerConnection* conn)
 	this->connectionsMutex.unlock();
 }
 
-TcpServerConnection::TcpServerConnection(boost::asio::ip::tcp::socket sock, TcpServer* serv) : socket(std::move(sock)), server(serv)
+TcpServerConnection::TcpServerConnection(boost::asio::ip::tcp::socket sock, TcpServer* serv) : socket(std::move(sock)), server(serv), strand(boost::asio::make_strand(ioContext))
 {
 	needIOContext();
 	this->id = generateUUID();
-	commMethods[this->id] = this;
-	auto writeFunc = [](auto handle, auto str, auto len, auto written) {return false; };
-	auto readFunc = [](boost::asio::ip::tcp::socket* handle, char* toWrite) {
-		auto buff = boost::asio::buffer(toWrite, 1);
-		boost::system::error_code ec;
-
-		return !ec && handle->read_some(buff, ec) == 1;
-	};
-	this->readHandler = new ReadWriteHandler<boost::asio::ip::tcp::socket>(&this->socket, this, writeFunc, readFunc, true, false);
+	//reads and threaded writes are done asynchronously on the io_context, so there's no blocking read or write function
+	this->readHandler = new ReadWriteHandler<boost::asio::ip::tcp::socket>(&this->socket, this, nullptr, nullptr, true, false);
+	this->readHandler->useAsyncOps(tcpAsyncOps(this->strand));
 	this->readHandler->startThreads();
 	this->connected = true;
+	{
+		//this runs in an accept handler on an io_context thread, while Arma's thread may be looking instances up,
+		//so it's only made visible once it's fully set up
+		std::unique_lock<std::mutex> lock(commMethodsMutex);
+		commMethods[this->id] = this;
+	}
 }
 
 TcpServerConnection::~TcpServerConnection()
 {
 }
 
-void TcpServerConnection::runStaticCommand(std::string function, std::string* argv, int argc, std::stringstream& ans)
+void TcpServerConnection::runStaticCommand(std::string_view function, std::string_view* argv, int argc, ResponseWriter& ans)
 {
 	//no static commands for this comm method, it can only be created through TcpServer
 }
@@ -236,152 +272,328 @@ void TcpServerConnection::runStaticCommand(std::string function, std::string* ar
 boost::system::error_code TcpServerConnection::disconnect() {
 	boost::system::error_code ec;
 	if (!this->connected) return ec;
-	this->socket.close(ec);
+	//closed on the strand so it can't happen in the middle of one of the socket's handlers
+	runOnStrand(this->strand, [this, &ec]() { this->socket.close(ec); });
 	if (ec) return ec;
+	//closing the socket cancels the outstanding read, which has to finish before the socket is destroyed
+	this->readHandler->stopThreads();
 	//we must manually call the destructor because otherwise the IOContext will still
 	//have a "valid" handle to this socket, even after this TcpServerConnection has been destroyed
 	//and the memory is invalid, leading to a guaranteed use-after-free when the IOContext is destroyed.
 	this->socket.~basic_stream_socket();
-	this->readHandler->stopThreads();
 	this->connected = false;
 	return ec;
 }
 
-void TcpServerConnection::runInstanceCommand(std::string function, std::string* argv, int argc, std::stringstream& ans)
+void TcpServerConnection::runInstanceCommand(std::string_view function, std::string_view* argv, int argc, ResponseWriter& ans)
 {
 	function = argv[0];
 	argv++;
 	argc--;
-	if (equalsIgnoreCase(function, "getEndpoint")) {
-		//@InstanceCommand TCPServerConnection.write
-		//@Args
-		//@Return The remote endpoint this connection is to
-		//@Description Returns the name of the remote endpoint this connection is to as described by the underlying socket.
-		//@Description The returned value will be the endpoint's name and the (remote) port, separated by a colon, e.g. `127.0.0.1:8080`.
-		if (!this->connected) sendFailureArr(ans, "This connection has already destroyed its socket");
-		boost::system::error_code ec;
-		auto ep = this->socket.remote_endpoint(ec);
-		if (ec) {
-			sendFailureArr(ans, "Failed to get the remote endpoint: " + ec.message());
-			return;
-		}
-		auto addr = ep.address();
-		auto port = ep.port();
-		ans << addr.to_string() << ":" << std::to_string(port);
-	}
-	else if (equalsIgnoreCase(function, "isIPv6")) {
-		//@InstanceCommand TCPServerConnection.isIPv6
-		//@Args
-		//@Return Whether or not this connection is IPv6
-		//@Description Returns `true` if this connection is over IPv6, and `false` otherwise
-		if (!this->connected) sendFailureArr(ans, "This connection has already destroyed its socket");
-		boost::system::error_code ec;
-		auto ep = this->socket.remote_endpoint(ec);
-		if (ec) {
-			sendFailureArr(ans, "Failed to get the remote endpoint: " + ec.message());
-			return;
-		}
-		ans << ep.address().is_v6();
-	}
-	else if (equalsIgnoreCase(function, "write")) {
-		//@InstanceCommand TCPServerConnection.write
-		//@Args message: string
-		//@Return Success or failure message
-		//@Description Attempts to send `message`
-		if (argc == 0) {
-			sendFailureArr(ans, "Additional argument required");
-			return;
-		}
-		if (!this->connected) sendFailureArr(ans, "This connection has already destroyed its socket");
-		if (!this->socket.is_open()) {
-			sendFailureArr(ans, "Socket not connected");
-			return;
-		}
-		boost::system::error_code ec;
-		auto buff = boost::asio::buffer(argv[0]);
-		auto written = this->socket.send(buff, 0, ec);
-		if (ec) {
-			sendFailureArr(ans, "Failed to send message: " + ec.message());
-		}
-		else {
-			sendSuccessArr(ans, "Successfully wrote message, bytes written: " + std::to_string(written));
-		}
-	}
-	else if (equalsIgnoreCase(function, "disconnect")) {
-		//@InstanceCommand TCPServerConnection.disconnect
-		//@Args 
-		//@Return A success or failure message
-		//@Description Attempts to disconnect from the remote client.
-		//@Description Any queued asynchronous operations will be canceled.
+	static const CommandTable<TcpServerConnection> commands = {
+		{ "getEndpoint", [](TcpServerConnection* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPServerConnection.write
+			//@Args
+			//@Return The remote endpoint this connection is to
+			//@Description Returns the name of the remote endpoint this connection is to as described by the underlying socket.
+			//@Description The returned value will be the endpoint's name and the (remote) port, separated by a colon, e.g. `127.0.0.1:8080`.
+			if (!self->connected) sendFailureArr(ans, "This connection has already destroyed its socket");
+			boost::system::error_code ec;
+			auto ep = self->socket.remote_endpoint(ec);
+			if (ec) {
+				sendFailureArr(ans, "Failed to get the remote endpoint: ", ec.message());
+				return;
+			}
+			auto addr = ep.address();
+			auto port = ep.port();
+			ans << addr.to_string() << ":" << std::to_string(port);
+		} },
+		{ "isIPv6", [](TcpServerConnection* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPServerConnection.isIPv6
+			//@Args
+			//@Return Whether or not this connection is IPv6
+			//@Description Returns `true` if this connection is over IPv6, and `false` otherwise
+			if (!self->connected) sendFailureArr(ans, "This connection has already destroyed its socket");
+			boost::system::error_code ec;
+			auto ep = self->socket.remote_endpoint(ec);
+			if (ec) {
+				sendFailureArr(ans, "Failed to get the remote endpoint: ", ec.message());
+				return;
+			}
+			ans << ep.address().is_v6();
+		} },
+		{ "write", [](TcpServerConnection* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPServerConnection.write
+			//@Args message: string
+			//@Return Success or failure message
+			//@Description Attempts to send `message`
+			//@Description If threaded writes are enabled (see `enableThreadedWrites`), `message` is queued and the result of sending it is reported via the callback.
+			if (argc == 0) {
+				sendFailureArr(ans, "Additional argument required");
+				return;
+			}
+			if (!self->connected) sendFailureArr(ans, "This connection has already destroyed its socket");
+			if (!self->socket.is_open()) {
+				sendFailureArr(ans, "Socket not connected");
+				return;
+			}
+			if (self->readHandler->isUsingWriteThread()) {
+				self->readHandler->write(argv[0], ans);
+				return;
+			}
+			boost::system::error_code ec;
+			auto buff = boost::asio::buffer(argv[0]);
+			auto startedAt = std::chrono::steady_clock::now();
+			auto written = self->socket.send(buff, 0, ec);
+			self->readHandler->recordWrite(startedAt, !ec, written);
+			if (ec) {
+				sendFailureArr(ans, "Failed to send message: ", ec.message());
+			}
+			else {
+				sendSuccessArr(ans, "Successfully wrote message, bytes written: ", written);
+			}
+		} },
+		{ "disconnect", [](TcpServerConnection* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPServerConnection.disconnect
+			//@Args 
+			//@Return A success or failure message
+			//@Description Attempts to disconnect from the remote client.
+			//@Description Any queued asynchronous operations will be canceled.
 		
-		auto ec = this->disconnect();
+			auto ec = self->disconnect();
 		
-		if (ec) {
-			sendFailureArr(ans, "Failed to disconnect: " + ec.message());
-		}
-		else {
-			sendSuccessArr(ans, "Disconnected successfully.");
-		}
-	}
-	else if (equalsIgnoreCase(function, "callbackOnChar")) {
-		//@InstanceCommand TCPServerConnection.callbackOnChar
-		//@Args charToLookFor: char
-		//@Return 
-		//@Description Makes the extension send data read from this port back to Arma when `charToLookFor`, specified as a `char`, is read.
-		//@Description When the character is read, all data up to and **excluding** that character is sent back to Arma via the callback.
-		if (argc == 0 || argv[0].length() == 0) {
-			sendFailureArr(ans, "Additional argument required");
-			return;
-		}
-		this->readHandler->callbackOnChar(argv[0][0]);
-	}
-	else if (equalsIgnoreCase(function, "callbackOnCharCode")) {
-		//@InstanceCommand TCPServerConnection.callbackOnCharCode
-		//@Args charCodeToLookFor: int
-		//@Return 
-		//@Description Makes the extension send data read from this port back to Arma when the character described by `charCodeToLookFor`, specified as an ASCII char code e.g. `65` for "A", is read.
-		//@Description When the character is read, all data read since the last callback, up to and **excluding** that character, is sent back to Arma via the callback.
-		if (argc == 0 || argv[0].length() == 0) {
-			sendFailureArr(ans, "Additional argument required");
-			return;
-		}
-		try {
-			int val = std::stoi(argv[0]);
-			this->readHandler->callbackOnChar((char)val);
-		}
-		catch (std::exception e) {
-			sendFailureArr(ans, "Exception parsing input: " + std::string(e.what()));
-		}
-	}
-	else if (equalsIgnoreCase(function, "callbackOnLength")) {
-		//@InstanceCommand TCPServerConnection.callbackOnLength
-		//@Args lengthToStopAt: int
-		//@Return 
-		//@Description Makes the extension send data read from this port back to Arma when the total amount of data read reaches `lengthToStopAt` characters long.
-		//@Description When the target amount of data is read, all data read since the last callback is sent back to Arma via the callback.
-		if (argc == 0 || argv[0].length() == 0) {
-			sendFailureArr(ans, "Additional argument required");
-			return;
-		}
-		try {
-			int val = std::stoi(argv[0]);
-			if (val < 1) {
-				sendFailureArr(ans, "Length must be at least 1");
+			if (ec) {
+				sendFailureArr(ans, "Failed to disconnect: ", ec.message());
+			}
+			else {
+				sendSuccessArr(ans, "Disconnected successfully.");
+			}
+		} },
+		{ "enableThreadedWrites", [](TcpServerConnection* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPServerConnection.enableThreadedWrites
+			//@Args 
+			//@Return Success or failure message
+			//@Description Makes `write` queue messages and return right away instead of waiting for them to be sent.
+			//@Description Everything queued since the last send goes out together, and each send calls the callback with the message being the instance UUID and the data being an array with a success or failure message.
+			self->readHandler->enableWriteThread(ans);
+		} },
+		{ "disableThreadedWrites", [](TcpServerConnection* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPServerConnection.disableThreadedWrites
+			//@Args 
+			//@Return Success or failure message
+			//@Description Makes `write` send messages before returning again. Returns once every message already queued has been sent.
+			if (!self->readHandler->isUsingWriteThread()) {
+				sendFailureArr(ans, "Not using threaded writes");
 				return;
 			}
-			this->readHandler->callbackOnLength(val);
-		}
-		catch (std::exception e) {
-			sendFailureArr(ans, "Exception parsing input: " + std::string(e.what()));
-		}
-	}
-	else if (equalsIgnoreCase(function, "isConnected")) {
-		//@InstanceCommand TCPServerConnection.isConnected
-		//@Args 
-		//@Return `true` or `false` based on whether this instance is currently connected to the port it describes
-		//@Description
-		ans << this->isConnected();
-	}
+			self->readHandler->disableWriteThread(ans);
+		} },
+		{ "callbackOnChar", [](TcpServerConnection* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPServerConnection.callbackOnChar
+			//@Args charToLookFor: char
+			//@Return 
+			//@Description Makes the extension send data read from this port back to Arma when `charToLookFor`, specified as a `char`, is read.
+			//@Description When the character is read, all data up to and **excluding** that character is sent back to Arma via the callback.
+			if (argc == 0 || argv[0].length() == 0) {
+				sendFailureArr(ans, "Additional argument required");
+				return;
+			}
+			self->readHandler->callbackOnChar(argv[0][0]);
+		} },
+		{ "callbackOnCharCode", [](TcpServerConnection* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPServerConnection.callbackOnCharCode
+			//@Args charCodeToLookFor: int
+			//@Return 
+			//@Description Makes the extension send data read from this port back to Arma when the character described by `charCodeToLookFor`, specified as an ASCII char code e.g. `65` for "A", is read.
+			//@Description When the character is read, all data read since the last callback, up to and **excluding** that character, is sent back to Arma via the callback.
+			if (argc == 0 || argv[0].length() == 0) {
+				sendFailureArr(ans, "Additional argument required");
+				return;
+			}
+			try {
+				int val = svToInt(argv[0]);
+				self->readHandler->callbackOnChar((char)val);
+			}
+			catch (std::exception e) {
+				sendFailureArr(ans, "Exception parsing input: ", e.what());
+			}
+		} },
+		{ "callbackOnString", [](TcpServerConnection* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPServerConnection.callbackOnString
+			//@Args delimiter: string
+			//@Return 
+			//@Description Makes the extension send data read from this port back to Arma whenever it reads `delimiter`, which can be up to 15 characters long (e.g. `toString [13, 10]` for "\r\n", or "</msg>").
+			//@Description When `delimiter` is read, all data read since the last callback is sent back to Arma via the callback, excluding `delimiter` itself.
+			if (argc == 0 || argv[0].length() == 0) {
+				sendFailureArr(ans, "Additional argument required");
+				return;
+			}
+			if (argv[0].length() > StringDelimiter::maxLength) {
+				sendFailureArr(ans, "Delimiter can be at most ", StringDelimiter::maxLength, " characters long");
+				return;
+			}
+			self->readHandler->callbackOnString(argv[0]);
+		} },
+		{ "callbackOnLength", [](TcpServerConnection* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPServerConnection.callbackOnLength
+			//@Args lengthToStopAt: int
+			//@Return 
+			//@Description Makes the extension send data read from this port back to Arma when the total amount of data read reaches `lengthToStopAt` characters long.
+			//@Description When the target amount of data is read, all data read since the last callback is sent back to Arma via the callback.
+			if (argc == 0 || argv[0].length() == 0) {
+				sendFailureArr(ans, "Additional argument required");
+				return;
+			}
+			try {
+				int val = svToInt(argv[0]);
+				if (val < 1) {
+					sendFailureArr(ans, "Length must be at least 1");
+					return;
+				}
+				self->readHandler->callbackOnLength(val);
+			}
+			catch (std::exception e) {
+				sendFailureArr(ans, "Exception parsing input: ", e.what());
+			}
+		} },
+		{ "callbackOnLengthPrefix", [](TcpServerConnection* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPServerConnection.callbackOnLengthPrefix
+			//@Args lengthSize: int, bigEndian: bool, lengthOffset: int, includeHeader: bool, maxFrameSize: int
+			//@Return 
+			//@Description Makes the extension send data back to Arma one frame at a time, where each frame starts with a header giving its length. This suits binary protocols, where any delimiter could also appear inside a frame.
+			//@Description The header is `lengthOffset` (optional, default `0`) bytes of anything followed by a `lengthSize`-byte (1, 2, or 4) length field, which is big endian unless `bigEndian` (optional, default `true`) is `false`. The length field gives the number of bytes after the header.
+			//@Description Frames are sent without their header unless `includeHeader` (optional, default `false`) is `true`. A frame longer than `maxFrameSize` (optional, default `65536`) is dropped as it arrives rather than buffered, and a failure message is sent via the callback (with the instance's UUID as the function) instead.
+			LengthPrefixOptions options;
+			if (!parseLengthPrefixArgs(argv, argc, options, ans)) return;
+			self->readHandler->callbackOnLengthPrefix(options);
+		} },
+		{ "enableBatching", [](TcpServerConnection* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPServerConnection.enableBatching
+			//@Args maxBytes: int, maxLatencyMs: int
+			//@Return A success or failure message
+			//@Description Makes the extension pack every frame read since the last delivery into a single callback instead of sending one callback per frame, so the number of callbacks follows how often Arma empties its callback buffer rather than how fast data arrives.
+			//@Description Batches are sent with the function "data_read_batch" and data in the form `[UUID: string, [frame1: string, frame2: string, ...]]`.
+			//@Description `maxBytes` (optional, default `8192`) limits the length of a batch's data; once it would be exceeded, a new batch is started.
+			//@Description `maxLatencyMs` (optional, default `0`) is how long a batch may be held back after its first frame so more frames can join it. With `0`, batches only grow while Arma's callback buffer is full.
+			int maxBytes = 8192;
+			int maxLatencyMs = 0;
+			try {
+				if (argc > 0) maxBytes = svToInt(argv[0]);
+				if (argc > 1) maxLatencyMs = svToInt(argv[1]);
+			}
+			catch (std::exception e) {
+				sendFailureArr(ans, "Exception parsing input: ", e.what());
+				return;
+			}
+			if (maxBytes < 64) {
+				sendFailureArr(ans, "maxBytes must be at least 64");
+				return;
+			}
+			if (maxLatencyMs < 0) {
+				sendFailureArr(ans, "maxLatencyMs must not be negative");
+				return;
+			}
+			self->readHandler->enableBatching((size_t)maxBytes, maxLatencyMs, ans);
+		} },
+		{ "disableBatching", [](TcpServerConnection* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPServerConnection.disableBatching
+			//@Args 
+			//@Return A success or failure message
+			//@Description Goes back to sending one "data_read" callback per frame. Frames already in a batch are still sent as a batch.
+			self->readHandler->disableBatching(ans);
+		} },
+		{ "enablePolling", [](TcpServerConnection* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPServerConnection.enablePolling
+			//@Args maxFrames: int
+			//@Return A success or failure message
+			//@Description Makes the extension hold on to frames it reads until they are collected with `readAvailable`, instead of sending a "data_read" callback for each one. Polling once per frame avoids Arma's limit of 100 waiting callbacks.
+			//@Description Once `maxFrames` (optional, default `1024`) frames are waiting, the extension stops reading until some are collected, leaving further data with the operating system, unless `setOverflowPolicy` says otherwise.
+			int maxFrames = 1024;
+			try {
+				if (argc > 0) maxFrames = svToInt(argv[0]);
+			}
+			catch (std::exception e) {
+				sendFailureArr(ans, "Exception parsing input: ", e.what());
+				return;
+			}
+			if (maxFrames < 1) {
+				sendFailureArr(ans, "maxFrames must be at least 1");
+				return;
+			}
+			self->readHandler->enablePolling((size_t)maxFrames, ans);
+		} },
+		{ "disablePolling", [](TcpServerConnection* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPServerConnection.disablePolling
+			//@Args 
+			//@Return A success or failure message
+			//@Description Goes back to sending frames via the callback. Frames that were already waiting can still be collected with `readAvailable`.
+			self->readHandler->disablePolling(ans);
+		} },
+		{ "readAvailable", [](TcpServerConnection* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPServerConnection.readAvailable
+			//@Args 
+			//@Return `[[frame1: string, frame2: string, ...], remaining: int]`
+			//@Description Collects as many waiting frames (see `enablePolling`) as fit in Arma's output buffer, oldest first. `remaining` is how many are still waiting after this call.
+			self->readHandler->readAvailable(ans);
+		} },
+		{ "setOverflowPolicy", [](TcpServerConnection* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPServerConnection.setOverflowPolicy
+			//@Args policy: string, maxFrames: int
+			//@Return A success or failure message
+			//@Description Decides what happens to frames read while `maxFrames` (optional, default `1024`) are already waiting to be delivered, either for `readAvailable` or for room in Arma's callback buffer (which holds 100).
+			//@Description `policy` is one of "block" (the default: stop reading until there's room, leaving data with the operating system), "dropOldest", "dropNewest", or "conflateLatest" (replace the newest waiting frame, so the latest data always gets through). Dropped frames are counted by `getOverflowStats`.
+			OverflowPolicy policy;
+			size_t maxFrames;
+			if (!parseOverflowPolicyArgs(argv, argc, policy, maxFrames, ans)) return;
+			self->readHandler->setOverflowPolicy(policy, maxFrames, ans);
+		} },
+		{ "getOverflowStats", [](TcpServerConnection* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPServerConnection.getOverflowStats
+			//@Args 
+			//@Return `[droppedFrames, droppedBytes, waitingFrames]`
+			//@Description Counts the frames (and their bytes) thrown away by the overflow policy since the connection was made, and how many are waiting to be delivered right now.
+			self->readHandler->overflowStats(ans);
+		} },
+		{ "getAllocationStats", [](TcpServerConnection* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPServerConnection.getAllocationStats
+			//@Args 
+			//@Return `[allocations, reuses, allocationsPerSecond]`
+			//@Description Returns how many read and write buffers this instance has had to allocate, how many were reused instead, and how many allocations per second there have been since the last call to this command.
+			//@Description Once reads and writes have been going for a while, `allocationsPerSecond` should stay at 0.
+			self->readHandler->allocationStats(ans);
+		} },
+		{ "getStats", [](TcpServerConnection* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPServerConnection.getStats
+			//@Args 
+			//@Return `[bytesIn, framesIn, bytesOut, writesQueued, writesCompleted, writeQueueDepth, callbackRetries, readErrors, writeErrors, callbacksDropped]`
+			//@Description Returns counters for everything this instance has done since it was created. `framesIn` counts frames before any overflow policy drops them, and `writeQueueDepth` is how many writes are queued but not finished.
+			//@Description `callbackRetries` counts how often Arma's callback buffer was full when this instance's callbacks were offered to it, and `callbacksDropped` how many of its callbacks were thrown away because too many were already waiting. The counters are always kept, and cheap enough that there's no need to turn them off.
+			self->readHandler->getStats().write(ans);
+		} },
+		{ "getLatency", [](TcpServerConnection* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPServerConnection.getLatency
+			//@Args 
+			//@Return `[[callbacks, p50, p99, p999, max], [writes, p50, p99, p999, max]]`
+			//@Description Returns how long this instance's data took to reach SQF and its writes took to go out, in microseconds. The first array measures from data being read to Arma accepting the callback it went out in, and the second from a write being queued (or called, if writes aren't threaded) to it finishing.
+			//@Description Percentiles come from a histogram with about 6% precision, while `max` is exact. Call `resetLatency` to start measuring afresh, e.g. right before a busy part of a mission.
+			self->readHandler->latencyStats(ans);
+		} },
+		{ "resetLatency", [](TcpServerConnection* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPServerConnection.resetLatency
+			//@Args 
+			//@Return A success message
+			//@Description Clears the latencies recorded so far (see `getLatency`).
+			self->readHandler->resetLatency(ans);
+		} },
+		{ "isConnected", [](TcpServerConnection* self, std::string_view* argv, int argc, ResponseWriter& ans) {
+			//@InstanceCommand TCPServerConnection.isConnected
+			//@Args 
+			//@Return `true` or `false` based on whether this instance is currently connected to the port it describes
+			//@Description
+			ans << self->isConnected();
+		} },
+	};
+	commands.run(this, function, argv, argc, ans);
 }
 
 std::string TcpServerConnection::getID()
@@ -401,3 +613,8 @@ bool TcpServerConnection::destroy()
 	doneWithIOContext();
 	return true;
 }
+
+void TcpServerConnection::addStats(IOStatsSnapshot& total)
+{
+	total += this->readHandler->getStats();
+}
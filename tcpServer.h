@@ -3,6 +3,7 @@
 #include <vector>
 #include "util.h"
 #include "ReadWriteHandler.h"
+#include "IOContextHelper.h"
 #include <mutex>
 
 class TcpServerConnection;
@@ -13,6 +14,8 @@ private:
     boost::asio::ip::tcp::acceptor* acceptor;
     std::mutex connectionsMutex;
     bool shouldListen;
+    //keeps this instance's io_context handlers from running concurrently
+    IOStrand strand;
     void listen();
 public:
     std::string id;
@@ -21,12 +24,15 @@ public:
 
     TcpServer(int port);
     ~TcpServer();
-    static void runStaticCommand(std::string function, std::string* argv, int argc, std::stringstream& ans);
-    void runInstanceCommand(std::string function, std::string* argv, int argc, std::stringstream& ans);
+    static void runStaticCommand(std::string_view function, std::string_view* argv, int argc, ResponseWriter& ans);
+    void runInstanceCommand(std::string_view function, std::string_view* argv, int argc, ResponseWriter& ans);
     std::string getID();
     bool isConnected();
     bool destroy();
+    void addStats(IOStatsSnapshot& total);
     void removeConnection(TcpServerConnection* conn);
+    //adds up the counters of every connection to this server
+    IOStatsSnapshot connectionStats();
 };
 
 class TcpServerConnection : public ICommunicationMethod {
@@ -34,6 +40,8 @@ private:
     bool connected;
     TcpServer* server;
     ReadWriteHandler<boost::asio::ip::tcp::socket>* readHandler;
+    //keeps this connection's io_context handlers from running concurrently
+    IOStrand strand;
 public:
     std::string id;
 
@@ -41,10 +49,11 @@ public:
 
     TcpServerConnection(boost::asio::ip::tcp::socket socket, TcpServer* server);
     ~TcpServerConnection();
-    static void runStaticCommand(std::string function, std::string* argv, int argc, std::stringstream& ans);
-    void runInstanceCommand(std::string function, std::string* argv, int argc, std::stringstream& ans);
+    static void runStaticCommand(std::string_view function, std::string_view* argv, int argc, ResponseWriter& ans);
+    void runInstanceCommand(std::string_view function, std::string_view* argv, int argc, ResponseWriter& ans);
     std::string getID();
     bool isConnected();
     boost::system::error_code disconnect();
     bool destroy();
+    void addStats(IOStatsSnapshot& total);
 };
\ No newline at end of file
@@ -2,13 +2,20 @@
 #include <cstring>
 #include <sstream>
 #include <string.h>
+#ifdef _WIN32
 #include <windows.h>
+#else
+#include <random>
+#include <system_error>
+#endif
 #include <map>
+#include <charconv>
+#include <stdexcept>
+#include <cstdio>
+#include "CallbackDispatcher.h"
 
 
-extern ArmaCallback callback;
-
-
+#ifdef _WIN32
 std::string formatErr(int err) {
 	char buff[500];
 	FormatMessageA(
@@ -22,8 +29,13 @@ std::string formatErr(int err) {
 	);
 	return std::string(buff);
 }
+#else
+std::string formatErr(int err) {
+	return std::error_code(err, std::generic_category()).message();
+}
+#endif
 
-bool equalsIgnoreCase(const std::string& a, const std::string& b)
+bool equalsIgnoreCase(std::string_view a, std::string_view b)
 {
 	//from https://stackoverflow.com/a/4119881
 	size_t sz = a.size();
@@ -45,6 +57,20 @@ void toLowerCase(std::string& str)
 	}
 }
 
+int svToInt(std::string_view str)
+{
+	//stoi skips leading whitespace and allows a plus sign, but from_chars doesn't
+	size_t start = 0;
+	while (start < str.length() && isspace((unsigned char)str[start])) start++;
+	if (start < str.length() && str[start] == '+' && (start + 1 == str.length() || str[start + 1] != '-')) start++;
+	int val = 0;
+	auto res = std::from_chars(str.data() + start, str.data() + str.length(), val);
+	if (res.ec == std::errc::invalid_argument) throw std::invalid_argument("invalid stoi argument");
+	if (res.ec == std::errc::result_out_of_range) throw std::out_of_range("stoi argument out of range");
+	return val;
+}
+
+#ifdef _WIN32
 std::string generateUUID() {
 	UUID id;
 	auto status = UuidCreateSequential(&id);
@@ -60,208 +86,109 @@ std::string generateUUID() {
 	RpcStringFreeA((RPC_CSTR*)&idCStr);
 	return ans;
 }
-
-void sendSuccessArr(std::stringstream& ans, std::string message)
-{
-	ans << "[\"SUCCESS\", \"" << message << "\"]";
-}
-void sendFailureArr(std::stringstream& ans, std::string message) {
-	ans << "[\"FAILURE\", \"" << message << "\"]";
-}
-
-void callbackSuccessArr(std::string id, std::string message)
-{
-	auto data = ("[\"SUCCESS\", \"" + message + "\"]");
-	while (callback("ArmaCOM", id.c_str(), data.c_str()) == -1) Sleep(1);
-}
-
-void callbackFailureArr(std::string id, std::string message)
-{
-	auto data = ("[\"FAILURE\", \"" + message + "\"]");
-	while (callback("ArmaCOM", id.c_str(), data.c_str()) == -1) Sleep(1);
-}
-
-ArmaArray* ArmaArray::parse(std::string in)
+#else
+//a random (version 4) UUID, formatted the same way as on Windows
+std::string generateUUID() {
+	static thread_local std::mt19937_64 gen(std::random_device{}());
+	uint64_t hi = gen();
+	uint64_t lo = gen();
+	hi = (hi & ~0xf000ull) | 0x4000ull;
+	lo = (lo & ~(0xc000ull << 48)) | (0x8000ull << 48);
+	char buff[37];
+	snprintf(buff, sizeof(buff), "%08x-%04x-%04x-%04x-%012llx", (unsigned)(hi >> 32), (unsigned)((hi >> 16) & 0xffff),
+		(unsigned)(hi & 0xffff), (unsigned)(lo >> 48), (unsigned long long)(lo & 0xffffffffffffull));
+	return buff;
+}
+#endif
+
+bool parseLengthPrefixArgs(std::string_view* argv, int argc, LengthPrefixOptions& options, ResponseWriter& ans)
 {
-	ArmaArray* ans = new ArmaArray();
-	if (in[0] != '[') throw "Array did not start with '['";
-	if (in[in.length() - 1] != ']') throw "Array did not end with ']'";
-	std::vector<ArmaArray*> arrStack;
-	for (size_t i = 1; i < in.length() - 1;) {
-		char c = in[i];
-		if (c == '[') {
-			auto tmp = new ArmaArray();
-			ans->add(tmp);
-			arrStack.push_back(ans);
-			ans = tmp;
-			c = in[++i];
-			while (c == ' ' || c == '\t') c = in[++i];
-		}
-		else if (c == ']') {
-			ans = arrStack[arrStack.size() - 1];
-			arrStack.pop_back();
-			i++;
-		}
-		else if (c >= '0' && c <= '9') {
-			std::string numStr;
-			numStr += c;
-			bool hadDecimal = false;
-			i++;
-			while (true) {
-				if (i == in.length()) break;
-				c = in[i];
-				if (c == '.' && !hadDecimal) {
-					numStr += c;
-					hadDecimal = true;
-					i++;
-				}
-				else if (c >= '0' && c <= '9') {
-					numStr += c;
-					i++;
-				}
-				else {
-					break;
-				}
-			}
-			double num = std::stod(numStr);
-			ans->add(num);
-		}
-		else if (c == '"') {
-			std::string str;
-			i++;
-			while (true) {
-				if (i == in.length()) throw "Unterminated string in array";
-				c = in[i];
-				if (c == '"') {
-					i++;
-					//double quote is escaped by another double quote
-					if (i != in.length() && in[i] != '"') {
-						break;
-					}
-				}
-				str += c;
-				i++;
-			}
-			ans->add(str);
-		}
+	if (argc == 0 || argv[0].length() == 0) {
+		sendFailureArr(ans, "Additional argument required");
+		return false;
+	}
+	int lengthSize;
+	int lengthOffset = 0;
+	int maxFrameSize = 65536;
+	bool flags[2] = { true, false };
+	try {
+		lengthSize = svToInt(argv[0]);
+		if (argc > 2) lengthOffset = svToInt(argv[2]);
+		if (argc > 4) maxFrameSize = svToInt(argv[4]);
+	}
+	catch (std::exception e) {
+		sendFailureArr(ans, "Exception parsing input: ", e.what());
+		return false;
+	}
+	//bigEndian and includeHeader
+	for (int i = 0; i < 2; i++) {
+		int arg = i == 0 ? 1 : 3;
+		if (argc <= arg) continue;
+		if (equalsIgnoreCase(argv[arg], "true") || argv[arg] == "1") flags[i] = true;
+		else if (equalsIgnoreCase(argv[arg], "false") || argv[arg] == "0") flags[i] = false;
 		else {
-			if (i <= in.length() - 4 &&
-				(c == 't' || c == 'T') &&
-				(in[i + 1] == 'r' || in[i + 1] == 'R') &&
-				(in[i + 2] == 'u' || in[i + 2] == 'U') &&
-				(in[i + 3] == 'e' || in[i + 3] == 'E')) {
-				ans->add(true);
-				i += 4;
-			}
-			else if (i <= in.length() - 5 &&
-				(c == 'f' || c == 'F') &&
-				(in[i + 1] == 'a' || in[i + 1] == 'A') &&
-				(in[i + 2] == 'l' || in[i + 2] == 'L') &&
-				(in[i + 3] == 's' || in[i + 3] == 'S') &&
-				(in[i + 4] == 'e' || in[i + 4] == 'E')) {
-				ans->add(false);
-				i += 5;
-			}
-			else {
-				throw "Invalid character: " + c;
-			}
-		}
-		c = in[i];
-		while (c == ' ' || c == '\t') c = in[++i];
-		if (c == ',') {
-			c = in[++i];
-			while (c == ' ' || c == '\t') c = in[++i];
-		}
-		else if (c != ']') {
-			throw "Invalid character: " + c;
+			sendFailureArr(ans, "Expected true, false, 1, or 0");
+			return false;
 		}
 	}
-	if (arrStack.size() != 0) throw "Unterminated array";
-	return ans;
-}
-
-void ArmaArray::add(ArmaArray* arr) {
-	ArrayElem ans;
-	ans.type = ArrayElemType::ARRAY;
-	ans.val.arr = arr;
-	this->contents.push_back(ans);
-}
-
-void ArmaArray::add(std::string& str) {
-	ArrayElem ans;
-	ans.type = ArrayElemType::STRING;
-	ans.val.string = new std::string(str);
-	this->contents.push_back(ans);
-}
-
-inline void ArmaArray::add(double number) {
-	ArrayElem ans;
-	ans.type = ArrayElemType::NUMBER;
-	ans.val.number = number;
-	this->contents.push_back(ans);
-}
-
-inline void ArmaArray::add(bool boolean) {
-	ArrayElem ans;
-	ans.type = ArrayElemType::BOOLEAN;
-	ans.val.boolean = boolean;
-	this->contents.push_back(ans);
+	if (lengthSize != 1 && lengthSize != 2 && lengthSize != 4) {
+		sendFailureArr(ans, "Length size must be 1, 2, or 4");
+		return false;
+	}
+	if (lengthOffset < 0 || lengthOffset > 65535) {
+		sendFailureArr(ans, "Length offset must be between 0 and 65535");
+		return false;
+	}
+	if (maxFrameSize < 1) {
+		sendFailureArr(ans, "Maximum frame size must be at least 1");
+		return false;
+	}
+	options.lengthSize = (unsigned char)lengthSize;
+	options.bigEndian = flags[0];
+	options.includeHeader = flags[1];
+	options.lengthOffset = (unsigned short)lengthOffset;
+	options.maxFrameSize = maxFrameSize;
+	return true;
 }
 
-void ArmaArray::appendAsString(std::stringstream& ans)
+bool parseOverflowPolicyArgs(std::string_view* argv, int argc, OverflowPolicy& policy, size_t& maxFrames, ResponseWriter& ans)
 {
-	ans << "[";
-	auto start = this->contents.begin();
-	auto it = start;
-	auto end = this->contents.end();
-	for (; it < end; it++) {
-		if (it != start) {
-			ans << ", ";
-		}
-		auto elem = *it;
-		if (elem.type == ArrayElemType::ARRAY) {
-			elem.val.arr->appendAsString(ans);
-		}
-		else if (elem.type == ArrayElemType::STRING) {
-			ans << "\"";
-			ans << elem.val.string;
-			ans << "\"";
-		}
-		else if (elem.type == ArrayElemType::NUMBER) {
-			ans << elem.val.number;
-		}
-		else if (elem.type == ArrayElemType::BOOLEAN) {
-			if (elem.val.boolean) {
-				ans << "true";
-			}
-			else {
-				ans << "false";
-			}
-		}
+	if (argc == 0 || argv[0].length() == 0) {
+		sendFailureArr(ans, "Additional argument required");
+		return false;
+	}
+	if (equalsIgnoreCase(argv[0], "block")) policy = OverflowPolicy::BLOCK;
+	else if (equalsIgnoreCase(argv[0], "dropOldest")) policy = OverflowPolicy::DROP_OLDEST;
+	else if (equalsIgnoreCase(argv[0], "dropNewest")) policy = OverflowPolicy::DROP_NEWEST;
+	else if (equalsIgnoreCase(argv[0], "conflateLatest")) policy = OverflowPolicy::CONFLATE_LATEST;
+	else {
+		sendFailureArr(ans, "Expected block, dropOldest, dropNewest, or conflateLatest");
+		return false;
+	}
+	int frames = 1024;
+	try {
+		if (argc > 1) frames = svToInt(argv[1]);
+	}
+	catch (std::exception e) {
+		sendFailureArr(ans, "Exception parsing input: ", e.what());
+		return false;
+	}
+	if (frames < 1) {
+		sendFailureArr(ans, "maxFrames must be at least 1");
+		return false;
 	}
-	ans << "]";
+	maxFrames = (size_t)frames;
+	return true;
 }
 
-std::string ArmaArray::toString()
+void callbackSuccessArr(std::string id, std::string message)
 {
-	std::stringstream ans;
-	this->appendAsString(ans);
-	return ans.str();
+	CallbackDispatcher::get().post(id.c_str(), "[\"SUCCESS\", \"" + message + "\"]");
 }
 
-ArmaArray::~ArmaArray()
+void callbackFailureArr(std::string id, std::string message)
 {
-	auto it = this->contents.begin();
-	auto end = this->contents.end();
-	for (; it < end; it++) {
-		auto elem = *it;
-		if (elem.type == ArrayElemType::ARRAY) {
-			delete elem.val.arr;
-		}
-		else if (elem.type == ArrayElemType::STRING) {
-			delete elem.val.string;
-		}
-	}
+	CallbackDispatcher::get().post(id.c_str(), "[\"FAILURE\", \"" + message + "\"]");
 }
 
 bool operator==(const ReadCallbackOptions& a, const ReadCallbackOptions& b) {
@@ -274,6 +201,16 @@ bool operator==(const ReadCallbackOptions& a, const ReadCallbackOptions& b) {
 	else if (a.type == ReadCallbackTypes::ON_LENGTH) {
 		return a.value.onLength == b.value.onLength;
 	}
+	else if (a.type == ReadCallbackTypes::ON_PREFIX) {
+		const LengthPrefixOptions& pa = a.value.onPrefix;
+		const LengthPrefixOptions& pb = b.value.onPrefix;
+		return pa.lengthSize == pb.lengthSize && pa.bigEndian == pb.bigEndian && pa.includeHeader == pb.includeHeader &&
+			pa.lengthOffset == pb.lengthOffset && pa.maxFrameSize == pb.maxFrameSize;
+	}
+	else if (a.type == ReadCallbackTypes::ON_STRING) {
+		return a.value.onString.length == b.value.onString.length &&
+			memcmp(a.value.onString.chars, b.value.onString.chars, a.value.onString.length) == 0;
+	}
 	else {
 		throw "Unimplemented equality case for ReadCallbackOptions";
 	}
@@ -2,13 +2,28 @@
 
 #include <cstring>
 #include <sstream>
+#include <string_view>
 #include <string.h>
 #include <map>
 #include <cstdarg>
 #include <vector>
+#include "ResponseWriter.h"
+#include "IOStats.h"
 
+#ifndef _WIN32
+#include <cerrno>
+#include <cstdint>
+//the Windows types and error call the I/O code is written with, so it builds unchanged on Linux,
+//where error codes are errno values instead
+typedef uint32_t DWORD;
+typedef uint16_t WORD;
+typedef uint8_t BYTE;
+inline DWORD GetLastError() {
+	return (DWORD)errno;
+}
+#endif
 
-//takes a Windows error code (from GetLastError) and returns a string with the error message
+//takes an error code (from GetLastError) and returns a string with the error message
 std::string formatErr(int err);
 
 typedef int (*ArmaCallback)(char const* name, char const* function, char const* data);
@@ -16,59 +31,93 @@ typedef int (*ArmaCallback)(char const* name, char const* function, char const*
 class ICommunicationMethod
 {
 public:
-	virtual void runInstanceCommand(std::string function, std::string* argv, int argc, std::stringstream& ans) = 0;
+	virtual void runInstanceCommand(std::string_view function, std::string_view* argv, int argc, ResponseWriter& ans) = 0;
 	virtual std::string getID() = 0;
 	virtual bool isConnected() = 0;
 	virtual bool destroy() = 0;
+	//adds this instance's I/O counters to `total`. instances that only own other instances (i.e. TCP servers)
+	//add nothing, since what they own is counted separately
+	virtual void addStats(IOStatsSnapshot& total) = 0;
 };
 
-class ArmaArray {
-private:
-	enum ArrayElemType {
-		ARRAY, STRING, NUMBER, BOOLEAN
-	};
-	struct ArrayElem {
-		ArrayElemType type;
-		union {
-			ArmaArray* arr;
-			std::string* string;
-			double number;
-			bool boolean;
-		} val;
-	};
-	std::vector<ArrayElem> contents;
-public:
-	ArmaArray() {}
-	static ArmaArray* parse(std::string in);
-	void add(ArmaArray* arr);
-	void add(std::string& str);
-	void add(double number);
-	void add(bool boolean);
-	void appendAsString(std::stringstream& ans);
-	std::string toString();
-	~ArmaArray();
+enum ReadCallbackTypes {
+	ON_CHAR, ON_LENGTH, ON_PREFIX, ON_STRING
 };
 
-enum ReadCallbackTypes {
-	ON_CHAR, ON_LENGTH
+//a multi-character delimiter, e.g. "\r\n". kept inline so ReadCallbackOptions stays trivially copyable
+struct StringDelimiter {
+	static constexpr int maxLength = 15;
+	unsigned char length;
+	char chars[maxLength];
+};
+
+//frames that start with a header saying how long they are: `lengthOffset` bytes of anything, then a
+//`lengthSize`-byte length field giving the number of bytes that follow the header
+struct LengthPrefixOptions {
+	//1, 2 or 4
+	unsigned char lengthSize;
+	bool bigEndian;
+	//whether frames are sent to Arma with their header or just the data after it
+	bool includeHeader;
+	unsigned short lengthOffset;
+	//frames claiming to be longer than this are dropped as they arrive instead of being buffered
+	int maxFrameSize;
 };
 
 struct ReadCallbackOptions {
 	ReadCallbackTypes type;
-	union { char onChar; int onLength; } value;
+	union { char onChar; int onLength; LengthPrefixOptions onPrefix; StringDelimiter onString; } value;
 };
 bool operator==(const ReadCallbackOptions& a, const ReadCallbackOptions& b);
 bool operator!=(const ReadCallbackOptions& a, const ReadCallbackOptions& b);
 
-bool equalsIgnoreCase(const std::string& a, const std::string& b);
+//what happens to frames read while too many are already waiting to be delivered
+enum class OverflowPolicy {
+	//stop reading until there's room, leaving data with the OS
+	BLOCK,
+	//throw away the oldest waiting frame to make room
+	DROP_OLDEST,
+	//throw away the frame that was just read
+	DROP_NEWEST,
+	//replace the newest waiting frame with the one just read, so the latest data always gets through
+	CONFLATE_LATEST
+};
+
+bool equalsIgnoreCase(std::string_view a, std::string_view b);
+
+//parses an int from the start of `str` the same way `std::stoi` does (including the exceptions it throws), without copying it into a string first
+int svToInt(std::string_view str);
 std::string generateUUID();
+//parses the arguments of the callbackOnLengthPrefix commands into `options`, or replies with a failure message and returns false
+bool parseLengthPrefixArgs(std::string_view* argv, int argc, LengthPrefixOptions& options, ResponseWriter& ans);
+//parses the arguments of the setOverflowPolicy commands, or replies with a failure message and returns false
+bool parseOverflowPolicyArgs(std::string_view* argv, int argc, OverflowPolicy& policy, size_t& maxFrames, ResponseWriter& ans);
 
-void sendSuccessArr(std::stringstream& ans, std::string message);
-void sendFailureArr(std::stringstream& ans, std::string message);
+//replies ["SUCCESS", "message"], where the message is all of `parts` written one after another.
+//passing numbers and strings as separate parts instead of concatenating them avoids building a temporary string
+template<typename... Parts>
+void sendSuccessArr(ResponseWriter& ans, const Parts&... parts) {
+	ans << "[\"SUCCESS\", \"";
+	(ans << ... << parts);
+	ans << "\"]";
+}
+//replies ["FAILURE", "message"], the same way as sendSuccessArr
+template<typename... Parts>
+void sendFailureArr(ResponseWriter& ans, const Parts&... parts) {
+	ans << "[\"FAILURE\", \"";
+	(ans << ... << parts);
+	ans << "\"]";
+}
 
 void callbackSuccessArr(std::string id, std::string message);
 void callbackFailureArr(std::string id, std::string message);
 
 void needIOContext();
 
-void doneWithIOContext();
\ No newline at end of file
+void doneWithIOContext();
+
+//sets how many threads run the io_context. takes effect the next time it starts if it's already running with more threads.
+void setIOContextThreads(int count);
+
+//the number of threads running the io_context, or that will run it once it starts
+int getIOContextThreads();
\ No newline at end of file